@@ -1,5 +1,6 @@
 #include "systest.h"
 #include "macros.h"
+#include <stdatomic.h>
 
 #if defined(__WIN__)
 # pragma comment(lib, "shlwapi.lib")
@@ -7,33 +8,148 @@
 # pragma comment(lib, "version.lib")
 #endif
 
+#define INET_TEST_HOST "example.com"
+#define INET_TEST_PORT "http"
+
+/** Smallest --bench-file-size: room for a 1 MiB block per storage benchmark thread. */
+#define BENCH_FILE_MIN_MB 8L
+
+/** Options given on the command line. */
+static struct {
+    const char* only;   /**< Comma-separated names/categories to run, or NULL for all. */
+    const char* skip;   /**< Comma-separated names/categories not to run. */
+    systest_cost max_cost;
+    bool list;
+    long jobs;          /**< Worker threads; 0 = size from the CPU count, 1 = serial. */
+    const char* inet_host;
+    const char* inet_port;
+    long inet_timeout;  /**< Milliseconds. */
+    bool bench;         /**< Run benchmark probes too. */
+    long bench_ms;      /**< Duration of each benchmark measurement. */
+    long bench_file_mb; /**< Size of the scratch files benchmarks create. */
+    const char* dns_names;  /**< Comma-separated names for the resolver probe. */
+    const char* dns_server; /**< Query this server directly instead of getaddrinfo(). */
+    long dns_lookups;
+    const char* walk_root;  /**< Tree for the walk benchmark; NULL = build one. */
+    long mount_timeout;     /**< Milliseconds each mount gets to answer statvfs(). */
+    long mem_max_mb;        /**< Largest working set for the memory benchmarks. */
+} opts = {
+    .only         = NULL,
+    .skip         = NULL,
+    .max_cost     = SYSTEST_COST_EXPENSIVE,
+    .list         = false,
+    .jobs         = 0L,
+    .inet_host    = INET_TEST_HOST,
+    .inet_port    = INET_TEST_PORT,
+    .inet_timeout = SYSTEST_INET_TIMEOUT_MS,
+    .bench        = false,
+    .bench_ms     = 250L,
+    .bench_file_mb = 64L,
+    .dns_names    = INET_TEST_HOST ",localhost",
+    .dns_server   = NULL,
+    .dns_lookups  = 64L,
+    .walk_root    = NULL,
+    .mount_timeout = SYSTEST_MOUNT_TIMEOUT_MS,
+    .mem_max_mb   = 512L
+};
+
 int num_attempted = 0;
 int num_succeeded = 0;
 
-void handle_result(bool pass, const char* desc) {
+void handle_result(bool pass, const char* desc, uint64_t duration_ns) {
     /* print something reliable, so that if we need to use tools
      * to parse the output of this program to determine support,
      * it will be much easier. */
     if (pass) {
-        printf("\t" LGREEN("PASS: %s") "\n", desc);
+        printf("\t" LGREEN("PASS: %s") " " DGRAY("(%.3f ms)") "\n", desc,
+            (double)duration_ns / 1e6);
         num_succeeded++;
     } else {
-        fprintf(stderr, "\t" RED("FAIL: %s") "\n", desc);
+        fprintf(stderr, "\t" RED("FAIL: %s") " " DGRAY("(%.3f ms)") "\n", desc,
+            (double)duration_ns / 1e6);
     }
 
     num_attempted++;
 }
 
+/** Sorts samples, then prints their count, percentiles and a histogram with
+ * power-of-two buckets. */
+static void print_latency_stats(const char* label, uint64_t* samples, size_t count) {
+    if (0 == count) {
+        systest_printf("%s: no samples\n", label);
+        return;
+    }
+
+    systest_sortu64(samples, count);
+    systest_printf("%s: n = %zu, min = %.3f us, p50 = %.3f us, p99 = %.3f us, max = %.3f us\n",
+        label, count, (double)samples[0] / 1e3, (double)systest_percentile(samples, count, 50.0) / 1e3,
+        (double)systest_percentile(samples, count, 99.0) / 1e3, (double)samples[count - 1] / 1e3);
+
+    size_t buckets[64] = {0};
+    size_t first = __countof(buckets);
+    size_t last  = 0;
+    for (size_t n = 0; n < count; n++) {
+        size_t b = 0;
+        for (uint64_t v = samples[n] / 1000; v > 0; v >>= 1)
+            b++;
+        buckets[b]++;
+        if (b < first)
+            first = b;
+        if (b > last)
+            last = b;
+    }
+
+    for (size_t b = first; b <= last; b++) {
+        uint64_t lo = b ? (1ULL << (b - 1)) : 0;
+        int width = (int)((buckets[b] * 40 + count - 1) / count);
+        systest_printf("  %8"PRIu64" us+ | %-40.*s %zu\n", lo, width,
+            "########################################", buckets[b]);
+    }
+}
+
+/** Splits a comma-separated list into a NULL-terminated array of strings. Free
+ * the result (one allocation) with systest_safefree. */
+static char** split_list(const char* list, size_t* count) {
+    *count = 0;
+    if (!_validstr(list))
+        return NULL;
+
+    size_t entries = 1;
+    for (const char* c = list; *c; c++)
+        entries += (',' == *c) ? 1 : 0;
+
+    size_t list_len = strlen(list) + 1;
+    char** arr = calloc(1, ((entries + 1) * sizeof(char*)) + list_len);
+    if (!arr) {
+        handle_error(errno, "calloc() failed!");
+        return NULL;
+    }
+
+    char* copy = (char*)(arr + entries + 1);
+    memcpy(copy, list, list_len);
+
+    for (char* tok = copy; tok; ) {
+        char* comma = strchr(tok, ',');
+        if (comma)
+            *comma = '\0';
+        if (*tok)
+            arr[(*count)++] = tok;
+        tok = comma ? comma + 1 : NULL;
+    }
+
+    return arr;
+}
+
 #if !defined(__WIN__)
 bool call_sysconf(int val, const char* desc) {
-    printf("checking sysconf(%d) (\"%s\")...\n", val, desc);
+    systest_printf("checking sysconf(%d) (\"%s\")...\n", val, desc);
 
     long ret = sysconf(val);
     if (ret == -1) {
-        printf("sysconf(%d) error: %s!\n", val, strerror(errno));
+        systest_printf("sysconf(%d) error: %s!\n", val, strerror(errno));
         return false;
     } else {
-        printf("sysconf(%d) = %ld.\n", val, ret);
+        systest_printf("sysconf(%d) = %ld.\n", val, ret);
         return true;
     }
 
@@ -55,31 +171,196 @@ bool check_sysconf(void) {
     return retval;
 #else
     /* https://learn.microsoft.com/en-us/cpp/c-runtime-library/reference/popen-wpopen */
-    printf("windows has _popen()/_pclose().\n");
+    systest_printf("windows has _popen()/_pclose().\n");
     return true;
 #endif
 }
 
 bool check_system(void) {
-    printf("checking system(NULL)...\n");
+    systest_printf("checking system(NULL)...\n");
 
     if (0 == system(NULL)) {
-        printf("system() is NOT available to execute commands!\n");
+        systest_printf("system() is NOT available to execute commands!\n");
         return false;
     } else {
-        printf("system() is available to execute commands.\n");
+        systest_printf("system() is available to execute commands.\n");
         return true;
     }
 }
 
+#if !defined(__WIN__)
+/* --- spawn latency: each way of starting a process, from a small parent
+ * and from one with a large resident set, which fork() has to copy the
+ * page tables of --- */
+
+# define SPAWN_MIN_SAMPLES 10
+# define SPAWN_MAX_SAMPLES 1000
+# define SPAWN_STACK_SIZE (64 * 1024)
+
+extern char** environ;
+
+typedef enum {
+    SPAWN_SYSTEM,
+    SPAWN_FORK,
+# if defined(__linux__)
+    SPAWN_VFORK,
+# endif
+    SPAWN_POSIX,
+# if defined(__linux__)
+    SPAWN_CLONE,
+# endif
+    SPAWN_METHODS
+} spawn_method;
+
+static const char* const spawn_names[SPAWN_METHODS] = {
+    "system()", "fork+exec",
+# if defined(__linux__)
+    "vfork+exec",
+# endif
+    "posix_spawn",
+# if defined(__linux__)
+    "clone(CLONE_VFORK)",
+# endif
+};
+
+# if defined(__linux__)
+static int spawn_clone_child(void* arg) {
+    char* const* argv = (char* const*)arg;
+    (void)execv(argv[0], argv);
+    _exit(127);
+}
+# endif
+
+/** Starts argv by method and waits for it; true if it exited with 0. */
+static bool spawn_once(spawn_method method, char* const argv[], char* stack) {
+    if (SPAWN_SYSTEM == method)
+        return 0 == system(argv[0]);
+
+    pid_t pid = -1;
+    switch (method) {
+        case SPAWN_FORK:
+            pid = fork();
+            if (0 == pid) {
+                (void)execv(argv[0], argv);
+                _exit(127);
+            }
+            break;
+# if defined(__linux__)
+        case SPAWN_VFORK:
+            pid = vfork();
+            if (0 == pid) {
+                (void)execv(argv[0], argv);
+                _exit(127);
+            }
+            break;
+        case SPAWN_CLONE:
+            pid = clone(&spawn_clone_child, stack + SPAWN_STACK_SIZE, CLONE_VM | CLONE_VFORK | SIGCHLD,
+                (void*)argv);
+            break;
+# endif
+        case SPAWN_POSIX:
+            errno = posix_spawn(&pid, argv[0], NULL, NULL, argv, environ);
+            if (0 != errno)
+                pid = -1;
+            break;
+        default:
+            break;
+    }
+    (void)stack;
+    if (-1 == pid)
+        return false;
+
+    int status = 0;
+    while (-1 == waitpid(pid, &status, 0)) {
+        if (EINTR != errno)
+            return false;
+    }
+    return WIFEXITED(status) && 0 == WEXITSTATUS(status);
+}
+
+bool check_spawn_bench(void) {
+    /* something that does as little as possible once it's running. */
+    static char true_path[16] = "/bin/true";
+    if (0 != access(true_path, X_OK))
+        (void)snprintf(true_path, sizeof(true_path), "/usr/bin/true");
+    char* argv[] = {true_path, NULL};
+
+    uint64_t* samples = malloc(SPAWN_MAX_SAMPLES * sizeof(uint64_t));
+    char* stack = malloc(SPAWN_STACK_SIZE);
+    if (!samples || !stack) {
+        handle_error(ENOMEM, "malloc() failed!");
+        systest_safefree(&samples);
+        systest_safefree(&stack);
+        return false;
+    }
+
+    /* the big parent: --mem-max-size of touched anonymous memory. */
+    size_t inflate = (size_t)opts.mem_max_mb * 1024 * 1024;
+    systest_cgroup_limits limits;
+    if (systest_getcgrouplimits(&limits) && inflate > limits.memory_budget / 4)
+        inflate = (size_t)(limits.memory_budget / 4);
+
+    uint64_t budget_ns = (uint64_t)opts.bench_ms * 1000000ULL;
+    bool passed = true;
+    systest_printf("spawn-to-exit latency of %s, us\n", true_path);
+    systest_printf("%-20s %9s %6s %9s %9s %9s %9s\n", "method", "parent", "n", "p50", "p90", "p99", "max");
+
+    for (int inflated = 0; passed && inflated < 2; inflated++) {
+        char* ballast = NULL;
+        char parent[24] = "small";
+        if (inflated) {
+            ballast = mmap(NULL, inflate, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (MAP_FAILED == ballast) {
+                systest_printf(YELLOW("couldn't inflate the parent by %zu MiB: %s") "\n", inflate >> 20,
+                    strerror(errno));
+                break;
+            }
+            memset(ballast, 1, inflate);
+            (void)snprintf(parent, sizeof(parent), "+%zu MiB", inflate >> 20);
+        }
+
+        for (int method = 0; passed && method < SPAWN_METHODS; method++) {
+            size_t count = 0;
+            uint64_t start = systest_monotonic_ns();
+            while (count < SPAWN_MAX_SAMPLES &&
+                (count < SPAWN_MIN_SAMPLES || systest_monotonic_ns() - start < budget_ns)) {
+                uint64_t begin = systest_monotonic_ns();
+                if (!spawn_once((spawn_method)method, argv, stack)) {
+                    systest_printf(RED("%s of %s failed: %s") "\n", spawn_names[method], true_path,
+                        strerror(errno));
+                    passed = false;
+                    break;
+                }
+                samples[count++] = systest_monotonic_ns() - begin;
+            }
+            if (!passed)
+                break;
+
+            systest_sortu64(samples, count);
+            systest_printf("%-20s %9s %6zu %9.1f %9.1f %9.1f %9.1f\n", spawn_names[method], parent, count,
+                (double)systest_percentile(samples, count, 50.0) / 1e3,
+                (double)systest_percentile(samples, count, 90.0) / 1e3,
+                (double)systest_percentile(samples, count, 99.0) / 1e3, (double)samples[count - 1] / 1e3);
+        }
+
+        if (ballast)
+            (void)munmap(ballast, inflate);
+    }
+
+    systest_safefree(&samples);
+    systest_safefree(&stack);
+    return passed;
+}
+#endif
+
 bool check_z_printf(void) {
     char buf[256] = {0};
     size_t n = 10;
     snprintf(buf, 256, "printing a size_t with the value ten: '%zu'", n);
-    printf("%s\n", buf);
+    systest_printf("%s\n", buf);
 
     if (NULL != strstr(buf, "10")) {
-        printf("Found '10' in the format string.\n");
+        systest_printf("Found '10' in the format string.\n");
         return true;
     }
 
@@ -93,7 +374,7 @@ bool check_filesystem_api(void) {
     char* appfilename = systest_getappfilename();
     all_passed &= _validptr(appfilename);
     if (_validptr(appfilename)) {
-        printf("systest_getappfilename() = '%s'\n", appfilename);
+        systest_printf("systest_getappfilename() = '%s'\n", appfilename);
         /* ==== */
 
         /* ==== get base name (file name component of a path)  ==== */
@@ -105,7 +386,7 @@ bool check_filesystem_api(void) {
 
         char* basenameresult = systest_getbasename(basenametest);
         all_passed &= (strlen(basenameresult) > 0 && 0 != strcmp(basenameresult, "."));
-        printf("systest_getbasename() = '%s'\n", basenameresult);
+        systest_printf("systest_getbasename() = '%s'\n", basenameresult);
         systest_safefree(&basenametest);
         /* ==== */
 
@@ -118,34 +399,34 @@ bool check_filesystem_api(void) {
 
         char* dirnameresult = systest_getdirname(dirnametest);
         all_passed &= (strlen(dirnameresult) > 0 && 0 != strcmp(dirnameresult, "."));
-        printf("systest_getdirname() = '%s'\n", dirnameresult);
+        systest_printf("systest_getdirname() = '%s'\n", dirnameresult);
         systest_safefree(&dirnametest);
         /* ==== */
 
         systest_safefree(&appfilename);
     } else {
-        printf(RED("systest_getbasename() = skipped") "\n");
-        printf(RED("systest_getdirname() = skipped") "\n");
+        systest_printf(RED("systest_getbasename() = skipped") "\n");
+        systest_printf(RED("systest_getdirname() = skipped") "\n");
     }
 
     /* ==== get app dir path (absolute path of directory containing binary file) ==== */
     char* appdir = systest_getappdir();
     all_passed &= _validptr(appdir);
-    printf("systest_getappdir() = '%s'\n", prn_str(appdir));
+    systest_printf("systest_getappdir() = '%s'\n", prn_str(appdir));
     systest_safefree(&appdir);
     /* ==== */
 
     /* ==== get binary file name with no path components ==== */
     char* appbname = systest_getappbasename();
     all_passed &= _validptr(appbname);
-    printf("systest_getappbasename() = '%s'\n", prn_str(appbname));
+    systest_printf("systest_getappbasename() = '%s'\n", prn_str(appbname));
     systest_safefree(&appbname);
     /* ==== */
 
     /* ==== get current working directory (not necessarily the same ass app directory) ==== */
     char* cwd = systest_getcwd();
     all_passed &= _validptr(cwd);
-    printf("systest_getcwd() = '%s'\n", prn_str(cwd));
+    systest_printf("systest_getcwd() = '%s'\n", prn_str(cwd));
     systest_safefree(&cwd);
     /* ==== */
 
@@ -157,6 +438,7 @@ bool check_filesystem_api(void) {
         {"idontexist", false},
     };
 
+    bool single_exists[__countof(real_or_not)] = {false};
     for (size_t n = 0; n < (sizeof(real_or_not) / sizeof(real_or_not[0])); n++) {
         bool exists = false;
         bool ret    = systest_pathexists(real_or_not[n].path, &exists,
@@ -164,30 +446,236 @@ bool check_filesystem_api(void) {
         all_passed &= ret;
         if (!ret)
             continue;
+        single_exists[n] = exists;
+
+        if (exists) {
+            struct stat st = {0};
+            if (systest_pathgetstat(real_or_not[n].path, &st, SYSTEST_PATH_REL_TO_APP)) {
+                char* as_str = systest_stattostring(&st);
+                if (as_str) {
+                    systest_printf("%s = %s\n", real_or_not[n].path, as_str);
+                    systest_safefree(&as_str);
+                }
+            }
+        }
 
         if (exists != real_or_not[n].exists) {
             all_passed = false;
-            printf(RED("systest_pathexists('%s') = %s") "\n",
+            systest_printf(RED("systest_pathexists('%s') = %s") "\n",
                 real_or_not[n].path, exists ? "true" : "false");
         } else {
-            printf("systest_pathexists('%s') = %s\n",
+            systest_printf("systest_pathexists('%s') = %s\n",
                 real_or_not[n].path, exists ? "true" : "false");
         }
     }
 
+    /* ==== batch lookups: same answers as one at a time, whichever way ==== */
+    /* the paths above, repeated until the batch is big enough to be split
+     * across threads. */
+    const char* batch_paths[4 * SYSTEST_PATHBATCH_PER_THREAD];
+    for (size_t n = 0; n < __countof(batch_paths); n++)
+        batch_paths[n] = real_or_not[n % __countof(real_or_not)].path;
+
+    const unsigned batch_flags[] = {
+        SYSTEST_PATHBATCH_DEFAULT, SYSTEST_PATHBATCH_PARALLEL, SYSTEST_PATHBATCH_URING
+    };
+    for (size_t f = 0; f < __countof(batch_flags); f++) {
+        bool batch_exists[__countof(batch_paths)] = {false};
+        bool batch_ok = systest_pathexists_many(batch_paths, __countof(batch_paths), batch_exists,
+            SYSTEST_PATH_REL_TO_APP, batch_flags[f]);
+        for (size_t n = 0; n < __countof(batch_paths); n++)
+            batch_ok &= (batch_exists[n] == single_exists[n % __countof(real_or_not)]);
+        all_passed &= batch_ok;
+        systest_printf("systest_pathexists_many(%zu paths, flags = 0x%x): %s\n", __countof(batch_paths),
+            batch_flags[f], batch_ok ? "matches" : RED("mismatch!"));
+    }
+    /* ==== */
+
+    /* ==== path cache: same answers after being dropped and rebuilt ==== */
+    char* cached_dir = systest_getappdir();
+    systest_pathcache_invalidate();
+    char* rebuilt_dir = systest_getappdir();
+    bool cache_ok = cached_dir && rebuilt_dir && 0 == strcmp(cached_dir, rebuilt_dir);
+    all_passed &= cache_ok;
+    systest_printf("systest_pathcache_invalidate(): %s\n", cache_ok ? "app dir unchanged" :
+        RED("app dir changed!"));
+    systest_safefree(&cached_dir);
+    systest_safefree(&rebuilt_dir);
+    /* ==== */
+
     /* ==== free disk space ==== */
     uint64_t free_bytes = 0;
     all_passed &= systest_getfreediskspace(&free_bytes);
-    printf("systest_getfreediskspace() = %"PRIu64"\n", free_bytes);
+    systest_printf("systest_getfreediskspace() = %"PRIu64"\n", free_bytes);
     /* ==== */
 
     return all_passed;
 }
 
-#define INET_TEST_HOST "example.com"
-#define INET_TEST_PORT "http"
+#if defined(__linux__) && defined(__HAVE_PTHREADS__)
+bool check_mounts(void) {
+    systest_mount* mounts = NULL;
+    size_t count = 0;
+    if (!systest_getmounts(&mounts, &count, (int)opts.mount_timeout))
+        return false;
+
+    size_t pseudo = 0, stuck = 0, failed = 0;
+    systest_printf("%-32s %-10s %10s %10s %5s %12s %5s\n", "mount point", "type", "size GiB",
+        "avail GiB", "use%", "free inodes", "iuse%");
+
+    for (size_t n = 0; n < count; n++) {
+        const systest_mount* m = &mounts[n];
+        if (m->stuck) {
+            stuck++;
+            systest_printf(YELLOW("%-32s %-10s stuck: no answer within %ld ms (%s)") "\n",
+                m->mount_point, m->fs_type, opts.mount_timeout, m->source);
+            continue;
+        }
+        if (0 != m->err) {
+            failed++;
+            systest_printf(YELLOW("%-32s %-10s statvfs() failed: %d (%s)") "\n", m->mount_point,
+                m->fs_type, m->err, strerror(m->err));
+            continue;
+        }
+        if (0 == m->total_bytes) {
+            pseudo++;
+            continue;
+        }
+
+        double used_pct  = 100.0 * (1.0 - ((double)m->avail_bytes / (double)m->total_bytes));
+        double iused_pct = m->total_inodes ?
+            100.0 * (1.0 - ((double)m->free_inodes / (double)m->total_inodes)) : 0.0;
+        systest_printf("%-32s %-10s %10.1f %10.1f %5.0f %12" PRIu64 " %5.0f\n", m->mount_point,
+            m->fs_type, (double)m->total_bytes / (1024.0 * 1024.0 * 1024.0),
+            (double)m->avail_bytes / (1024.0 * 1024.0 * 1024.0), used_pct, m->free_inodes,
+            iused_pct);
+    }
+
+    systest_printf("%zu mounts: %zu without blocks (not shown), %zu stuck, %zu failed\n", count,
+        pseudo, stuck, failed);
+    systest_freemounts(mounts, count);
+    return 0 == stuck;
+}
+#endif
+
+#if !defined(__WIN__)
+# define _sock_errno() errno
+# define _sock_close(s) close(s)
+# define _sock_poll(fds, n, ms) poll(fds, n, ms)
+# define SOCK_INPROGRESS EINPROGRESS
+#else
+# define _sock_errno() WSAGetLastError()
+# define _sock_close(s) closesocket(s)
+# define _sock_poll(fds, n, ms) WSAPoll(fds, (ULONG)(n), ms)
+# define SOCK_INPROGRESS WSAEWOULDBLOCK
+#endif
+
+static bool set_nonblocking(descriptor sock) {
+#if !defined(__WIN__)
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (-1 == flags || -1 == fcntl(sock, F_SETFL, flags | O_NONBLOCK)) {
+        handle_error(errno, "fcntl() failed!");
+        return false;
+    }
+#else
+    u_long nonblocking = 1;
+    if (0 != ioctlsocket(sock, FIONBIO, &nonblocking)) {
+        handle_error(WSAGetLastError(), "ioctlsocket() failed!");
+        return false;
+    }
+#endif
+    return true;
+}
+
+/** State of one address while racing connections to a host. */
+typedef struct {
+    const struct addrinfo* ai;
+    descriptor sock;
+    char addr[INET6_ADDRSTRLEN];
+    uint64_t started_ns;
+    uint64_t latency_ns;
+    int err;
+    enum {
+        ATTEMPT_PENDING = 0,
+        ATTEMPT_INFLIGHT,
+        ATTEMPT_CONNECTED,
+        ATTEMPT_FAILED,
+        ATTEMPT_ABANDONED
+    } state;
+} connect_attempt;
+
+/** Orders addresses the way RFC 8305 (section 4) suggests: alternate between
+ * families, starting with whichever getaddrinfo() returned first. */
+static size_t interleave_addrs(struct addrinfo* list, connect_attempt* attempts, size_t max) {
+    size_t count = 0;
+    int first_family = list ? list->ai_family : AF_UNSPEC;
+    struct addrinfo* next_first = list;
+    struct addrinfo* next_other = list;
+    bool want_first = true;
+
+    while (count < max) {
+        struct addrinfo** cursor = want_first ? &next_first : &next_other;
+        while (*cursor && ((*cursor)->ai_family == first_family) != want_first)
+            *cursor = (*cursor)->ai_next;
+
+        if (!*cursor) {
+            /* this family is exhausted; finish with the other one. */
+            cursor = want_first ? &next_other : &next_first;
+            while (*cursor && ((*cursor)->ai_family == first_family) == want_first)
+                *cursor = (*cursor)->ai_next;
+            if (!*cursor)
+                break;
+            want_first = !want_first;
+        }
+
+        attempts[count].ai   = *cursor;
+        attempts[count].sock = BAD_SOCKET;
+        if (0 != getnameinfo((*cursor)->ai_addr, (optlen)(*cursor)->ai_addrlen, attempts[count].addr,
+            sizeof(attempts[count].addr), NULL, 0, NI_NUMERICHOST))
+            (void)snprintf(attempts[count].addr, sizeof(attempts[count].addr), "<unknown>");
+
+        count++;
+        *cursor    = (*cursor)->ai_next;
+        want_first = !want_first;
+    }
+
+    return count;
+}
+
+static void start_attempt(connect_attempt* attempt) {
+    attempt->started_ns = systest_monotonic_ns();
+    attempt->state      = ATTEMPT_FAILED;
+
+    attempt->sock = socket(attempt->ai->ai_family, attempt->ai->ai_socktype, attempt->ai->ai_protocol);
+    if (BAD_SOCKET == attempt->sock) {
+        attempt->err = _sock_errno();
+        return;
+    }
+
+    if (!set_nonblocking(attempt->sock)) {
+        attempt->err = _sock_errno();
+        _sock_close(attempt->sock);
+        attempt->sock = BAD_SOCKET;
+        return;
+    }
+
+    int conn = connect(attempt->sock, attempt->ai->ai_addr, (optlen)attempt->ai->ai_addrlen);
+    if (0 == conn) {
+        attempt->latency_ns = systest_monotonic_ns() - attempt->started_ns;
+        attempt->state      = ATTEMPT_CONNECTED;
+    } else if (SOCK_INPROGRESS == _sock_errno()) {
+        attempt->state = ATTEMPT_INFLIGHT;
+    } else {
+        attempt->err = _sock_errno();
+        _sock_close(attempt->sock);
+        attempt->sock = BAD_SOCKET;
+    }
+}
+
+bool systest_canconnect(const char* restrict host, const char* restrict port, int timeout_ms) {
+    if (!_validstr(host) || !_validstr(port) || timeout_ms <= 0)
+        return false;
 
-bool systest_haveinetconn(void) {
 #if defined(__WIN__)
     WSADATA wsad = { 0 };
     int ret = WSAStartup(MAKEWORD(2, 2), &wsad);
@@ -198,868 +686,8214 @@ bool systest_haveinetconn(void) {
 #endif
 
     struct addrinfo hints = {
-        .ai_flags = 0,
-        .ai_family = AF_INET,
+        .ai_flags = AI_ADDRCONFIG,
+        .ai_family = AF_UNSPEC,
         .ai_socktype = SOCK_STREAM
     };
 
     struct addrinfo* result = NULL;
-    int get = getaddrinfo(INET_TEST_HOST, INET_TEST_PORT, (const struct addrinfo*)&hints, &result);
+    uint64_t resolve_start = systest_monotonic_ns();
+    int get = getaddrinfo(host, port, (const struct addrinfo*)&hints, &result);
     if (0 != get) {
-        printf("getaddrinfo failed: %d (%s)!\n", get, gai_strerror(get));
+        systest_printf("getaddrinfo failed: %d (%s)!\n", get, gai_strerror(get));
+#if defined(__WIN__)
+        (void)WSACleanup();
+#endif
         return false;
     }
 
-    printf("getaddrinfo succeeded; creating a compatible socket...\n");
+    size_t num_addrs = 0;
+    for (struct addrinfo* cur = result; cur; cur = cur->ai_next)
+        num_addrs++;
 
-    bool conn_result = false;
-    struct addrinfo* cur = result;
-    do {
-        printf("trying socket(%d, %d, %d)...\n", AF_INET, cur->ai_socktype, cur->ai_protocol);
-        descriptor sock = socket(AF_INET, cur->ai_socktype, cur->ai_protocol);
-        if (sock == BAD_SOCKET) {
-            printf("socket failed: %d (%s)", errno, strerror(errno));
-        } else {
-            printf("got socket %d; trying connect...\n", (int)sock);
-            const struct timeval timeout = {5, 0};
-            int set = setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const void*)&timeout, sizeof(struct timeval));
-            if (set == -1) {
-                printf("setsockopt(SO_SNDTIMEO) failed: %d (%s)\n", errno, strerror(errno));
-            }
-            set = setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const void*)&timeout, sizeof(struct timeval));
-            if (set == -1) {
-                printf("setsockopt(SO_RCVTIMEO) failed: %d (%s)\n", errno, strerror(errno));
-            }
-            int conn = connect(sock, (const struct sockaddr*)cur->ai_addr, (optlen)cur->ai_addrlen);
-            if (conn == 0) {
-                printf("connected successfully!\n");
-                conn_result = true;
-                break;
-            } else {
-                printf("connect failed: %d (%s); trying next address...\n", errno, strerror(errno));
-            }
+    systest_printf("getaddrinfo('%s', '%s') returned %zu address(es) in %.3f ms\n", host, port,
+        num_addrs, (double)(systest_monotonic_ns() - resolve_start) / 1e6);
+
+    connect_attempt* attempts = calloc(num_addrs, sizeof(connect_attempt));
 #if !defined(__WIN__)
-            close(sock);
+    struct pollfd* fds = calloc(num_addrs, sizeof(struct pollfd));
 #else
-            closesocket(sock);
+    WSAPOLLFD* fds = calloc(num_addrs, sizeof(WSAPOLLFD));
 #endif
-        }
-        cur = cur->ai_next;
-    } while (cur != NULL);
-
-    freeaddrinfo(result);
-    result = NULL;
-
+    size_t* fd_owner = calloc(num_addrs, sizeof(size_t));
+    if (!attempts || !fds || !fd_owner) {
+        handle_error(errno, "calloc() failed!");
+        systest_safefree(&attempts);
+        systest_safefree(&fds);
+        systest_safefree(&fd_owner);
+        freeaddrinfo(result);
 #if defined(__WIN__)
-    (void)WSACleanup();
+        (void)WSACleanup();
 #endif
-
-    return conn_result;
-}
-
-bool check_get_hostname(void) {
-    char hname[SYSTEST_MAXHOST];
-    if (!systest_gethostname(hname))
-        return false;
-
-    if (!_validstr(hname)) {
-        printf(RED("gethostname returned an empty string!\n"));
-        return false;
-    }
-
-    printf("hostname = '%s'\n", hname);
-    return true;
-}
-
-bool check_get_uname(void) {
-    struct utsname name;
-    if (!systest_getuname(&name)) {
-        printf(RED("Couldn't get uname data!\n"));
         return false;
     }
 
-    printf("uname = '%s', '%s', '%s', '%s', '%s'\n", name.sysname, name.nodename,
-        name.release, name.version, name.machine);
-    return true;
-}
+    num_addrs = interleave_addrs(result, attempts, num_addrs);
 
-void check_build_env(void) {
-#if !defined(__WIN__)
-# if defined(__STDC_LIB_EXT1__)
-   printf("__STDC_LIB_EXT1__ is defined\n");
-# else
-   printf("__STDC_LIB_EXT1__ NOT defined\n");
-# endif
-# if defined(__GLIBC__)
-    printf("Using GNU libc version: %d.%d\n", __GLIBC__, __GLIBC_MINOR__);
-# else
-    printf("Not using GNU libc\n");
-# endif
-#else // __WIN__
-# if defined(__STDC_SECURE_LIB__)
-   printf("__STDC_SECURE_LIB__ is defined\n");
-# else
-   printf("__STDC_SECURE_LIB__ NOT defined\n");
-# endif
-#endif
-#if defined(__clang__)
-    printf("Using Clang %s\n", __clang_version__);
-#elif defined(__GNUC__)
-    printf("Using GCC %d.%d\n", __GNUC__, __GNUC_MINOR__);
-#elif defined(_MSC_VER)
-    printf("Using MSVC %lld\n", (long long)_MSC_FULL_VER);
-#else
-    printf("Using unknown toolset\n");
-#endif
-}
+    /* start a new attempt every SYSTEST_INET_ATTEMPT_DELAY_MS, or as soon as
+     * everything in flight has failed; the first to connect wins. */
+    const uint64_t delay_ns = SYSTEST_INET_ATTEMPT_DELAY_MS * 1000000ULL;
+    const uint64_t deadline = systest_monotonic_ns() + ((uint64_t)timeout_ms * 1000000ULL);
+    size_t next_attempt     = 0;
+    size_t winner           = num_addrs;
+    uint64_t next_start     = 0;
 
-void check_safefree(void) {
-    int *ptr = malloc(sizeof(int));
-    if (!ptr) {
-        handle_error(errno, "malloc() failed!");
-        return;
-    }
+    while (winner == num_addrs) {
+        uint64_t now = systest_monotonic_ns();
+        if (now >= deadline)
+            break;
 
-    *ptr = 1234;
-    systest_safefree(&ptr);
+        size_t inflight = 0;
+        for (size_t n = 0; n < next_attempt; n++) {
+            if (ATTEMPT_INFLIGHT == attempts[n].state)
+                inflight++;
+        }
 
-    if (!ptr)
-        printf("safe_free() does reset the pointer\n");
-    else
-        printf(RED("safe_free() does NOT reset the pointer!\n"));
-}
+        if (next_attempt < num_addrs && (now >= next_start || 0 == inflight)) {
+            start_attempt(&attempts[next_attempt]);
+            if (ATTEMPT_CONNECTED == attempts[next_attempt].state) {
+                winner = next_attempt;
+                break;
+            }
+            next_start = systest_monotonic_ns() + delay_ns;
+            next_attempt++;
+            continue;
+        }
 
-int main(void) {
+        if (0 == inflight)
+            break; /* nothing left to try. */
 
-    printf("\t" BLUEB("~~~~~~~~~~ <systest> ~~~~~~~~~~") "\n");
+        size_t nfds = 0;
+        for (size_t n = 0; n < next_attempt; n++) {
+            if (ATTEMPT_INFLIGHT != attempts[n].state)
+                continue;
+            fds[nfds].fd      = attempts[n].sock;
+            fds[nfds].events  = POLLOUT;
+            fds[nfds].revents = 0;
+            fd_owner[nfds++]  = n;
+        }
 
-    //
-    // begin environment tests
-    //
+        uint64_t wake = deadline;
+        if (next_attempt < num_addrs && next_start < wake)
+            wake = next_start;
+        int wait_ms = (int)((wake - now + 999999ULL) / 1000000ULL);
 
-    check_build_env();
+        int polled = _sock_poll(fds, nfds, wait_ms);
+        if (-1 == polled) {
+            if (EINTR == _sock_errno())
+                continue;
+            handle_error(_sock_errno(), "poll() failed!");
+            break;
+        }
 
-    //
-    // begin curiosity tests
-    //
+        for (size_t n = 0; n < nfds && polled > 0; n++) {
+            if (0 == fds[n].revents)
+                continue;
 
-    check_safefree();
+            connect_attempt* attempt = &attempts[fd_owner[n]];
+            attempt->latency_ns = systest_monotonic_ns() - attempt->started_ns;
 
-    //
-    // begin feature tests
-    //
+            int so_error = 0;
+            optlen len   = sizeof(so_error);
+            if (0 != getsockopt(attempt->sock, SOL_SOCKET, SO_ERROR, (void*)&so_error, &len))
+                so_error = _sock_errno();
 
-    // sysconf checks
-    bool ret = check_sysconf();
-    handle_result(ret, "sysconf()");
+            if (0 == so_error) {
+                attempt->state = ATTEMPT_CONNECTED;
+                if (winner == num_addrs)
+                    winner = fd_owner[n];
+            } else {
+                attempt->state = ATTEMPT_FAILED;
+                attempt->err   = so_error;
+                _sock_close(attempt->sock);
+                attempt->sock = BAD_SOCKET;
+            }
+        }
+    }
 
-    // system()
-    ret = check_system();
-    handle_result(ret, "system()");
+    for (size_t n = 0; n < num_addrs; n++) {
+        connect_attempt* attempt = &attempts[n];
+        const char* family = AF_INET6 == attempt->ai->ai_family ? "IPv6" : "IPv4";
 
-    // can you use a 'z' prefix in a printf-style specifier for size_t portably?
-    ret = check_z_printf();
-    handle_result(ret, "z prefix in *printf");
+        if (ATTEMPT_INFLIGHT == attempt->state) {
+            attempt->state      = ATTEMPT_ABANDONED;
+            attempt->latency_ns = systest_monotonic_ns() - attempt->started_ns;
+        } else if (ATTEMPT_CONNECTED == attempt->state && n != winner) {
+            attempt->state = ATTEMPT_ABANDONED;
+        }
 
-    //
-    // begin portability tests
-    //
+        switch (attempt->state) {
+            case ATTEMPT_CONNECTED:
+                systest_printf("%s %s: " LGREEN("connected") " in %.3f ms\n", family,
+                    attempt->addr, (double)attempt->latency_ns / 1e6);
+            break;
+            case ATTEMPT_FAILED:
+                systest_printf("%s %s: " RED("failed") " after %.3f ms: %d (%s)\n", family,
+                    attempt->addr, (double)attempt->latency_ns / 1e6, attempt->err,
+                    strerror(attempt->err));
+            break;
+            case ATTEMPT_ABANDONED:
+                systest_printf("%s %s: abandoned after %.3f ms\n", family, attempt->addr,
+                    (double)attempt->latency_ns / 1e6);
+            break;
+            case ATTEMPT_PENDING:
+            case ATTEMPT_INFLIGHT:
+            default:
+                systest_printf("%s %s: not attempted\n", family, attempt->addr);
+            break;
+        }
 
-    ret = check_filesystem_api();
-    handle_result(ret, "filesystem api");
+        if (BAD_SOCKET != attempt->sock)
+            _sock_close(attempt->sock);
+    }
 
-    ret = check_get_hostname();
-    handle_result(ret, "get hostname");
+    if (winner == num_addrs && systest_monotonic_ns() >= deadline)
+        systest_printf("no connection within %d ms\n", timeout_ms);
 
-    ret = check_get_uname();
-    handle_result(ret, "get uname");
+    bool conn_result = winner != num_addrs;
 
-    ret = systest_haveinetconn();
-    handle_result(ret, "test internet connection");
+    systest_safefree(&attempts);
+    systest_safefree(&fds);
+    systest_safefree(&fd_owner);
+    freeaddrinfo(result);
+    result = NULL;
 
-    int cpus = 0;
-    ret = systest_getcpucount(&cpus);
-    handle_result(ret, "get logical core count");
+#if defined(__WIN__)
+    (void)WSACleanup();
+#endif
 
-    if (num_succeeded != num_attempted)
-        printf("\t" REDB("--- %d/%d tests passed ---\n"), num_succeeded, num_attempted);
-    else
-        printf("\t" LGREENB("--- all %d tests passed! ---\n"), num_attempted);
+    return conn_result;
+}
 
-    printf("\t" BLUEB("~~~~~~~~~~ </systest> ~~~~~~~~~~") "\n");
+bool systest_haveinetconn(void) {
+    return systest_canconnect(INET_TEST_HOST, INET_TEST_PORT, SYSTEST_INET_TIMEOUT_MS);
+}
 
-    return num_succeeded > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+bool check_inet_conn(void) {
+    return systest_canconnect(opts.inet_host, opts.inet_port, (int)opts.inet_timeout);
 }
 
+#if defined(__HAVE_PTHREADS__)
+/** Lookups in flight at once in the resolver probe. */
+# define DNS_CONCURRENCY 16
+
+/** How long to wait for an answer when querying a server directly. */
+# define DNS_QUERY_TIMEOUT_MS 2000
+
+/** State shared by the resolver probe's threads. */
+typedef struct {
+    char** names;
+    size_t num_names;
+    size_t count;
+    atomic_size_t next;
+    uint64_t* latencies;  /**< Per lookup; lookup n is for names[n % num_names]. */
+    bool* ok;
+    const struct addrinfo* server; /**< NULL to use getaddrinfo(). */
+} dns_work;
+
+/** Encodes a standard recursive query for the A record of name; returns the
+ * length of the message, or 0 if name doesn't fit. */
+static size_t dns_build_query(uint8_t* buf, size_t size, const char* name, uint16_t id) {
+    static const uint8_t header[] = {0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    size_t len = 0;
+
+    if (size < 12 + strlen(name) + 2 + 4)
+        return 0;
+
+    buf[len++] = (uint8_t)(id >> 8);
+    buf[len++] = (uint8_t)(id & 0xff);
+    memcpy(buf + len, header, sizeof(header));
+    len += sizeof(header);
+
+    for (const char* label = name; *label; ) {
+        const char* dot = strchr(label, '.');
+        size_t label_len = dot ? (size_t)(dot - label) : strlen(label);
+        if (0 == label_len || label_len > 63)
+            return 0;
+        buf[len++] = (uint8_t)label_len;
+        memcpy(buf + len, label, label_len);
+        len += label_len;
+        label += label_len + (dot ? 1 : 0);
+    }
 
-//
-// portability test implementations
-//
+    buf[len++] = 0x00;
+    buf[len++] = 0x00; /* QTYPE A */
+    buf[len++] = 0x01;
+    buf[len++] = 0x00; /* QCLASS IN */
+    buf[len++] = 0x01;
+    return len;
+}
 
-bool systest_pathgetstat(const char* restrict path, struct stat* restrict st, systest_rel_to rel_to) {
-    if (!_validstr(path) || !_validptr(st))
+/** Sends a query to the server and waits for the matching answer. */
+static bool dns_query_direct(descriptor sock, const char* name, uint16_t id) {
+    uint8_t buf[512];
+    size_t len = dns_build_query(buf, sizeof(buf), name, id);
+    if (0 == len) {
+        self_log("can't encode name '%s'", name);
         return false;
+    }
 
-    memset(st, 0, sizeof(struct stat));
-
-    int stat_ret  = -1;
-    bool relative = false;
-    if (!systest_ispathrelative(path, &relative))
+    if (send(sock, buf, len, 0) != (ssize_t)len) {
+        handle_error(errno, "send() failed!");
         return false;
+    }
 
-    if (relative) {
-        char* base_path = NULL;
-        switch(rel_to) {
-            case SYSTEST_PATH_REL_TO_APP: base_path = systest_getappdir(); break;
-            case SYSTEST_PATH_REL_TO_CWD: base_path = systest_getcwd(); break;
-            default: self_log("invalid enum!"); return false;
-        }
+    uint64_t deadline = systest_monotonic_ns() + (DNS_QUERY_TIMEOUT_MS * 1000000ULL);
+    for (uint64_t now = systest_monotonic_ns(); now < deadline; now = systest_monotonic_ns()) {
+        struct pollfd pfd = {sock, POLLIN, 0};
+        int polled = poll(&pfd, 1, (int)((deadline - now + 999999ULL) / 1000000ULL));
+        if (polled <= 0) {
+            if (-1 == polled && EINTR == errno)
+                continue;
+            break;
+        }
 
-        if (!base_path) {
-            handle_error(errno, "couldn't get base path!");
-            return false;
+        ssize_t got = recv(sock, buf, sizeof(buf), 0);
+        if (-1 == got) {
+            if (EINTR == errno)
+                continue;
+            return false; /* e.g. ECONNREFUSED: nothing listening. */
         }
 
-#if !defined(__WIN__)
-# if defined(__MACOS__)
-        int open_flags = O_SEARCH;
-# elif defined(__linux__)
-        int open_flags = O_PATH | O_DIRECTORY;
-# elif defined(__BSD__)
-        int open_flags = O_EXEC | O_DIRECTORY;
-# endif
+        /* ignore stragglers from earlier queries that timed out. */
+        if (got < 12 || buf[0] != (uint8_t)(id >> 8) || buf[1] != (uint8_t)(id & 0xff) ||
+            0 == (buf[2] & 0x80))
+            continue;
 
-        int fd = open(base_path, open_flags);
-        if (-1 == fd) {
-            handle_error(errno, "open() failed!");
-            systest_safefree(&base_path);
-            return false;
+        return 0 == (buf[3] & 0x0f); /* RCODE NOERROR */
+    }
+
+    return false;
+}
+
+static void* dns_worker(void* arg) {
+    dns_work* work = (dns_work*)arg;
+    descriptor sock = BAD_SOCKET;
+
+    if (work->server) {
+        sock = socket(work->server->ai_family, SOCK_DGRAM, 0);
+        if (BAD_SOCKET == sock || 0 != connect(sock, work->server->ai_addr,
+            (optlen)work->server->ai_addrlen)) {
+            handle_error(errno, "can't set up a socket for the DNS server!");
+            if (BAD_SOCKET != sock)
+                _sock_close(sock);
+            return NULL;
         }
+    }
 
-        stat_ret = fstatat(fd, path, st, AT_SYMLINK_NOFOLLOW);
-        systest_safeclose(&fd);
-        systest_safefree(&base_path);
-    } else {
-        stat_ret = stat(path, st);
+    for (size_t n = atomic_fetch_add(&work->next, 1); n < work->count;
+        n = atomic_fetch_add(&work->next, 1)) {
+        const char* name = work->names[n % work->num_names];
+        uint64_t start   = systest_monotonic_ns();
+
+        if (work->server) {
+            work->ok[n] = dns_query_direct(sock, name, (uint16_t)(n & 0xffff));
+        } else {
+            struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+            struct addrinfo* result = NULL;
+            work->ok[n] = (0 == getaddrinfo(name, NULL, &hints, &result));
+            if (result)
+                freeaddrinfo(result);
+        }
+
+        work->latencies[n] = systest_monotonic_ns() - start;
     }
-#else // __WIN__
-        char abs_path[SYSTEST_MAXPATH] = { 0 };
-        snprintf(abs_path, SYSTEST_MAXPATH, "%s\\%s", base_path, path);
 
-        stat_ret = stat(abs_path, st);
-        systest_safefree(base_path);
+    if (BAD_SOCKET != sock)
+        _sock_close(sock);
+
+    return NULL;
+}
+
+/** Reports which caching resolvers appear to be configured on this host. */
+static void dns_print_cache_config(void) {
+    bool nscd = (0 == access("/var/run/nscd/socket", F_OK) || 0 == access("/run/nscd/socket", F_OK));
+    systest_printf("nscd socket: %s\n", nscd ? "present" : "absent");
+
+    bool resolved_stub = false;
+    FILE* resolv = fopen("/etc/resolv.conf", "r");
+    if (resolv) {
+        char line[256];
+        while (fgets(line, sizeof(line), resolv)) {
+            if (0 == strncmp(line, "nameserver", 10) && strstr(line, "127.0.0.53"))
+                resolved_stub = true;
+        }
+        (void)fclose(resolv);
+    }
+
+    bool resolved_nss = false;
+    FILE* nss = fopen("/etc/nsswitch.conf", "r");
+    if (nss) {
+        char line[256];
+        while (fgets(line, sizeof(line), nss)) {
+            if (0 == strncmp(line, "hosts:", 6)) {
+                line[strcspn(line, "\n")] = '\0';
+                systest_printf("nsswitch %s\n", line);
+                resolved_nss = (NULL != strstr(line, " resolve"));
+            }
+        }
+        (void)fclose(nss);
+    }
+
+    systest_printf("systemd-resolved: %s\n", resolved_nss ? "in use via nss-resolve" :
+        (resolved_stub ? "in use via the 127.0.0.53 stub" : "not in use"));
+}
+
+bool check_dns_resolver(void) {
+    size_t num_names = 0;
+    char** names     = split_list(opts.dns_names, &num_names);
+    if (0 == num_names) {
+        systest_printf(RED("no names to look up!") "\n");
+        systest_safefree(&names);
+        return false;
+    }
+
+    struct addrinfo* server = NULL;
+    if (_validstr(opts.dns_server)) {
+        /* [v6addr]:port, v4addr:port or just the address. */
+        char host[INET6_ADDRSTRLEN + 2] = {0};
+        const char* port = "53";
+        const char* colon = strrchr(opts.dns_server, ':');
+        const char* start = opts.dns_server;
+        size_t host_len   = strlen(start);
+        if ('[' == *start) {
+            const char* bracket = strchr(start, ']');
+            start++;
+            host_len = bracket ? (size_t)(bracket - start) : host_len - 1;
+            port = (bracket && ':' == bracket[1]) ? bracket + 2 : port;
+        } else if (colon && colon == strchr(start, ':')) {
+            host_len = (size_t)(colon - start);
+            port     = colon + 1;
+        }
+        (void)snprintf(host, sizeof(host), "%.*s", (int)host_len, start);
+
+        struct addrinfo hints = { .ai_flags = AI_NUMERICHOST | AI_NUMERICSERV, .ai_socktype = SOCK_DGRAM };
+        int get = getaddrinfo(host, port, &hints, &server);
+        if (0 != get) {
+            systest_printf(RED("invalid DNS server '%s': %s") "\n", opts.dns_server, gai_strerror(get));
+            systest_safefree(&names);
+            return false;
+        }
+        systest_printf("querying %s port %s directly\n", host, port);
     } else {
-        stat_ret = stat(path, st);
+        systest_printf("resolving with getaddrinfo()\n");
+        dns_print_cache_config();
+    }
+
+    size_t count = (size_t)opts.dns_lookups;
+    dns_work work = {
+        names, num_names, count, 0,
+        calloc(count, sizeof(uint64_t)),
+        calloc(count, sizeof(bool)),
+        server
+    };
+
+    bool passed = false;
+    if (!work.latencies || !work.ok) {
+        handle_error(errno, "calloc() failed!");
+        goto cleanup;
+    }
+
+    /* the first lookup of each name is the only one that can miss a cache:
+     * make those one at a time, so none of them overlaps a repeat. */
+    uint64_t start = systest_monotonic_ns();
+    size_t num_cold = count < num_names ? count : num_names;
+    work.count = num_cold;
+    (void)dns_worker(&work);
+
+    size_t nthreads = count - num_cold < DNS_CONCURRENCY ? count - num_cold : DNS_CONCURRENCY;
+    pthread_t threads[DNS_CONCURRENCY];
+    size_t started = 0;
+    work.count = count;
+    atomic_store(&work.next, num_cold);
+
+    for (; started < nthreads; started++) {
+        int ret = pthread_create(&threads[started], NULL, &dns_worker, &work);
+        if (0 != ret) {
+            handle_error(ret, "pthread_create() failed!");
+            break;
+        }
+    }
+
+    if (0 == started)
+        (void)dns_worker(&work);
+
+    for (size_t n = 0; n < started; n++)
+        (void)pthread_join(threads[n], NULL);
+
+    uint64_t elapsed = systest_monotonic_ns() - start;
+
+    size_t num_ok = 0;
+    for (size_t n = 0; n < count; n++)
+        num_ok += work.ok[n] ? 1 : 0;
+
+    systest_printf("%zu/%zu lookups of %zu name(s) succeeded in %.3f ms on %zu thread(s)\n",
+        num_ok, count, num_names, (double)elapsed / 1e6, started ? started : 1);
+
+    /* compare each name's first lookup with its own repeats; if most names
+     * get much faster, something between us and the network caches. */
+    uint64_t* warm = calloc(count, sizeof(uint64_t));
+    size_t num_names_warm = 0, num_names_cached = 0;
+    for (size_t i = 0; warm && i < num_cold; i++) {
+        size_t num_warm = 0;
+        for (size_t n = num_cold + i; n < count; n += num_names) {
+            if (work.ok[n])
+                warm[num_warm++] = work.latencies[n];
+        }
+        if (0 == num_warm || !work.ok[i])
+            continue;
+
+        systest_sortu64(warm, num_warm);
+        uint64_t warm_p50 = systest_percentile(warm, num_warm, 50.0);
+        bool cached = (warm_p50 * 4 < work.latencies[i]);
+        systest_printf("%s: first lookup = %.3f us, repeat p50 = %.3f us (n = %zu)%s\n", names[i],
+            (double)work.latencies[i] / 1e3, (double)warm_p50 / 1e3, num_warm, cached ? ", cached" : "");
+        num_names_warm++;
+        num_names_cached += cached ? 1 : 0;
+    }
+
+    print_latency_stats("all lookups", work.latencies, count);
+
+    if (num_names_warm > 0) {
+        systest_printf("%zu of %zu name(s) got much faster on repeat: %s\n", num_names_cached, num_names_warm,
+            (num_names_cached * 2 > num_names_warm) ? "answers appear to be cached" : "no sign of caching");
     }
+
+    systest_safefree(&warm);
+    passed = (num_ok == count);
+
+cleanup:
+    systest_safefree(&work.latencies);
+    systest_safefree(&work.ok);
+    systest_safefree(&names);
+    if (server)
+        freeaddrinfo(server);
+
+    return passed;
+}
 #endif
-    if (-1 == stat_ret) {
-        if (ENOENT == errno) {
-            st->st_size = SYSTEST_STAT_NONEXISTENT;
-            return true;
-        } else {
-            handle_error(errno, "stat() failed!");
+
+#if defined(__HAVE_PTHREADS__) && !defined(__WIN__)
+/** Size of the messages used for round-trip and datagram measurements. */
+# define LOOPBACK_MSG_SIZE 64
+
+/** Most round trips to keep samples for. */
+# define LOOPBACK_MAX_SAMPLES 262144
+
+/** A server end of the loopback benchmark, run on its own thread. */
+typedef struct {
+    descriptor sock;
+    int bufsize;          /**< SO_SNDBUF/SO_RCVBUF; 0 = system default. */
+    uint64_t bytes;
+    uint64_t messages;
+    atomic_bool stop;
+    atomic_bool failed;  /**< Set by either end. */
+} loopback_server;
+
+static void set_bufsize(descriptor sock, int bufsize) {
+    if (bufsize <= 0)
+        return;
+
+    if (0 != setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize)))
+        handle_error(errno, "setsockopt(SO_SNDBUF) failed!");
+    if (0 != setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize)))
+        handle_error(errno, "setsockopt(SO_RCVBUF) failed!");
+}
+
+/** Creates a socket bound to an ephemeral port on 127.0.0.1 (listening, for
+ * TCP); the address is stored in addr. */
+static descriptor loopback_socket(int type, int bufsize, struct sockaddr_in* addr) {
+    descriptor sock = socket(AF_INET, type, 0);
+    if (BAD_SOCKET == sock) {
+        handle_error(errno, "socket() failed!");
+        return BAD_SOCKET;
+    }
+
+    /* don't let a wedged peer hang the benchmark. */
+    const struct timeval timeout = {2, 0};
+    (void)setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    set_bufsize(sock, bufsize);
+
+    socklen_t len = sizeof(struct sockaddr_in);
+    memset(addr, 0, sizeof(struct sockaddr_in));
+    addr->sin_family      = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (0 != bind(sock, (struct sockaddr*)addr, len) ||
+        (SOCK_STREAM == type && 0 != listen(sock, 1)) ||
+        0 != getsockname(sock, (struct sockaddr*)addr, &len)) {
+        handle_error(errno, "can't set up loopback socket!");
+        _sock_close(sock);
+        return BAD_SOCKET;
+    }
+
+    return sock;
+}
+
+static descriptor loopback_connect(int type, int bufsize, const struct sockaddr_in* addr) {
+    descriptor sock = socket(AF_INET, type, 0);
+    if (BAD_SOCKET == sock) {
+        handle_error(errno, "socket() failed!");
+        return BAD_SOCKET;
+    }
+
+    const struct timeval timeout = {2, 0};
+    (void)setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    set_bufsize(sock, bufsize);
+
+    if (0 != connect(sock, (const struct sockaddr*)addr, sizeof(struct sockaddr_in))) {
+        handle_error(errno, "connect() failed!");
+        _sock_close(sock);
+        return BAD_SOCKET;
+    }
+
+    return sock;
+}
+
+/** Reads or writes exactly len bytes, unless the peer goes away. */
+static bool sock_xfer_all(descriptor sock, void* buf, size_t len, bool sending) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t ret = sending ? send(sock, (char*)buf + done, len - done, MSG_NOSIGNAL) :
+            recv(sock, (char*)buf + done, len - done, 0);
+        if (ret <= 0) {
+            if (-1 == ret && EINTR == errno)
+                continue;
             return false;
         }
+        done += (size_t)ret;
+    }
+    return true;
+}
+
+static void* loopback_sink(void* arg) {
+    loopback_server* server = (loopback_server*)arg;
+    descriptor conn = accept(server->sock, NULL, NULL);
+    if (BAD_SOCKET == conn) {
+        atomic_store(&server->failed, true);
+        return NULL;
+    }
+
+    size_t size = 256 * 1024;
+    char* buf = malloc(size);
+    if (!buf) {
+        atomic_store(&server->failed, true);
+        _sock_close(conn);
+        return NULL;
+    }
+
+    for (ssize_t got = recv(conn, buf, size, 0); got != 0; got = recv(conn, buf, size, 0)) {
+        if (got < 0) {
+            if (EINTR == errno)
+                continue;
+            atomic_store(&server->failed, true);
+            break;
+        }
+        server->bytes += (uint64_t)got;
+    }
+
+    free(buf);
+    _sock_close(conn);
+    return NULL;
+}
+
+static void* loopback_echo(void* arg) {
+    loopback_server* server = (loopback_server*)arg;
+    descriptor conn = accept(server->sock, NULL, NULL);
+    if (BAD_SOCKET == conn) {
+        atomic_store(&server->failed, true);
+        return NULL;
+    }
+
+    int nodelay = 1;
+    (void)setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    char msg[LOOPBACK_MSG_SIZE];
+    while (sock_xfer_all(conn, msg, sizeof(msg), false)) {
+        if (!sock_xfer_all(conn, msg, sizeof(msg), true)) {
+            atomic_store(&server->failed, true);
+            break;
+        }
+        server->messages++;
+    }
+
+    _sock_close(conn);
+    return NULL;
+}
+
+static void* loopback_datagram_sink(void* arg) {
+    loopback_server* server = (loopback_server*)arg;
+    const struct timeval timeout = {0, 50000};
+    (void)setsockopt(server->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    /* big enough for coalesced (GRO) datagrams. */
+    size_t size = 64 * 1024;
+    char* buf = malloc(size);
+    if (!buf) {
+        atomic_store(&server->failed, true);
+        return NULL;
+    }
+
+    while (!atomic_load(&server->stop)) {
+        ssize_t got = recv(server->sock, buf, size, 0);
+        if (got > 0) {
+            server->messages++;
+            server->bytes += (uint64_t)got;
+        }
     }
 
-    char* as_str = systest_stattostring(st);
-    if (as_str) {
-        printf("%s = %s\n", path, as_str);
-        systest_safefree(&as_str);
+    free(buf);
+    return NULL;
+}
+
+/** Starts a server thread on a loopback socket of the given type. */
+static bool loopback_start(loopback_server* server, pthread_t* thread, int type,
+    void* (*fn)(void*), struct sockaddr_in* addr) {
+    server->sock = loopback_socket(type, server->bufsize, addr);
+    if (BAD_SOCKET == server->sock)
+        return false;
+
+    int ret = pthread_create(thread, NULL, fn, server);
+    if (0 != ret) {
+        handle_error(ret, "pthread_create() failed!");
+        _sock_close(server->sock);
+        return false;
     }
 
     return true;
 }
 
-bool systest_pathexists(const char* restrict path, bool* restrict exists, systest_rel_to rel_to) {
-    if (!_validstr(path) || !_validptr(exists))
+/** Streams data over TCP for the benchmark duration; returns bytes/sec. */
+static double loopback_tcp_stream(int bufsize, uint64_t duration_ns) {
+    loopback_server server = {BAD_SOCKET, bufsize, 0, 0, false, false};
+    pthread_t thread;
+    struct sockaddr_in addr;
+    if (!loopback_start(&server, &thread, SOCK_STREAM, &loopback_sink, &addr))
+        return -1.0;
+
+    descriptor sock = loopback_connect(SOCK_STREAM, bufsize, &addr);
+    static char buf[64 * 1024];
+    uint64_t start = systest_monotonic_ns();
+
+    if (BAD_SOCKET != sock) {
+        while (systest_monotonic_ns() - start < duration_ns) {
+            if (!sock_xfer_all(sock, buf, sizeof(buf), true)) {
+                atomic_store(&server.failed, true);
+                break;
+            }
+        }
+        (void)shutdown(sock, SHUT_WR);
+    } else {
+        /* close() wouldn't wake accept() up; shutdown() does. The socket
+         * itself goes once the thread is done with it. */
+        (void)shutdown(server.sock, SHUT_RDWR);
+        atomic_store(&server.failed, true);
+    }
+
+    (void)pthread_join(thread, NULL);
+    uint64_t elapsed = systest_monotonic_ns() - start;
+
+    if (BAD_SOCKET != sock)
+        _sock_close(sock);
+    if (BAD_SOCKET != server.sock)
+        _sock_close(server.sock);
+
+    return atomic_load(&server.failed) ? -1.0 : (double)server.bytes / ((double)elapsed / 1e9);
+}
+
+/** Ping-pongs small messages over TCP with Nagle disabled; fills in the p50 and
+ * p99 round-trip time in nanoseconds. */
+static bool loopback_tcp_rtt(int bufsize, uint64_t duration_ns, uint64_t* p50, uint64_t* p99) {
+    uint64_t* samples = calloc(LOOPBACK_MAX_SAMPLES, sizeof(uint64_t));
+    if (!samples) {
+        handle_error(errno, "calloc() failed!");
         return false;
+    }
 
-    *exists = false;
+    loopback_server server = {BAD_SOCKET, bufsize, 0, 0, false, false};
+    pthread_t thread;
+    struct sockaddr_in addr;
+    if (!loopback_start(&server, &thread, SOCK_STREAM, &loopback_echo, &addr)) {
+        systest_safefree(&samples);
+        return false;
+    }
 
-    struct stat st = {0};
-    bool stat_ret  = systest_pathgetstat(path, &st, rel_to);
-    if (!stat_ret)
+    size_t count = 0;
+    descriptor sock = loopback_connect(SOCK_STREAM, bufsize, &addr);
+    if (BAD_SOCKET != sock) {
+        int nodelay = 1;
+        (void)setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        char msg[LOOPBACK_MSG_SIZE] = {0};
+        uint64_t start = systest_monotonic_ns();
+        while (count < LOOPBACK_MAX_SAMPLES) {
+            uint64_t sent = systest_monotonic_ns();
+            if (sent - start >= duration_ns)
+                break;
+            if (!sock_xfer_all(sock, msg, sizeof(msg), true) ||
+                !sock_xfer_all(sock, msg, sizeof(msg), false)) {
+                atomic_store(&server.failed, true);
+                break;
+            }
+            samples[count++] = systest_monotonic_ns() - sent;
+        }
+        _sock_close(sock);
+    } else {
+        (void)shutdown(server.sock, SHUT_RDWR);
+        atomic_store(&server.failed, true);
+    }
+
+    (void)pthread_join(thread, NULL);
+    if (BAD_SOCKET != server.sock)
+        _sock_close(server.sock);
+
+    systest_sortu64(samples, count);
+    *p50 = systest_percentile(samples, count, 50.0);
+    *p99 = systest_percentile(samples, count, 99.0);
+    systest_safefree(&samples);
+
+    return !atomic_load(&server.failed) && count > 0;
+}
+
+/** Blasts small datagrams over UDP; fills in packets/sec sent and received. */
+static bool loopback_udp_pps(int bufsize, uint64_t duration_ns, double* tx_pps, double* rx_pps) {
+    loopback_server server = {BAD_SOCKET, bufsize, 0, 0, false, false};
+    pthread_t thread;
+    struct sockaddr_in addr;
+    if (!loopback_start(&server, &thread, SOCK_DGRAM, &loopback_datagram_sink, &addr))
         return false;
 
-    *exists = (st.st_size != SYSTEST_STAT_NONEXISTENT);
-    return true;
+    uint64_t sent = 0;
+    uint64_t start = systest_monotonic_ns();
+    descriptor sock = loopback_connect(SOCK_DGRAM, bufsize, &addr);
+    if (BAD_SOCKET != sock) {
+        char msg[LOOPBACK_MSG_SIZE] = {0};
+        while (systest_monotonic_ns() - start < duration_ns) {
+            /* a full receive buffer shows up as ENOBUFS/ECONNREFUSED; that's
+             * just loss, which is what we're measuring. */
+            if (send(sock, msg, sizeof(msg), 0) == (ssize_t)sizeof(msg))
+                sent++;
+        }
+        _sock_close(sock);
+    } else {
+        atomic_store(&server.failed, true);
+    }
+
+    uint64_t elapsed = systest_monotonic_ns() - start;
+
+    /* give the receiver a moment to drain what's queued. */
+    struct timespec drain = {0, 20000000L};
+    (void)nanosleep(&drain, NULL);
+    atomic_store(&server.stop, true);
+    (void)pthread_join(thread, NULL);
+    _sock_close(server.sock);
+
+    *tx_pps = (double)sent / ((double)elapsed / 1e9);
+    *rx_pps = (double)server.messages / ((double)elapsed / 1e9);
+    return !atomic_load(&server.failed);
 }
 
-char* systest_getcwd(void) {
-#if !defined(__WIN__)
-# if defined(__linux__) && defined(_GNU_SOURCE)
-    char* cur = get_current_dir_name();
-    if (NULL == cur)
-        handle_error(errno, "");
-    return cur;
-# else
-    char* cur = getcwd(NULL, 0);
-    if (NULL == cur)
-        handle_error(errno, "");
-    return cur;
-# endif
-#else // __WIN__
-    char* cur = _getcwd(NULL, 0);
-    if (NULL == cur)
-        handle_error(errno, "");
-    return cur;
+bool check_loopback_bench(void) {
+    static const int bufsizes[] = {0, 16 * 1024, 128 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+    const uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL;
+    bool all_passed = true;
+
+    systest_printf("loopback benchmark: %ld ms per measurement, %d byte messages\n",
+        opts.bench_ms, LOOPBACK_MSG_SIZE);
+    systest_printf("%-10s %14s %14s %14s %14s %14s %8s\n", "buffer", "tcp MiB/s",
+        "rtt p50 us", "rtt p99 us", "udp tx kpps", "udp rx kpps", "loss");
+
+    for (size_t n = 0; n < __countof(bufsizes); n++) {
+        char label[16] = "default";
+        if (bufsizes[n] > 0)
+            (void)snprintf(label, sizeof(label), "%d KiB", bufsizes[n] / 1024);
+
+        double tcp = loopback_tcp_stream(bufsizes[n], duration_ns);
+        uint64_t p50 = 0, p99 = 0;
+        bool rtt_ok = loopback_tcp_rtt(bufsizes[n], duration_ns, &p50, &p99);
+        double tx_pps = 0.0, rx_pps = 0.0;
+        bool udp_ok = loopback_udp_pps(bufsizes[n], duration_ns, &tx_pps, &rx_pps);
+
+        all_passed &= (tcp >= 0.0) && rtt_ok && udp_ok;
+
+        systest_printf("%-10s %14.1f %14.3f %14.3f %14.1f %14.1f %7.2f%%\n", label,
+            tcp >= 0.0 ? tcp / (1024.0 * 1024.0) : 0.0, (double)p50 / 1e3, (double)p99 / 1e3,
+            tx_pps / 1e3, rx_pps / 1e3, tx_pps > 0.0 ? 100.0 * (1.0 - (rx_pps / tx_pps)) : 0.0);
+    }
+
+    return all_passed;
+}
 #endif
+
+#if defined(__linux__) && defined(__HAVE_PTHREADS__)
+/** Size of the file that zero-copy file->socket paths send from. */
+# define ZC_FILE_SIZE (16 * 1024 * 1024)
+
+/** Bytes handed to the kernel per call on the TCP paths. */
+# define ZC_CHUNK_SIZE (64 * 1024)
+
+/** UDP payload size, and how many datagrams are batched per call. */
+# define ZC_DGRAM_SIZE 1400
+# define ZC_DGRAM_BATCH 32
+
+typedef enum {
+    ZC_TCP_SEND = 0,
+    ZC_TCP_READ_SEND,
+    ZC_TCP_SENDFILE,
+    ZC_TCP_SPLICE,
+    ZC_TCP_VMSPLICE,
+    ZC_TCP_MSG_ZEROCOPY,
+    ZC_UDP_SEND,
+    ZC_UDP_SENDMMSG,
+    ZC_UDP_GSO,
+    ZC_UDP_GRO
+} zc_method;
+
+static const struct {
+    zc_method method;
+    const char* const name;
+    const char* const baseline; /**< What it's compared with. */
+} zc_methods[] = {
+    {ZC_TCP_SEND, "send()", NULL},
+    {ZC_TCP_READ_SEND, "read()+send()", NULL},
+    {ZC_TCP_SENDFILE, "sendfile()", "read()+send()"},
+    {ZC_TCP_SPLICE, "splice()", "read()+send()"},
+    {ZC_TCP_VMSPLICE, "vmsplice()+splice()", "send()"},
+    {ZC_TCP_MSG_ZEROCOPY, "MSG_ZEROCOPY", "send()"},
+    {ZC_UDP_SEND, "udp send()", NULL},
+    {ZC_UDP_SENDMMSG, "udp sendmmsg()/recvmmsg()", "udp send()"},
+    {ZC_UDP_GSO, "udp UDP_SEGMENT", "udp send()"},
+    {ZC_UDP_GRO, "udp UDP_SEGMENT+UDP_GRO", "udp send()"},
+};
+
+/** Outcome of one zero-copy measurement. */
+typedef struct {
+    bool supported;
+    int err;              /**< Why it isn't, if not. */
+    uint64_t bytes;       /**< Delivered to the receiver. */
+    uint64_t wall_ns;
+    uint64_t cpu_ns;      /**< Both ends; the whole process. */
+    uint64_t copied;      /**< MSG_ZEROCOPY sends the kernel copied anyway. */
+} zc_result;
+
+static uint64_t process_cpu_ns(void) {
+    struct timespec ts = {0};
+    if (0 != clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts))
+        return 0;
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
 }
 
-char* systest_getappfilename(void) {
+static bool zc_unsupported(int err) {
+    return EINVAL == err || ENOSYS == err || EOPNOTSUPP == err || ENOPROTOOPT == err ||
+        EPERM == err;
+}
 
-    char* buffer = (char*)calloc(SYSTEST_MAXPATH, sizeof(char));
-    if (NULL == buffer) {
-        handle_error(errno, "");
+/** Receives datagrams in batches with recvmmsg(). */
+static void* zc_mmsg_sink(void* arg) {
+    loopback_server* server = (loopback_server*)arg;
+    const struct timeval timeout = {0, 50000};
+    (void)setsockopt(server->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char (*bufs)[ZC_DGRAM_SIZE] = malloc(ZC_DGRAM_BATCH * sizeof(*bufs));
+    if (!bufs) {
+        atomic_store(&server->failed, true);
         return NULL;
     }
 
-    bool resolved = false;
-    size_t size   = SYSTEST_MAXPATH;
-    bool grow     = false;
+    struct iovec iov[ZC_DGRAM_BATCH];
+    struct mmsghdr msgs[ZC_DGRAM_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (size_t n = 0; n < ZC_DGRAM_BATCH; n++) {
+        iov[n].iov_base = bufs[n];
+        iov[n].iov_len  = ZC_DGRAM_SIZE;
+        msgs[n].msg_hdr.msg_iov    = &iov[n];
+        msgs[n].msg_hdr.msg_iovlen = 1;
+    }
 
-    do {
-        if (grow) {
-            systest_safefree(&buffer);
+    while (!atomic_load(&server->stop)) {
+        int got = recvmmsg(server->sock, msgs, ZC_DGRAM_BATCH, 0, NULL);
+        for (int n = 0; n < got; n++) {
+            server->messages++;
+            server->bytes += msgs[n].msg_len;
+        }
+    }
 
-            buffer = (char*)calloc(size, sizeof(char));
-            if (NULL == buffer) {
-                handle_error(errno, "");
-                resolved = false;
-                break;
-            }
+    free(bufs);
+    return NULL;
+}
 
-            grow = false;
-        }
+/** Reaps MSG_ZEROCOPY completions; counts those where the kernel had to copy. */
+static void zc_reap_completions(descriptor sock, uint64_t* copied) {
+    for (;;) {
+        char control[128];
+        struct msghdr msg = {0};
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
 
-#if !defined(__WIN__)
-# if defined(__linux__)
-#  if defined(__HAVE_UNISTD_READLINK__)
-        ssize_t read = readlink("/proc/self/exe", buffer, size);
-        self_log("readlink() returned: %ld (size = %zu)", read, size);
-        if (-1 != read && read < (ssize_t)size) {
-            resolved = true;
-            break;
-        } else {
-            if (-1 == read) {
-                handle_error(errno, "");
-                resolved = false;
-                break;
-            } else if (read >= (ssize_t)size) {
-                /* readlink, like Windows' impl, doesn't have a concept
-                * of letting you know how much larger your buffer needs
-                * to be; it just truncates the string and returns how
-                * many chars it wrote there. */
-                size += SYSTEST_PATH_BUFFER_GROW_BY;
-                grow = true;
+        if (-1 == recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT))
+            return;
+
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (!((SOL_IP == cm->cmsg_level && IP_RECVERR == cm->cmsg_type) ||
+                  (SOL_IPV6 == cm->cmsg_level && IPV6_RECVERR == cm->cmsg_type)))
                 continue;
-            }
+
+            struct sock_extended_err ee;
+            memcpy(&ee, CMSG_DATA(cm), sizeof(ee));
+            if (SO_EE_ORIGIN_ZEROCOPY == ee.ee_origin && 0 != (ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED))
+                *copied += (uint64_t)(ee.ee_data - ee.ee_info) + 1;
         }
-#  else
-#   error "unable to resolve readlink(); see man readlink and its feature test macro requirements."
-#  endif
-# elif defined(__FreeBSD__)
-        int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PATHNAME, -1 };
-        int ret = sysctl(mib, 4, buffer, &size, NULL, 0);
-        self_log("sysctl() returned: %d (size = %zu)", ret, size);
-        if (0 == ret) {
-            resolved = true;
-            break;
+    }
+}
+
+/** Pushes data through one send path for the benchmark duration. */
+static void zc_run(zc_method method, int file_fd, uint64_t duration_ns, zc_result* result) {
+    static char buf[ZC_DGRAM_BATCH * ZC_DGRAM_SIZE > ZC_CHUNK_SIZE ?
+        ZC_DGRAM_BATCH * ZC_DGRAM_SIZE : ZC_CHUNK_SIZE];
+    const bool udp = method >= ZC_UDP_SEND;
+
+    memset(result, 0, sizeof(zc_result));
+    result->supported = true;
+
+    loopback_server server = {BAD_SOCKET, 0, 0, 0, false, false};
+    pthread_t thread;
+    struct sockaddr_in addr;
+    void* (*sink)(void*) = !udp ? &loopback_sink :
+        (ZC_UDP_SENDMMSG == method ? &zc_mmsg_sink : &loopback_datagram_sink);
+    if (!loopback_start(&server, &thread, udp ? SOCK_DGRAM : SOCK_STREAM, sink, &addr)) {
+        result->supported = false;
+        result->err = errno;
+        return;
+    }
+
+    if (ZC_UDP_GRO == method) {
+        int on = 1;
+        if (0 != setsockopt(server.sock, SOL_UDP, UDP_GRO, &on, sizeof(on))) {
+            result->supported = false;
+            result->err = errno;
+        }
+    }
+
+    descriptor sock = loopback_connect(udp ? SOCK_DGRAM : SOCK_STREAM, 0, &addr);
+    int pipefd[2] = {-1, -1};
+
+    if (BAD_SOCKET == sock) {
+        result->supported = false;
+        result->err = errno;
+    } else if (ZC_TCP_SPLICE == method || ZC_TCP_VMSPLICE == method) {
+        if (0 != pipe(pipefd)) {
+            result->supported = false;
+            result->err = errno;
         } else {
-            handle_error(errno, "");
-            resolved = false;
+            (void)fcntl(pipefd[1], F_SETPIPE_SZ, ZC_CHUNK_SIZE);
+        }
+    } else if (ZC_TCP_MSG_ZEROCOPY == method) {
+        int on = 1;
+        if (0 != setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on))) {
+            result->supported = false;
+            result->err = errno;
+        }
+    } else if (ZC_UDP_GSO == method || ZC_UDP_GRO == method) {
+        int gso_size = ZC_DGRAM_SIZE;
+        if (0 != setsockopt(sock, SOL_UDP, UDP_SEGMENT, &gso_size, sizeof(gso_size))) {
+            result->supported = false;
+            result->err = errno;
+        }
+    }
+
+    struct iovec iov[ZC_DGRAM_BATCH];
+    struct mmsghdr msgs[ZC_DGRAM_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (size_t n = 0; n < ZC_DGRAM_BATCH; n++) {
+        iov[n].iov_base = buf + (n * ZC_DGRAM_SIZE);
+        iov[n].iov_len  = ZC_DGRAM_SIZE;
+        msgs[n].msg_hdr.msg_iov    = &iov[n];
+        msgs[n].msg_hdr.msg_iovlen = 1;
+    }
+
+    off_t offset       = 0;
+    uint64_t cpu_start = process_cpu_ns();
+    uint64_t start     = systest_monotonic_ns();
+
+    while (result->supported && systest_monotonic_ns() - start < duration_ns) {
+        ssize_t ret = 0;
+
+        if (!udp && (ZC_TCP_SENDFILE == method || ZC_TCP_SPLICE == method ||
+            ZC_TCP_READ_SEND == method) && offset >= ZC_FILE_SIZE)
+            offset = 0;
+
+        switch (method) {
+            case ZC_TCP_SEND:
+                ret = sock_xfer_all(sock, buf, ZC_CHUNK_SIZE, true) ? 1 : -1;
+            break;
+            case ZC_TCP_READ_SEND:
+                ret = pread(file_fd, buf, ZC_CHUNK_SIZE, offset);
+                if (ret > 0) {
+                    offset += ret;
+                    ret = sock_xfer_all(sock, buf, (size_t)ret, true) ? ret : -1;
+                }
+            break;
+            case ZC_TCP_SENDFILE:
+                ret = sendfile(sock, file_fd, &offset, ZC_CHUNK_SIZE);
+            break;
+            case ZC_TCP_SPLICE:
+            case ZC_TCP_VMSPLICE:
+                if (ZC_TCP_SPLICE == method) {
+                    loff_t off = offset;
+                    ret = splice(file_fd, &off, pipefd[1], NULL, ZC_CHUNK_SIZE, SPLICE_F_MOVE);
+                    offset = (off_t)off;
+                } else {
+                    struct iovec vec = {buf, ZC_CHUNK_SIZE};
+                    ret = vmsplice(pipefd[1], &vec, 1, 0);
+                }
+                for (ssize_t left = ret; left > 0; ) {
+                    ssize_t moved = splice(pipefd[0], NULL, sock, NULL, (size_t)left,
+                        SPLICE_F_MOVE | SPLICE_F_MORE);
+                    if (moved <= 0) {
+                        ret = -1;
+                        break;
+                    }
+                    left -= moved;
+                }
+            break;
+            case ZC_TCP_MSG_ZEROCOPY:
+                ret = send(sock, buf, ZC_CHUNK_SIZE, MSG_ZEROCOPY | MSG_NOSIGNAL);
+                if (-1 == ret && ENOBUFS == errno) {
+                    /* out of optmem: wait for completions to free some up. */
+                    struct pollfd pfd = {sock, 0, 0};
+                    (void)poll(&pfd, 1, 10);
+                    ret = 0;
+                }
+                zc_reap_completions(sock, &result->copied);
+            break;
+            case ZC_UDP_SEND:
+                for (size_t n = 0; n < ZC_DGRAM_BATCH && ret >= 0; n++)
+                    ret = send(sock, buf, ZC_DGRAM_SIZE, 0);
+            break;
+            case ZC_UDP_SENDMMSG:
+                ret = sendmmsg(sock, msgs, ZC_DGRAM_BATCH, 0);
+            break;
+            case ZC_UDP_GSO:
+            case ZC_UDP_GRO:
+                ret = send(sock, buf, ZC_DGRAM_BATCH * ZC_DGRAM_SIZE, 0);
+            break;
+            default:
+                ret = -1;
             break;
         }
-# elif defined(__APPLE__)
-        int ret = _NSGetExecutablePath(buffer, (uint32_t*)&size);
-        if (0 == ret) {
-            resolved = true;
+
+        if (-1 == ret) {
+            /* a receiver that can't keep up isn't a failure of the path. */
+            if (udp && (ENOBUFS == errno || ECONNREFUSED == errno || EAGAIN == errno))
+                continue;
+            result->err       = errno;
+            result->supported = false;
+            if (!zc_unsupported(result->err))
+                handle_error(result->err, "send path failed!");
             break;
-        } else if (-1 == ret) {
-            grow = true;
+        }
+    }
+
+    if (BAD_SOCKET != sock) {
+        if (ZC_TCP_MSG_ZEROCOPY == method) {
+            /* completions that arrive after this are simply dropped. */
+            zc_reap_completions(sock, &result->copied);
+        }
+        if (!udp)
+            (void)shutdown(sock, SHUT_WR);
+        else
+            atomic_store(&server.stop, true);
+    } else {
+        /* wakes accept(); the socket is closed after the join. */
+        (void)shutdown(server.sock, SHUT_RDWR);
+        atomic_store(&server.stop, true);
+    }
+
+    (void)pthread_join(thread, NULL);
+    if (atomic_load(&server.failed) && result->supported) {
+        handle_error(EIO, "receiver failed!");
+        result->err       = EIO;
+        result->supported = false;
+    }
+    result->wall_ns = systest_monotonic_ns() - start;
+    result->cpu_ns  = process_cpu_ns() - cpu_start;
+    result->bytes   = server.bytes;
+
+    if (BAD_SOCKET != sock)
+        _sock_close(sock);
+    if (BAD_SOCKET != server.sock)
+        _sock_close(server.sock);
+    systest_safeclose(&pipefd[0]);
+    systest_safeclose(&pipefd[1]);
+}
+
+bool check_zerocopy_bench(void) {
+    const uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL;
+    zc_result results[__countof(zc_methods)];
+
+    char path[] = "/tmp/systest-zc-XXXXXX";
+    int file_fd = mkstemp(path);
+    if (-1 == file_fd) {
+        handle_error(errno, "mkstemp() failed!");
+        return false;
+    }
+    (void)unlink(path);
+
+    static char chunk[ZC_CHUNK_SIZE];
+    memset(chunk, 0x5a, sizeof(chunk));
+    for (size_t written = 0; written < ZC_FILE_SIZE; written += sizeof(chunk)) {
+        if (write(file_fd, chunk, sizeof(chunk)) != (ssize_t)sizeof(chunk)) {
+            handle_error(errno, "write() failed!");
+            systest_safeclose(&file_fd);
+            return false;
+        }
+    }
+
+    systest_printf("zero-copy benchmark: %ld ms per path over loopback; cpu is for both ends\n",
+        opts.bench_ms);
+    systest_printf("%-26s %-12s %12s %12s  %s\n", "path", "supported", "MiB/s", "cpu s/GiB", "speedup");
+
+    for (size_t n = 0; n < __countof(zc_methods); n++) {
+        zc_run(zc_methods[n].method, file_fd, duration_ns, &results[n]);
+
+        const zc_result* res = &results[n];
+        if (!res->supported || 0 == res->bytes) {
+            systest_printf("%-26s " YELLOW("%-12s") " (%d, %s)\n", zc_methods[n].name, "no",
+                res->err, strerror(res->err));
+            continue;
+        }
+
+        double gib  = (double)res->bytes / (1024.0 * 1024.0 * 1024.0);
+        double rate = (double)res->bytes / ((double)res->wall_ns / 1e9);
+
+        char vs[48] = "";
+        for (size_t b = 0; b < n && zc_methods[n].baseline; b++) {
+            if (0 == strcmp(zc_methods[b].name, zc_methods[n].baseline) && results[b].supported &&
+                results[b].bytes > 0) {
+                double base = (double)results[b].bytes / ((double)results[b].wall_ns / 1e9);
+                (void)snprintf(vs, sizeof(vs), "%.2fx vs %s", rate / base, zc_methods[b].name);
+            }
+        }
+
+        systest_printf("%-26s %-12s %12.1f %12.3f  %s\n", zc_methods[n].name, "yes",
+            rate / (1024.0 * 1024.0), ((double)res->cpu_ns / 1e9) / gib, vs);
+
+        if (ZC_TCP_MSG_ZEROCOPY == zc_methods[n].method && res->copied > 0)
+            systest_printf("  (%"PRIu64" MSG_ZEROCOPY sends were copied by the kernel anyway,"
+                " as is normal on loopback)\n", res->copied);
+    }
+
+    systest_safeclose(&file_fd);
+
+    /* plain send() has to work; everything else is a capability report. */
+    return results[ZC_TCP_SEND].supported && results[ZC_UDP_SEND].supported;
+}
+#endif
+
+bool check_get_hostname(void) {
+    char hname[SYSTEST_MAXHOST];
+    if (!systest_gethostname(hname))
+        return false;
+
+    if (!_validstr(hname)) {
+        systest_printf(RED("gethostname returned an empty string!\n"));
+        return false;
+    }
+
+    systest_printf("hostname = '%s'\n", hname);
+    return true;
+}
+
+bool check_get_uname(void) {
+    struct utsname name;
+    if (!systest_getuname(&name)) {
+        systest_printf(RED("Couldn't get uname data!\n"));
+        return false;
+    }
+
+    systest_printf("uname = '%s', '%s', '%s', '%s', '%s'\n", name.sysname, name.nodename,
+        name.release, name.version, name.machine);
+    return true;
+}
+
+#if defined(__HAVE_IO_URING__)
+/** Reports the kernel.io_uring_disabled sysctl, if the kernel has it. */
+static void print_uring_sysctl(void) {
+    FILE* f = fopen("/proc/sys/kernel/io_uring_disabled", "r");
+    if (!f) {
+        systest_printf("kernel.io_uring_disabled: n/a\n");
+        return;
+    }
+
+    int disabled = -1;
+    if (1 == fscanf(f, "%d", &disabled)) {
+        systest_printf("kernel.io_uring_disabled: %d (%s)\n", disabled, 0 == disabled ? "enabled" :
+            (1 == disabled ? "only for io_uring_group" : "disabled"));
+    }
+    (void)fclose(f);
+}
+
+bool check_uring(void) {
+    print_uring_sysctl();
+
+    systest_uring ring;
+    if (!systest_uring_init(&ring, 8)) {
+        int err = errno;
+        systest_printf(YELLOW("io_uring_setup() failed: %d (%s)") "%s\n", err, strerror(err),
+            (ENOSYS == err || EPERM == err) ? "; disabled by sysctl or blocked by seccomp?" : "");
+        /* not being able to use it is an answer, not a failure. */
+        return ENOSYS == err || EPERM == err;
+    }
+
+    systest_printf("io_uring is usable; features = 0x%x, sq entries = %u, cq entries = %u\n",
+        ring.params.features, ring.params.sq_entries, ring.params.cq_entries);
+
+    bool supported[256];
+    unsigned last_op = 0;
+    if (!systest_uring_probeops(&ring, supported, &last_op)) {
+        systest_printf(YELLOW("IORING_REGISTER_PROBE failed: %d (%s)") "\n", errno, strerror(errno));
+        systest_uring_free(&ring);
+        return true;
+    }
+
+    /* a NOP round trip proves submission and completion actually work. */
+    bool nop_ok = false;
+    struct io_uring_sqe* sqe = systest_uring_getsqe(&ring);
+    if (sqe) {
+        struct io_uring_cqe cqe;
+        sqe->opcode = IORING_OP_NOP;
+        nop_ok = (1 == systest_uring_submit(&ring, 1)) &&
+            systest_uring_getcqe(&ring, &cqe, true) && 0 == cqe.res;
+    }
+    systest_printf("NOP round trip: %s\n", nop_ok ? "ok" : RED("failed"));
+
+    size_t num_supported = 0;
+    char line[96] = {0};
+    size_t line_len = 0;
+    systest_printf("supported opcodes (last_op = %u):\n", last_op);
+    for (unsigned op = 0; op < last_op && op < 256; op++) {
+        if (!supported[op])
+            continue;
+        num_supported++;
+        char unknown[16];
+        const char* name = systest_uring_opname(op);
+        if (!name) {
+            (void)snprintf(unknown, sizeof(unknown), "op%u", op);
+            name = unknown;
+        }
+        if (line_len + strlen(name) + 1 >= 80) {
+            systest_printf("  %s\n", line);
+            line_len = 0;
+        }
+        line_len += (size_t)snprintf(line + line_len, sizeof(line) - line_len, "%s ", name);
+    }
+    if (line_len > 0)
+        systest_printf("  %s\n", line);
+
+    if (num_supported < last_op)
+        systest_printf("%zu of %u opcodes are not supported\n", (size_t)last_op - num_supported, last_op);
+
+    systest_uring_free(&ring);
+    return nop_ok;
+}
+
+/** Size of the file read by the io_uring benchmark. */
+# define URING_BENCH_FILE_SIZE (64 * 1024 * 1024)
+# define URING_BENCH_BLOCK 4096
+# define URING_BENCH_MAX_QD 256
+
+/** Random 4 KiB reads with pread(); returns IOPS. */
+static double uring_bench_pread(int fd, uint64_t duration_ns, char* buf) {
+    uint64_t rng = 0x9e3779b97f4a7c15ULL, ops = 0;
+    const uint64_t blocks = URING_BENCH_FILE_SIZE / URING_BENCH_BLOCK;
+    uint64_t start = systest_monotonic_ns();
+
+    while (systest_monotonic_ns() - start < duration_ns) {
+        off_t off = (off_t)((systest_rand64(&rng) % blocks) * URING_BENCH_BLOCK);
+        if (URING_BENCH_BLOCK != pread(fd, buf, URING_BENCH_BLOCK, off)) {
+            handle_error(errno, "pread() failed!");
+            return -1.0;
+        }
+        ops++;
+    }
+
+    return (double)ops / ((double)(systest_monotonic_ns() - start) / 1e9);
+}
+
+/** Keeps qd reads or writes (opcode) of block bytes in flight on the ring for
+ * the duration, at random or sequential offsets within the first file_size
+ * bytes of fd; bufs must hold qd blocks. Returns operations per second. */
+static double uring_run_io(systest_uring* ring, int fd, uint8_t opcode, size_t block,
+    uint64_t file_size, bool sequential, unsigned qd, uint64_t duration_ns, char* bufs) {
+    uint64_t rng = 0x9e3779b97f4a7c15ULL, ops = 0, next_off = 0;
+    const uint64_t blocks = file_size / block;
+    unsigned inflight = 0;
+    bool draining = false, failed = false;
+    uint64_t start = systest_monotonic_ns();
+
+    for (uint64_t slot = 0; !draining || inflight > 0; ) {
+        /* top up to qd, then wait for at least one completion. */
+        while (!draining && inflight < qd && slot < qd) {
+            struct io_uring_sqe* sqe = systest_uring_getsqe(ring);
+            if (!sqe)
+                break;
+            sqe->opcode    = opcode;
+            sqe->fd        = fd;
+            sqe->addr      = (uint64_t)(uintptr_t)(bufs + (slot * block));
+            sqe->len       = (uint32_t)block;
+            sqe->off       = (sequential ? (next_off++ % blocks) : (systest_rand64(&rng) % blocks)) * block;
+            sqe->user_data = slot++;
+            inflight++;
+        }
+
+        if (-1 == systest_uring_submit(ring, 1)) {
+            handle_error(errno, "io_uring_enter() failed!");
+            return -1.0;
+        }
+
+        draining |= (systest_monotonic_ns() - start >= duration_ns);
+
+        struct io_uring_cqe cqe;
+        while (systest_uring_getcqe(ring, &cqe, false)) {
+            inflight--;
+            if ((int)block != cqe.res) {
+                failed = draining = true;
+                if (cqe.res < 0)
+                    handle_error(-cqe.res, "io_uring read/write failed!");
+                continue;
+            }
+            ops++;
+
+            if (draining)
+                continue;
+
+            struct io_uring_sqe* sqe = systest_uring_getsqe(ring);
+            sqe->opcode    = opcode;
+            sqe->fd        = fd;
+            sqe->addr      = (uint64_t)(uintptr_t)(bufs + (cqe.user_data * block));
+            sqe->len       = (uint32_t)block;
+            sqe->off       = (sequential ? (next_off++ % blocks) : (systest_rand64(&rng) % blocks)) * block;
+            sqe->user_data = cqe.user_data;
+            inflight++;
+        }
+    }
+
+    return failed ? -1.0 : (double)ops / ((double)(systest_monotonic_ns() - start) / 1e9);
+}
+
+/** Bounces a small message around nsocks socket pairs with epoll_wait()
+ * plus read()/write(); returns messages per second. */
+static double uring_bench_epoll(int (*pairs)[2], unsigned nsocks, uint64_t duration_ns) {
+    int epfd = epoll_create1(0);
+    if (-1 == epfd) {
+        handle_error(errno, "epoll_create1() failed!");
+        return -1.0;
+    }
+
+    char msg[64] = {0};
+    for (unsigned n = 0; n < nsocks; n++) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = n };
+        if (-1 == epoll_ctl(epfd, EPOLL_CTL_ADD, pairs[n][0], &ev) ||
+            (ssize_t)sizeof(msg) != write(pairs[n][1], msg, sizeof(msg))) {
+            handle_error(errno, "can't set up epoll benchmark!");
+            systest_safeclose(&epfd);
+            return -1.0;
+        }
+    }
+
+    uint64_t ops = 0;
+    struct epoll_event events[64];
+    uint64_t start = systest_monotonic_ns();
+    while (systest_monotonic_ns() - start < duration_ns) {
+        int ready = epoll_wait(epfd, events, (int)__countof(events), 1000);
+        for (int e = 0; e < ready; e++) {
+            unsigned n = events[e].data.u32;
+            if ((ssize_t)sizeof(msg) != read(pairs[n][0], msg, sizeof(msg)) ||
+                (ssize_t)sizeof(msg) != write(pairs[n][1], msg, sizeof(msg))) {
+                handle_error(errno, "read()/write() failed!");
+                systest_safeclose(&epfd);
+                return -1.0;
+            }
+            ops++;
+        }
+    }
+
+    double rate = (double)ops / ((double)(systest_monotonic_ns() - start) / 1e9);
+
+    /* leave the sockets empty for the next run. */
+    for (unsigned n = 0; n < nsocks; n++) {
+        ssize_t drained = read(pairs[n][0], msg, sizeof(msg));
+        (void)drained;
+    }
+
+    systest_safeclose(&epfd);
+    return rate;
+}
+
+/** The same as uring_bench_epoll(), but with every recv and send going through
+ * the ring, so each batch of completions costs one system call. */
+static double uring_bench_sockets(systest_uring* ring, int (*pairs)[2], unsigned nsocks,
+    uint64_t duration_ns) {
+    static char msgs[URING_BENCH_MAX_QD][64];
+
+    for (unsigned n = 0; n < nsocks; n++) {
+        if ((ssize_t)sizeof(msgs[n]) != write(pairs[n][1], msgs[n], sizeof(msgs[n]))) {
+            handle_error(errno, "write() failed!");
+            return -1.0;
+        }
+        struct io_uring_sqe* sqe = systest_uring_getsqe(ring);
+        sqe->opcode    = IORING_OP_RECV;
+        sqe->fd        = pairs[n][0];
+        sqe->addr      = (uint64_t)(uintptr_t)msgs[n];
+        sqe->len       = sizeof(msgs[n]);
+        sqe->user_data = n;
+    }
+
+    /* user_data: socket index for recvs; with the top bit set for sends. */
+    const uint64_t send_bit = 1ULL << 63;
+    uint64_t ops = 0;
+    unsigned inflight = nsocks;
+    bool draining = false, failed = false;
+    uint64_t start = systest_monotonic_ns();
+
+    while (inflight > 0) {
+        if (-1 == systest_uring_submit(ring, 1)) {
+            handle_error(errno, "io_uring_enter() failed!");
+            return -1.0;
+        }
+
+        draining |= (systest_monotonic_ns() - start >= duration_ns);
+
+        struct io_uring_cqe cqe;
+        while (systest_uring_getcqe(ring, &cqe, false)) {
+            inflight--;
+            unsigned n = (unsigned)(cqe.user_data & ~send_bit);
+            if (cqe.res != (int)sizeof(msgs[n])) {
+                if (cqe.res < 0)
+                    handle_error(-cqe.res, "socket op failed!");
+                failed = draining = true;
+                continue;
+            }
+
+            if (0 != (cqe.user_data & send_bit)) {
+                /* the message is back in the socket; wait for it. */
+                if (draining) {
+                    ssize_t drained = read(pairs[n][0], msgs[n], sizeof(msgs[n]));
+                    (void)drained;
+                    continue;
+                }
+                struct io_uring_sqe* sqe = systest_uring_getsqe(ring);
+                sqe->opcode    = IORING_OP_RECV;
+                sqe->fd        = pairs[n][0];
+                sqe->addr      = (uint64_t)(uintptr_t)msgs[n];
+                sqe->len       = sizeof(msgs[n]);
+                sqe->user_data = n;
+                inflight++;
+            } else {
+                ops++;
+                if (draining)
+                    continue;
+                struct io_uring_sqe* sqe = systest_uring_getsqe(ring);
+                sqe->opcode    = IORING_OP_SEND;
+                sqe->fd        = pairs[n][1];
+                sqe->addr      = (uint64_t)(uintptr_t)msgs[n];
+                sqe->len       = sizeof(msgs[n]);
+                sqe->user_data = n | send_bit;
+                inflight++;
+            }
+        }
+    }
+
+    return failed ? -1.0 : (double)ops / ((double)(systest_monotonic_ns() - start) / 1e9);
+}
+
+bool check_uring_bench(void) {
+    const uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL;
+    static const unsigned depths[] = {1, 2, 4, 8, 16, 32, 64, 128, 256};
+
+    systest_uring ring;
+    if (!systest_uring_init(&ring, URING_BENCH_MAX_QD * 2)) {
+        systest_printf(YELLOW("io_uring is not usable: %d (%s)") "\n", errno, strerror(errno));
+        return true;
+    }
+
+    /* the scratch file lives in the cwd, where real data would. */
+    char path[] = "systest-uring-XXXXXX";
+    int fd = mkstemp(path);
+    int direct_fd = -1;
+    char* bufs = NULL;
+    int (*pairs)[2] = NULL;
+    bool passed = false;
+
+    if (-1 == fd) {
+        handle_error(errno, "mkstemp() failed!");
+        goto cleanup;
+    }
+
+    /* unlinked straight away, so nothing is left behind however we exit. */
+    direct_fd = open(path, O_RDONLY | O_DIRECT);
+    (void)unlink(path);
+
+    if (0 != posix_memalign((void**)&bufs, URING_BENCH_BLOCK, URING_BENCH_MAX_QD * URING_BENCH_BLOCK)) {
+        handle_error(ENOMEM, "posix_memalign() failed!");
+        bufs = NULL;
+        goto cleanup;
+    }
+
+    memset(bufs, 0xa5, URING_BENCH_MAX_QD * URING_BENCH_BLOCK);
+    for (size_t written = 0; written < URING_BENCH_FILE_SIZE; ) {
+        size_t len = URING_BENCH_MAX_QD * URING_BENCH_BLOCK;
+        ssize_t ret = write(fd, bufs, len);
+        if (ret <= 0) {
+            handle_error(errno, "write() failed!");
+            goto cleanup;
+        }
+        written += (size_t)ret;
+    }
+    (void)fsync(fd);
+
+    /* O_DIRECT shows what the device can do; otherwise we're measuring the
+     * cost of getting at the page cache. */
+    bool direct = -1 != direct_fd;
+    if (direct) {
+        systest_safeclose(&fd);
+        fd        = direct_fd;
+        direct_fd = -1;
+    }
+
+    systest_printf("io_uring file benchmark: random %d byte reads of a %d MiB file, %s\n",
+        URING_BENCH_BLOCK, URING_BENCH_FILE_SIZE / (1024 * 1024),
+        direct ? "O_DIRECT" : "buffered (O_DIRECT not supported here)");
+
+    double base = uring_bench_pread(fd, duration_ns, bufs);
+    systest_printf("%-14s %12.0f IOPS\n", "pread() qd 1", base);
+
+    passed = base > 0.0;
+    for (size_t n = 0; n < __countof(depths) && passed; n++) {
+        double iops = uring_run_io(&ring, fd, IORING_OP_READ, URING_BENCH_BLOCK, URING_BENCH_FILE_SIZE,
+            false, depths[n], duration_ns, bufs);
+        passed &= iops > 0.0;
+        systest_printf("io_uring qd %-3u %12.0f IOPS  %6.2fx\n", depths[n], iops, iops / base);
+    }
+
+    pairs = calloc(URING_BENCH_MAX_QD, sizeof(*pairs));
+    if (!pairs) {
+        handle_error(errno, "calloc() failed!");
+        passed = false;
+        goto cleanup;
+    }
+
+    for (unsigned n = 0; n < URING_BENCH_MAX_QD; n++)
+        pairs[n][0] = pairs[n][1] = -1;
+
+    for (unsigned n = 0; n < URING_BENCH_MAX_QD; n++) {
+        if (0 != socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[n])) {
+            handle_error(errno, "socketpair() failed!");
+            passed = false;
+            goto cleanup;
+        }
+    }
+
+    systest_printf("io_uring socket benchmark: 64 byte messages bounced around n socket pairs\n");
+    systest_printf("%-8s %16s %16s %10s\n", "sockets", "epoll msg/s", "io_uring msg/s", "speedup");
+    for (size_t n = 0; n < __countof(depths) && passed; n++) {
+        double ep = uring_bench_epoll(pairs, depths[n], duration_ns);
+        double ur = uring_bench_sockets(&ring, pairs, depths[n], duration_ns);
+        passed &= ep > 0.0 && ur > 0.0;
+        systest_printf("%-8u %16.0f %16.0f %9.2fx\n", depths[n], ep, ur, ur / ep);
+    }
+
+cleanup:
+    if (pairs) {
+        for (unsigned n = 0; n < URING_BENCH_MAX_QD; n++) {
+            systest_safeclose(&pairs[n][0]);
+            systest_safeclose(&pairs[n][1]);
+        }
+        systest_safefree(&pairs);
+    }
+    systest_safeclose(&fd);
+    systest_safeclose(&direct_fd);
+    systest_safefree(&bufs);
+    systest_uring_free(&ring);
+    return passed;
+}
+#endif
+
+#if defined(__linux__) && defined(__HAVE_PTHREADS__)
+/** Largest queue depth and thread count the storage benchmark uses. */
+# define STORAGE_MAX_QD 32
+# define STORAGE_MAX_THREADS 8
+
+/** An access pattern measured by the storage benchmark. */
+typedef struct {
+    const char* const name;
+    bool write;
+    bool sequential;
+    size_t block;
+} storage_pattern;
+
+static const storage_pattern storage_patterns[] = {
+    {"seq read", false, true, 1024 * 1024},
+    {"seq write", true, true, 1024 * 1024},
+    {"rand read", false, false, 4096},
+    {"rand write", true, false, 4096},
+};
+
+/** One thread's share of a synchronous (queue depth 1) storage measurement. */
+typedef struct {
+    int fd;
+    const storage_pattern* pat;
+    uint64_t region_start; /**< Sequential threads each get their own region. */
+    uint64_t region_len;
+    uint64_t duration_ns;
+    uint64_t seed;
+    char* buf;
+    uint64_t ops;
+    bool failed;
+} storage_job;
+
+static void* storage_worker(void* arg) {
+    storage_job* job = (storage_job*)arg;
+    const uint64_t blocks = job->region_len / job->pat->block;
+    uint64_t next = 0;
+    uint64_t start = systest_monotonic_ns();
+
+    if (0 == blocks) {
+        job->failed = true;
+        return NULL;
+    }
+
+    while (systest_monotonic_ns() - start < job->duration_ns) {
+        uint64_t blk = job->pat->sequential ? (next++ % blocks) : (systest_rand64(&job->seed) % blocks);
+        off_t off = (off_t)(job->region_start + (blk * job->pat->block));
+        ssize_t ret = job->pat->write ? pwrite(job->fd, job->buf, job->pat->block, off) :
+            pread(job->fd, job->buf, job->pat->block, off);
+        if (ret != (ssize_t)job->pat->block) {
+            handle_error(errno, job->pat->write ? "pwrite() failed!" : "pread() failed!");
+            job->failed = true;
+            break;
+        }
+        job->ops++;
+    }
+
+    return NULL;
+}
+
+/** Runs pattern on nthreads threads at queue depth 1; returns ops/sec. */
+static double storage_run_threads(int fd, const storage_pattern* pat, uint64_t file_size,
+    size_t nthreads, uint64_t duration_ns, char* bufs) {
+    storage_job jobs[STORAGE_MAX_THREADS];
+    pthread_t threads[STORAGE_MAX_THREADS];
+    size_t started = 0;
+    uint64_t region = pat->sequential ? (file_size / nthreads) - ((file_size / nthreads) % pat->block) : file_size;
+
+    uint64_t start = systest_monotonic_ns();
+    for (size_t n = 0; n < nthreads; n++) {
+        jobs[n] = (storage_job){fd, pat, pat->sequential ? n * region : 0, region, duration_ns,
+            0x9e3779b97f4a7c15ULL + n, bufs + (n * pat->block), 0, false};
+        if (1 == nthreads) {
+            (void)storage_worker(&jobs[n]);
+            break;
+        }
+        int ret = pthread_create(&threads[n], NULL, &storage_worker, &jobs[n]);
+        if (0 != ret) {
+            handle_error(ret, "pthread_create() failed!");
+            break;
+        }
+        started++;
+    }
+
+    for (size_t n = 0; n < started; n++)
+        (void)pthread_join(threads[n], NULL);
+
+    uint64_t elapsed = systest_monotonic_ns() - start;
+    uint64_t ops = 0;
+    for (size_t n = 0; n < (1 == nthreads ? 1 : started); n++) {
+        if (jobs[n].failed)
+            return -1.0;
+        ops += jobs[n].ops;
+    }
+
+    return (1 == nthreads || started == nthreads) ? (double)ops / ((double)elapsed / 1e9) : -1.0;
+}
+
+/** Times write()+sync_fn() of one 4 KiB block. */
+static void storage_sync_latency(int fd, int (*sync_fn)(int), const char* label,
+    uint64_t duration_ns, char* buf) {
+    size_t max = 4096, count = 0;
+    uint64_t* samples = calloc(max, sizeof(uint64_t));
+    if (!samples) {
+        handle_error(errno, "calloc() failed!");
+        return;
+    }
+
+    uint64_t start = systest_monotonic_ns();
+    while (count < max && systest_monotonic_ns() - start < duration_ns) {
+        uint64_t op_start = systest_monotonic_ns();
+        if (4096 != pwrite(fd, buf, 4096, (off_t)((count % 256) * 4096)) || 0 != sync_fn(fd)) {
+            handle_error(errno, label);
+            break;
+        }
+        samples[count++] = systest_monotonic_ns() - op_start;
+    }
+
+    print_latency_stats(label, samples, count);
+    systest_safefree(&samples);
+}
+
+bool check_storage_bench(void) {
+    const uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL;
+    const uint64_t file_size   = (uint64_t)opts.bench_file_mb * 1024ULL * 1024ULL;
+
+    /* same place systest_getfreediskspace() looks. */
+    char* cwd = systest_getcwd();
+    if (!cwd)
+        return false;
+
+    uint64_t free_bytes = 0;
+    if (!systest_getfreediskspace(&free_bytes)) {
+        systest_safefree(&cwd);
+        return false;
+    }
+
+    if (free_bytes < file_size * 2) {
+        systest_printf(YELLOW("not enough free space in '%s' for a %ld MiB test file") "\n", cwd,
+            opts.bench_file_mb);
+        systest_safefree(&cwd);
+        return false;
+    }
+
+    int cpus = 1;
+    (void)systest_getcpucount(&cpus);
+    size_t max_threads = cpus > STORAGE_MAX_THREADS ? STORAGE_MAX_THREADS : (cpus < 2 ? 2 : (size_t)cpus);
+
+    char path[] = "systest-storage-XXXXXX";
+    int fd = mkstemp(path);
+    int direct_fd = -1;
+    char* bufs = NULL;
+    bool passed = false;
+    size_t buf_size = STORAGE_MAX_QD * 1024 * 1024;
+
+    if (-1 == fd) {
+        handle_error(errno, "mkstemp() failed!");
+        systest_safefree(&cwd);
+        return false;
+    }
+
+    /* unlinked straight away, so nothing is left behind however we exit. */
+    direct_fd = open(path, O_RDWR | O_DIRECT);
+    int direct_err = errno;
+    (void)unlink(path);
+
+    if (0 != posix_memalign((void**)&bufs, 4096, buf_size)) {
+        handle_error(ENOMEM, "posix_memalign() failed!");
+        bufs = NULL;
+        goto cleanup;
+    }
+    memset(bufs, 0x3c, buf_size);
+
+    /* lay the file out fully, so reads don't hit holes. */
+    for (uint64_t written = 0; written < file_size; ) {
+        size_t len = (file_size - written) < buf_size ? (size_t)(file_size - written) : buf_size;
+        ssize_t ret = write(fd, bufs, len);
+        if (ret <= 0) {
+            handle_error(errno, "write() failed!");
+            goto cleanup;
+        }
+        written += (uint64_t)ret;
+    }
+    if (0 != fsync(fd)) {
+        handle_error(errno, "fsync() failed!");
+        goto cleanup;
+    }
+
+#if defined(__HAVE_IO_URING__)
+    systest_uring ring;
+    bool have_ring = systest_uring_init(&ring, STORAGE_MAX_QD);
+#endif
+
+    systest_printf("storage benchmark in '%s': %ld MiB file, %ld ms per measurement\n", cwd,
+        opts.bench_file_mb, opts.bench_ms);
+    if (-1 == direct_fd)
+        systest_printf(YELLOW("O_DIRECT is not supported here: %d (%s)") "\n", direct_err, strerror(direct_err));
+#if defined(__HAVE_IO_URING__)
+    if (!have_ring)
+        systest_printf(YELLOW("io_uring is not usable; queue depths > 1 skipped") "\n");
+#else
+    systest_printf(YELLOW("built without io_uring; queue depths > 1 skipped") "\n");
+#endif
+    systest_printf("%-9s %-11s %-12s %12s %12s\n", "mode", "pattern", "qd/threads", "IOPS", "MiB/s");
+
+    passed = true;
+    for (int direct = 0; direct < 2 && passed; direct++) {
+        int io_fd = direct ? direct_fd : fd;
+        if (-1 == io_fd)
+            continue;
+
+        for (size_t p = 0; p < __countof(storage_patterns) && passed; p++) {
+            const storage_pattern* pat = &storage_patterns[p];
+            static const unsigned depths[] = {1, 4, STORAGE_MAX_QD};
+            static const size_t thread_counts[] = {1, 2, STORAGE_MAX_THREADS};
+
+            for (size_t t = 0; t < __countof(thread_counts) && passed; t++) {
+                /* sequential threads each need a region of at least one block. */
+                size_t limit = pat->sequential && file_size / pat->block < max_threads ?
+                    (size_t)(file_size / pat->block) : max_threads;
+                size_t nthreads = thread_counts[t] > limit ? limit : thread_counts[t];
+                if (0 == nthreads || (t > 0 && nthreads <= thread_counts[t - 1]))
+                    continue;
+
+                double iops = storage_run_threads(io_fd, pat, file_size, nthreads, duration_ns, bufs);
+                passed &= iops >= 0.0;
+
+                char label[32];
+                (void)snprintf(label, sizeof(label), "qd 1/t %zu", nthreads);
+                systest_printf("%-9s %-11s %-12s %12.0f %12.1f\n", direct ? "direct" : "buffered",
+                    pat->name, label, iops, iops * (double)pat->block / (1024.0 * 1024.0));
+            }
+
+#if defined(__HAVE_IO_URING__)
+            for (size_t d = 1; d < __countof(depths) && passed && have_ring; d++) {
+                double iops = uring_run_io(&ring, io_fd, pat->write ? IORING_OP_WRITE : IORING_OP_READ,
+                    pat->block, file_size, pat->sequential, depths[d], duration_ns, bufs);
+                passed &= iops >= 0.0;
+
+                char label[24];
+                (void)snprintf(label, sizeof(label), "qd %u/t 1", depths[d]);
+                systest_printf("%-9s %-11s %-12s %12.0f %12.1f\n", direct ? "direct" : "buffered",
+                    pat->name, label, iops, iops * (double)pat->block / (1024.0 * 1024.0));
+            }
+#else
+            (void)depths;
+#endif
+        }
+    }
+
+    storage_sync_latency(fd, &fsync, "write+fsync", duration_ns, bufs);
+    storage_sync_latency(fd, &fdatasync, "write+fdatasync", duration_ns, bufs);
+
+#if defined(__HAVE_IO_URING__)
+    if (have_ring)
+        systest_uring_free(&ring);
+#endif
+
+cleanup:
+    systest_safeclose(&direct_fd);
+    systest_safeclose(&fd);
+    systest_safefree(&bufs);
+    systest_safefree(&cwd);
+    return passed;
+}
+#endif
+
+#if defined(__linux__) && defined(__HAVE_PTHREADS__)
+/* shape of the tree generated when --walk-root isn't given: WALK_FANOUT
+ * subdirectories per directory, WALK_DEPTH levels deep, WALK_FILES files in
+ * each directory. */
+# define WALK_FANOUT 6
+# define WALK_DEPTH 3
+# define WALK_FILES 32
+# define WALK_MAX_THREADS 16
+# define WALK_DENTS_SIZE (64 * 1024)
+
+/** What one pass over a tree saw. */
+typedef struct {
+    uint64_t files; /**< Everything that isn't a directory. */
+    uint64_t dirs;
+    uint64_t stats;
+    bool failed;
+} walk_counts;
+
+static bool walk_make_tree(const char* dir, int depth) {
+    char path[SYSTEST_MAXPATH];
+    for (int n = 0; n < WALK_FILES; n++) {
+        int len = snprintf(path, sizeof(path), "%s/f%d", dir, n);
+        if (len < 0 || (size_t)len >= sizeof(path))
+            return false;
+        int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (-1 == fd) {
+            handle_error(errno, "open() failed!");
+            return false;
+        }
+        systest_safeclose(&fd);
+    }
+
+    for (int n = 0; depth > 0 && n < WALK_FANOUT; n++) {
+        int len = snprintf(path, sizeof(path), "%s/d%d", dir, n);
+        if (len < 0 || (size_t)len >= sizeof(path))
+            return false;
+        if (0 != mkdir(path, 0755)) {
+            handle_error(errno, "mkdir() failed!");
+            return false;
+        }
+        if (!walk_make_tree(path, depth - 1))
+            return false;
+    }
+
+    return true;
+}
+
+static int walk_remove_cb(const char* path, const struct stat* st, int type, struct FTW* ftw) {
+    (void)st;
+    (void)type;
+    (void)ftw;
+    (void)remove(path);
+    return 0;
+}
+
+/* --- readdir(): one thread, a descriptor per level, fstatat() on everything --- */
+
+static void walk_readdir(int parent_fd, const char* name, walk_counts* counts) {
+    int fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    DIR* dir = -1 != fd ? fdopendir(fd) : NULL;
+    if (!dir) {
+        /* permissions, or it vanished; a crawler carries on. */
+        systest_safeclose(&fd);
+        return;
+    }
+
+    struct dirent* ent = NULL;
+    while (NULL != (ent = readdir(dir))) {
+        if (0 == strcmp(ent->d_name, ".") || 0 == strcmp(ent->d_name, ".."))
+            continue;
+
+        struct stat st;
+        counts->stats++;
+        if (0 != fstatat(dirfd(dir), ent->d_name, &st, AT_SYMLINK_NOFOLLOW))
+            continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            counts->dirs++;
+            walk_readdir(dirfd(dir), ent->d_name, counts);
+        } else {
+            counts->files++;
+        }
+    }
+
+    (void)closedir(dir);
+}
+
+/* --- nftw(): no context pointer, so the counts live here --- */
+
+static SYSTEST_THREAD_LOCAL walk_counts walk_nftw_counts;
+
+static int walk_nftw_cb(const char* path, const struct stat* st, int type, struct FTW* ftw) {
+    (void)path;
+    (void)st;
+    if (0 == ftw->level)
+        return 0;
+
+    walk_nftw_counts.stats++;
+    if (FTW_D == type || FTW_DNR == type)
+        walk_nftw_counts.dirs++;
+    else
+        walk_nftw_counts.files++;
+    return 0;
+}
+
+/* --- getdents64 + statx: threads with work-stealing deques of directories --- */
+
+/** Layout of what getdents64 returns. */
+typedef struct {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+} walk_dirent64;
+
+/** Directories waiting to be read. The owner pushes and pops at the tail
+ * (depth first, for locality); thieves take from the head, which is where the
+ * biggest unexplored subtrees tend to be. */
+typedef struct {
+    pthread_mutex_t lock;
+    char** items;
+    size_t head;
+    size_t tail;
+    size_t cap; /**< Always a power of two. */
+} walk_deque;
+
+typedef struct {
+    walk_deque* deques;
+    size_t nthreads;
+    bool stat_all;          /**< statx() every entry, not just those without a d_type. */
+    atomic_size_t pending;  /**< Directories queued or being read. */
+} walk_shared;
+
+typedef struct {
+    walk_shared* shared;
+    size_t self;
+    char* dents;
+    walk_counts counts;
+} walk_worker;
+
+static bool walk_deque_push(walk_deque* dq, char* path) {
+    (void)pthread_mutex_lock(&dq->lock);
+    if (dq->tail - dq->head == dq->cap) {
+        size_t cap   = dq->cap ? dq->cap * 2 : 64;
+        char** items = malloc(cap * sizeof(char*));
+        if (!items) {
+            (void)pthread_mutex_unlock(&dq->lock);
+            return false;
+        }
+        for (size_t n = dq->head; n < dq->tail; n++)
+            items[n & (cap - 1)] = dq->items[n & (dq->cap - 1)];
+        systest_safefree(&dq->items);
+        dq->items = items;
+        dq->cap   = cap;
+    }
+    dq->items[dq->tail++ & (dq->cap - 1)] = path;
+    (void)pthread_mutex_unlock(&dq->lock);
+    return true;
+}
+
+static char* walk_deque_take(walk_deque* dq, bool steal) {
+    char* path = NULL;
+    (void)pthread_mutex_lock(&dq->lock);
+    if (dq->tail != dq->head)
+        path = steal ? dq->items[dq->head++ & (dq->cap - 1)] : dq->items[--dq->tail & (dq->cap - 1)];
+    (void)pthread_mutex_unlock(&dq->lock);
+    return path;
+}
+
+static bool walk_enqueue(walk_worker* w, char* path) {
+    atomic_fetch_add(&w->shared->pending, 1);
+    if (!walk_deque_push(&w->shared->deques[w->self], path)) {
+        atomic_fetch_sub(&w->shared->pending, 1);
+        systest_safefree(&path);
+        return false;
+    }
+    return true;
+}
+
+/** Returns false only if the entry's type couldn't be determined. */
+static bool walk_stat_isdir(int dir_fd, const char* name, bool* isdir) {
+#if defined(__HAVE_STATX__)
+    struct statx stx;
+    if (0 != statx(dir_fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC,
+        STATX_TYPE | STATX_SIZE | STATX_MTIME, &stx))
+        return false;
+    *isdir = S_ISDIR(stx.stx_mode);
+#else
+    struct stat st;
+    if (0 != fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW))
+        return false;
+    *isdir = S_ISDIR(st.st_mode);
+#endif
+    return true;
+}
+
+static void walk_getdents_dir(walk_worker* w, const char* path) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (-1 == fd)
+        return;
+
+    size_t path_len = strlen(path);
+    for (;;) {
+        long len = syscall(SYS_getdents64, fd, w->dents, WALK_DENTS_SIZE);
+        if (len <= 0)
+            break;
+
+        for (long off = 0; off < len; ) {
+            const walk_dirent64* ent = (const walk_dirent64*)(w->dents + off);
+            off += ent->d_reclen;
+
+            if ('.' == ent->d_name[0] && ('\0' == ent->d_name[1] ||
+                ('.' == ent->d_name[1] && '\0' == ent->d_name[2])))
+                continue;
+
+            bool isdir = (DT_DIR == ent->d_type);
+            if (w->shared->stat_all || DT_UNKNOWN == ent->d_type) {
+                w->counts.stats++;
+                if (!walk_stat_isdir(fd, ent->d_name, &isdir))
+                    continue;
+            }
+
+            if (!isdir) {
+                w->counts.files++;
+                continue;
+            }
+
+            w->counts.dirs++;
+            size_t name_len = strlen(ent->d_name);
+            char* child = malloc(path_len + name_len + 2);
+            if (!child) {
+                w->counts.failed = true;
+                continue;
+            }
+            memcpy(child, path, path_len);
+            child[path_len] = '/';
+            memcpy(child + path_len + 1, ent->d_name, name_len + 1);
+            if (!walk_enqueue(w, child))
+                w->counts.failed = true;
+        }
+    }
+
+    systest_safeclose(&fd);
+}
+
+static void* walk_getdents_worker(void* arg) {
+    walk_worker* w     = (walk_worker*)arg;
+    walk_shared* share = w->shared;
+
+    for (;;) {
+        char* path = walk_deque_take(&share->deques[w->self], false);
+        for (size_t n = 1; !path && n < share->nthreads; n++)
+            path = walk_deque_take(&share->deques[(w->self + n) % share->nthreads], true);
+
+        if (!path) {
+            if (0 == atomic_load(&share->pending))
+                break;
+            (void)sched_yield();
+            continue;
+        }
+
+        walk_getdents_dir(w, path);
+        systest_safefree(&path);
+        atomic_fetch_sub(&share->pending, 1);
+    }
+
+    return NULL;
+}
+
+static void walk_getdents(const char* root, size_t nthreads, bool stat_all, walk_counts* counts) {
+    walk_deque deques[WALK_MAX_THREADS];
+    walk_worker workers[WALK_MAX_THREADS];
+    pthread_t threads[WALK_MAX_THREADS];
+    walk_shared shared = {deques, nthreads, stat_all, 0};
+    size_t started = 0;
+
+    for (size_t n = 0; n < nthreads; n++) {
+        deques[n]  = (walk_deque){.lock = PTHREAD_MUTEX_INITIALIZER};
+        workers[n] = (walk_worker){&shared, n, malloc(WALK_DENTS_SIZE), {0, 0, 0, false}};
+        if (!workers[n].dents)
+            counts->failed = true;
+    }
+
+    char* first = strdup(root);
+    if (counts->failed || !first || !walk_enqueue(&workers[0], first)) {
+        counts->failed = true;
+        goto cleanup;
+    }
+
+    /* the calling thread is worker 0. */
+    for (started = 1; started < nthreads; started++) {
+        int ret = pthread_create(&threads[started], NULL, &walk_getdents_worker, &workers[started]);
+        if (0 != ret) {
+            handle_error(ret, "pthread_create() failed!");
+            break;
+        }
+    }
+    (void)walk_getdents_worker(&workers[0]);
+    for (size_t n = 1; n < started; n++)
+        (void)pthread_join(threads[n], NULL);
+
+    for (size_t n = 0; n < nthreads; n++) {
+        counts->files += workers[n].counts.files;
+        counts->dirs  += workers[n].counts.dirs;
+        counts->stats += workers[n].counts.stats;
+        counts->failed |= workers[n].counts.failed;
+    }
+
+cleanup:
+    for (size_t n = 0; n < nthreads; n++) {
+        systest_safefree(&workers[n].dents);
+        systest_safefree(&deques[n].items);
+    }
+}
+
+typedef enum {
+    WALK_READDIR,
+    WALK_NFTW,
+    WALK_GETDENTS_STATX,
+    WALK_GETDENTS_DTYPE
+} walk_method;
+
+/** Walks the tree repeatedly for duration_ns (at least once). On return,
+ * counts holds the first pass and rates are per second over all of them. */
+static bool walk_measure(const char* root, walk_method method, size_t nthreads,
+    uint64_t duration_ns, walk_counts* counts, double* files_per_sec, double* stats_per_sec) {
+    uint64_t files = 0, stats = 0, passes = 0;
+    uint64_t start = systest_monotonic_ns(), elapsed = 0;
+
+    do {
+        walk_counts pass = {0, 0, 0, false};
+        switch (method) {
+            case WALK_READDIR:
+                walk_readdir(AT_FDCWD, root, &pass);
+                break;
+            case WALK_NFTW:
+                walk_nftw_counts = pass;
+                if (0 != nftw(root, &walk_nftw_cb, 64, FTW_PHYS)) {
+                    handle_error(errno, "nftw() failed!");
+                    walk_nftw_counts.failed = true;
+                }
+                pass = walk_nftw_counts;
+                break;
+            case WALK_GETDENTS_STATX:
+            case WALK_GETDENTS_DTYPE:
+                walk_getdents(root, nthreads, WALK_GETDENTS_STATX == method, &pass);
+                break;
+        }
+        if (pass.failed)
+            return false;
+
+        if (0 == passes)
+            *counts = pass;
+        files += pass.files;
+        stats += pass.stats;
+        passes++;
+        elapsed = systest_monotonic_ns() - start;
+    } while (elapsed < duration_ns);
+
+    *files_per_sec = (double)files / ((double)elapsed / 1e9);
+    *stats_per_sec = (double)stats / ((double)elapsed / 1e9);
+    return true;
+}
+
+bool check_walk_bench(void) {
+    const uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL;
+    char tmp_root[] = "systest-walk-XXXXXX";
+    const char* root = opts.walk_root;
+
+    if (!root) {
+        if (!mkdtemp(tmp_root)) {
+            handle_error(errno, "mkdtemp() failed!");
+            return false;
+        }
+        root = tmp_root;
+        if (!walk_make_tree(root, WALK_DEPTH)) {
+            (void)nftw(root, &walk_remove_cb, 64, FTW_DEPTH | FTW_PHYS);
+            return false;
+        }
+    }
+
+    static const struct {
+        const char* name;
+        walk_method method;
+        size_t threads;
+    } runs[] = {
+        {"readdir+fstatat",   WALK_READDIR,        1},
+        {"nftw",              WALK_NFTW,           1},
+        {"getdents64+statx",  WALK_GETDENTS_STATX, 1},
+        {"getdents64+statx",  WALK_GETDENTS_STATX, 4},
+        {"getdents64+statx",  WALK_GETDENTS_STATX, WALK_MAX_THREADS},
+        {"getdents64 (d_type)", WALK_GETDENTS_DTYPE, 4},
+    };
+
+    /* the first pass of the first method also warms the dentry/inode caches. */
+    walk_counts warm = {0, 0, 0, false};
+    walk_readdir(AT_FDCWD, root, &warm);
+    systest_printf("tree walk of '%s': %" PRIu64 " files, %" PRIu64 " directories (warm cache),"
+        " %ld ms per method\n", root, warm.files, warm.dirs, opts.bench_ms);
+    systest_printf("%-20s %7s %12s %12s\n", "method", "threads", "files/s", "stat/s");
+
+    bool passed = true;
+    for (size_t n = 0; n < __countof(runs); n++) {
+        walk_counts counts = {0, 0, 0, false};
+        double files_per_sec = 0.0, stats_per_sec = 0.0;
+        if (!walk_measure(root, runs[n].method, runs[n].threads, duration_ns, &counts,
+            &files_per_sec, &stats_per_sec)) {
+            systest_printf(RED("%-20s %7zu failed") "\n", runs[n].name, runs[n].threads);
+            passed = false;
+            continue;
+        }
+
+        systest_printf("%-20s %7zu %12.0f %12.0f\n", runs[n].name, runs[n].threads, files_per_sec,
+            stats_per_sec);
+
+        /* a tree someone else owns may change under us; ours may not. */
+        if (counts.files != warm.files || counts.dirs != warm.dirs) {
+            if (opts.walk_root) {
+                systest_printf(YELLOW("%s saw %" PRIu64 " files, %" PRIu64 " directories") "\n",
+                    runs[n].name, counts.files, counts.dirs);
+            } else {
+                systest_printf(RED("%s saw %" PRIu64 " files, %" PRIu64 " directories") "\n",
+                    runs[n].name, counts.files, counts.dirs);
+                passed = false;
+            }
+        }
+    }
+
+    if (!opts.walk_root)
+        (void)nftw(root, &walk_remove_cb, 64, FTW_DEPTH | FTW_PHYS);
+    return passed;
+}
+#endif
+
+#if defined(__linux__) && defined(__HAVE_PTHREADS__)
+# define META_MAX_THREADS 16
+# define META_MAX_FILES 100000  /**< Per thread, so cleanup stays bounded. */
+# define META_MAX_SAMPLES 16384 /**< Per thread and operation. */
+
+typedef enum {
+    META_CREATE,
+    META_OPEN,
+    META_RENAME,
+    META_UNLINK,
+    META_FSYNC_DIR,
+    META_OP_COUNT
+} meta_op;
+
+static const char* const meta_op_names[META_OP_COUNT] = {
+    "create", "open+close", "rename", "unlink", "create+fsync-dir"
+};
+
+/** Holds the threads back until the barrier they step through is set up. */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool open;
+    bool cancel; /**< Not all the threads could be started. */
+} meta_gate;
+
+typedef struct {
+    int dir_fd; /**< The shared directory, or this thread's own. */
+    size_t self;
+    meta_gate* gate;
+    pthread_barrier_t* barrier;
+    uint64_t duration_ns;
+    uint64_t ops[META_OP_COUNT];
+    uint64_t elapsed_ns[META_OP_COUNT];
+    uint64_t* samples; /**< META_MAX_SAMPLES for each op, back to back. */
+    size_t nsamples[META_OP_COUNT];
+    bool failed;
+} meta_job;
+
+static void meta_name(const meta_job* job, uint64_t n, bool renamed, char* buf, size_t size) {
+    (void)snprintf(buf, size, "t%zu.%" PRIu64 "%s", job->self, n, renamed ? ".r" : "");
+}
+
+static void meta_record(meta_job* job, meta_op op, uint64_t op_start) {
+    uint64_t took = systest_monotonic_ns() - op_start;
+    if (job->nsamples[op] < META_MAX_SAMPLES)
+        job->samples[(op * META_MAX_SAMPLES) + job->nsamples[op]++] = took;
+    job->ops[op]++;
+}
+
+static bool meta_create(meta_job* job, const char* name) {
+    int fd = openat(job->dir_fd, name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (-1 == fd) {
+        handle_error(errno, "openat() failed!");
+        return false;
+    }
+    systest_safeclose(&fd);
+    return true;
+}
+
+/** Each thread runs every operation in turn, in step with the others. Files
+ * made by the create phase are reused by the open, rename and unlink phases. */
+static void* meta_worker(void* arg) {
+    meta_job* job = (meta_job*)arg;
+    char name[64], renamed_name[64];
+    uint64_t created = 0, renamed = 0, start = 0;
+
+    (void)pthread_mutex_lock(&job->gate->lock);
+    while (!job->gate->open)
+        (void)pthread_cond_wait(&job->gate->cond, &job->gate->lock);
+    bool cancel = job->gate->cancel;
+    (void)pthread_mutex_unlock(&job->gate->lock);
+    if (cancel)
+        return NULL;
+
+    (void)pthread_barrier_wait(job->barrier);
+    start = systest_monotonic_ns();
+    while (!job->failed && created < META_MAX_FILES && systest_monotonic_ns() - start < job->duration_ns) {
+        meta_name(job, created, false, name, sizeof(name));
+        uint64_t op_start = systest_monotonic_ns();
+        if (!meta_create(job, name)) {
+            job->failed = true;
+            break;
+        }
+        meta_record(job, META_CREATE, op_start);
+        created++;
+    }
+    job->elapsed_ns[META_CREATE] = systest_monotonic_ns() - start;
+
+    (void)pthread_barrier_wait(job->barrier);
+    start = systest_monotonic_ns();
+    for (uint64_t n = 0; !job->failed && created > 0 && systest_monotonic_ns() - start < job->duration_ns; n++) {
+        meta_name(job, n % created, false, name, sizeof(name));
+        uint64_t op_start = systest_monotonic_ns();
+        int fd = openat(job->dir_fd, name, O_RDONLY | O_CLOEXEC);
+        if (-1 == fd) {
+            handle_error(errno, "openat() failed!");
+            job->failed = true;
+            break;
+        }
+        systest_safeclose(&fd);
+        meta_record(job, META_OPEN, op_start);
+    }
+    job->elapsed_ns[META_OPEN] = systest_monotonic_ns() - start;
+
+    (void)pthread_barrier_wait(job->barrier);
+    start = systest_monotonic_ns();
+    while (!job->failed && renamed < created && systest_monotonic_ns() - start < job->duration_ns) {
+        meta_name(job, renamed, false, name, sizeof(name));
+        meta_name(job, renamed, true, renamed_name, sizeof(renamed_name));
+        uint64_t op_start = systest_monotonic_ns();
+        if (0 != renameat(job->dir_fd, name, job->dir_fd, renamed_name)) {
+            handle_error(errno, "renameat() failed!");
+            job->failed = true;
+            break;
+        }
+        meta_record(job, META_RENAME, op_start);
+        renamed++;
+    }
+    job->elapsed_ns[META_RENAME] = systest_monotonic_ns() - start;
+
+    /* unlink everything, timed or not, so the next phase starts clean. */
+    (void)pthread_barrier_wait(job->barrier);
+    start = systest_monotonic_ns();
+    for (uint64_t n = 0; n < created; n++) {
+        meta_name(job, n, n < renamed, name, sizeof(name));
+        uint64_t op_start = systest_monotonic_ns();
+        if (0 != unlinkat(job->dir_fd, name, 0)) {
+            if (!job->failed)
+                handle_error(errno, "unlinkat() failed!");
+            job->failed = true;
+            continue;
+        }
+        meta_record(job, META_UNLINK, op_start);
+    }
+    job->elapsed_ns[META_UNLINK] = systest_monotonic_ns() - start;
+
+    (void)pthread_barrier_wait(job->barrier);
+    start   = systest_monotonic_ns();
+    created = 0;
+    while (!job->failed && created < META_MAX_FILES && systest_monotonic_ns() - start < job->duration_ns) {
+        meta_name(job, created, false, name, sizeof(name));
+        uint64_t op_start = systest_monotonic_ns();
+        if (!meta_create(job, name)) {
+            job->failed = true;
+            break;
+        }
+        created++;
+        if (0 != fsync(job->dir_fd)) {
+            handle_error(errno, "fsync() failed!");
+            job->failed = true;
+            break;
+        }
+        meta_record(job, META_FSYNC_DIR, op_start);
+    }
+    job->elapsed_ns[META_FSYNC_DIR] = systest_monotonic_ns() - start;
+
+    for (uint64_t n = 0; n < created; n++) {
+        meta_name(job, n, false, name, sizeof(name));
+        (void)unlinkat(job->dir_fd, name, 0);
+    }
+
+    return NULL;
+}
+
+/** Runs every operation on nthreads threads, in root (shared) or in a
+ * directory per thread, and prints a row for each. */
+static bool meta_run(int root_fd, size_t nthreads, bool shared, uint64_t duration_ns) {
+    meta_job jobs[META_MAX_THREADS];
+    pthread_t threads[META_MAX_THREADS];
+    meta_gate gate = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, false, false};
+    pthread_barrier_t barrier;
+    bool passed = true;
+    size_t ready = 0, started = 0;
+
+    for (; ready < nthreads; ready++) {
+        jobs[ready] = (meta_job){.dir_fd = root_fd, .self = ready, .gate = &gate,
+            .barrier = &barrier, .duration_ns = duration_ns};
+        jobs[ready].samples = calloc(META_OP_COUNT * META_MAX_SAMPLES, sizeof(uint64_t));
+        if (!jobs[ready].samples) {
+            handle_error(errno, "calloc() failed!");
+            passed = false;
+            break;
+        }
+
+        if (!shared) {
+            char dir[32];
+            (void)snprintf(dir, sizeof(dir), "t%zu", ready);
+            if (0 != mkdirat(root_fd, dir, 0755) && EEXIST != errno)
+                handle_error(errno, "mkdirat() failed!");
+            jobs[ready].dir_fd = openat(root_fd, dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (-1 == jobs[ready].dir_fd) {
+                handle_error(errno, "openat() failed!");
+                systest_safefree(&jobs[ready].samples);
+                passed = false;
+                break;
+            }
+        }
+    }
+
+    for (; passed && started < ready; started++) {
+        int ret = pthread_create(&threads[started], NULL, &meta_worker, &jobs[started]);
+        if (0 != ret) {
+            handle_error(ret, "pthread_create() failed!");
+            passed = false;
+            break;
+        }
+    }
+
+    /* the barrier can only be sized once it's known how many threads made it,
+     * so they wait at the gate until then. */
+    (void)pthread_mutex_lock(&gate.lock);
+    if (!passed || 0 != pthread_barrier_init(&barrier, NULL, (unsigned)started)) {
+        passed      = false;
+        gate.cancel = true;
+    }
+    gate.open = true;
+    (void)pthread_cond_broadcast(&gate.cond);
+    (void)pthread_mutex_unlock(&gate.lock);
+
+    for (size_t n = 0; n < started; n++)
+        (void)pthread_join(threads[n], NULL);
+
+    if (!gate.cancel)
+        (void)pthread_barrier_destroy(&barrier);
+
+    for (size_t n = 0; n < started; n++)
+        passed &= !jobs[n].failed;
+
+    size_t merged_max = nthreads * META_MAX_SAMPLES;
+    uint64_t* merged = passed ? calloc(merged_max, sizeof(uint64_t)) : NULL;
+    for (int op = 0; merged && op < META_OP_COUNT; op++) {
+        uint64_t ops = 0, elapsed = 0;
+        size_t count = 0;
+        for (size_t n = 0; n < nthreads; n++) {
+            ops += jobs[n].ops[op];
+            if (jobs[n].elapsed_ns[op] > elapsed)
+                elapsed = jobs[n].elapsed_ns[op];
+            memcpy(merged + count, jobs[n].samples + ((size_t)op * META_MAX_SAMPLES),
+                jobs[n].nsamples[op] * sizeof(uint64_t));
+            count += jobs[n].nsamples[op];
+        }
+
+        if (0 == count)
+            continue;
+
+        systest_sortu64(merged, count);
+        systest_printf("%-17s %-10s %7zu %10.0f %9.1f %9.1f %9.1f\n", meta_op_names[op],
+            shared ? "shared" : "per-thread", nthreads, (double)ops / ((double)elapsed / 1e9),
+            (double)systest_percentile(merged, count, 50.0) / 1e3,
+            (double)systest_percentile(merged, count, 99.0) / 1e3, (double)merged[count - 1] / 1e3);
+    }
+    systest_safefree(&merged);
+
+    for (size_t n = 0; n < ready; n++) {
+        systest_safefree(&jobs[n].samples);
+        if (!shared)
+            systest_safeclose(&jobs[n].dir_fd);
+    }
+    return passed;
+}
+
+/** Reports whether O_TMPFILE and fallocate() work in the directory. */
+static void meta_print_support(int root_fd) {
+    int fd = openat(root_fd, ".", O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (-1 != fd) {
+        systest_printf("O_TMPFILE: supported\n");
+    } else {
+        systest_printf(YELLOW("O_TMPFILE: not supported: %d (%s)") "\n", errno, strerror(errno));
+        fd = openat(root_fd, "fallocate", O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        (void)unlinkat(root_fd, "fallocate", 0);
+    }
+
+    if (-1 == fd)
+        return;
+
+    static const struct { const char* name; int mode; } modes[] = {
+        {"fallocate", 0},
+        {"fallocate(KEEP_SIZE)", FALLOC_FL_KEEP_SIZE},
+        {"fallocate(PUNCH_HOLE)", FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE},
+    };
+    for (size_t n = 0; n < __countof(modes); n++) {
+        if (0 == fallocate(fd, modes[n].mode, 0, 1024 * 1024))
+            systest_printf("%s: supported\n", modes[n].name);
+        else
+            systest_printf(YELLOW("%s: not supported: %d (%s)") "\n", modes[n].name, errno,
+                strerror(errno));
+    }
+
+    systest_safeclose(&fd);
+}
+
+bool check_meta_bench(void) {
+    const uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL;
+    char root[] = "systest-meta-XXXXXX";
+
+    if (!mkdtemp(root)) {
+        handle_error(errno, "mkdtemp() failed!");
+        return false;
+    }
+
+    int root_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (-1 == root_fd) {
+        handle_error(errno, "open() failed!");
+        (void)rmdir(root);
+        return false;
+    }
+
+    systest_printf("metadata benchmark in '%s', %ld ms per operation\n", root, opts.bench_ms);
+    meta_print_support(root_fd);
+    systest_printf("%-17s %-10s %7s %10s %9s %9s %9s\n", "operation", "directory", "threads",
+        "ops/s", "p50 us", "p99 us", "max us");
+
+    static const size_t thread_counts[] = {1, 4, META_MAX_THREADS};
+    bool passed = true;
+    for (size_t t = 0; t < __countof(thread_counts) && passed; t++) {
+        passed &= meta_run(root_fd, thread_counts[t], true, duration_ns);
+        if (passed && thread_counts[t] > 1)
+            passed &= meta_run(root_fd, thread_counts[t], false, duration_ns);
+    }
+
+    systest_safeclose(&root_fd);
+    (void)nftw(root, &walk_remove_cb, 64, FTW_DEPTH | FTW_PHYS);
+    return passed;
+}
+#endif
+
+#if defined(__linux__) && defined(__HAVE_PTHREADS__)
+# define SCAN_CHUNK (1024 * 1024)
+
+/** One way of reading the whole file: read() with a buffer of bufsize bytes,
+ * or mmap() if bufsize is zero. -1 means no fadvise/madvise. */
+typedef struct {
+    const char* name;
+    size_t bufsize;
+    int fadvice;
+    bool readahead;
+    int mmap_flags;
+    int madvice;
+} scan_variant;
+
+static const scan_variant scan_variants[] = {
+    {"read 4 KiB",              4096,       -1,                    false, 0,             -1},
+    {"read 64 KiB",             64 * 1024,  -1,                    false, 0,             -1},
+    {"read 1 MiB",              SCAN_CHUNK, -1,                    false, 0,             -1},
+    {"read 1 MiB +SEQUENTIAL",  SCAN_CHUNK, POSIX_FADV_SEQUENTIAL, false, 0,             -1},
+    {"read 1 MiB +readahead",   SCAN_CHUNK, -1,                    true,  0,             -1},
+    {"mmap",                    0,          -1,                    false, 0,             -1},
+    {"mmap +SEQUENTIAL",        0,          -1,                    false, 0,             MADV_SEQUENTIAL},
+# if defined(MADV_HUGEPAGE)
+    {"mmap +HUGEPAGE",          0,          -1,                    false, 0,             MADV_HUGEPAGE},
+# endif
+    {"mmap +POPULATE",          0,          -1,                    false, MAP_POPULATE,  -1},
+};
+
+/** What each variant computes over the file, so they can be checked against
+ * each other. */
+static uint64_t scan_sum(const uint64_t* words, size_t count, uint64_t sum) {
+    for (size_t n = 0; n < count; n++)
+        sum += words[n];
+    return sum;
+}
+
+static bool scan_file(int fd, uint64_t size, const scan_variant* v, char* buf, uint64_t* sum) {
+    *sum = 0;
+    /* The fd is shared by all variants, so reset the advice left behind by
+     * the previous one. */
+    (void)posix_fadvise(fd, 0, (off_t)size, -1 != v->fadvice ? v->fadvice : POSIX_FADV_NORMAL);
+    if (v->readahead)
+        (void)readahead(fd, 0, (size_t)size);
+
+    if (0 == v->bufsize) {
+        void* map = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED | v->mmap_flags, fd, 0);
+        if (MAP_FAILED == map) {
+            handle_error(errno, "mmap() failed!");
+            return false;
+        }
+        if (-1 != v->madvice && 0 != madvise(map, (size_t)size, v->madvice))
+            handle_error(errno, "madvise() failed!");
+
+        *sum = scan_sum((const uint64_t*)map, (size_t)(size / sizeof(uint64_t)), 0);
+        (void)munmap(map, (size_t)size);
+        return true;
+    }
+
+    for (uint64_t off = 0; off < size; ) {
+        ssize_t ret = pread(fd, buf, v->bufsize, (off_t)off);
+        if (ret <= 0 || 0 != (ret % (ssize_t)sizeof(uint64_t))) {
+            handle_error(errno, "pread() failed!");
+            return false;
+        }
+        *sum = scan_sum((const uint64_t*)buf, (size_t)ret / sizeof(uint64_t), *sum);
+        off += (uint64_t)ret;
+    }
+    return true;
+}
+
+/** Percentage of the file in the page cache, or -1 if that can't be told. */
+static double scan_resident_pct(int fd, uint64_t size) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t pages = (size_t)((size + (uint64_t)page - 1) / (uint64_t)page);
+    unsigned char* vec = malloc(pages);
+    void* map = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0);
+    double pct = -1.0;
+
+    if (vec && MAP_FAILED != map && 0 == mincore(map, (size_t)size, vec)) {
+        size_t resident = 0;
+        for (size_t n = 0; n < pages; n++)
+            resident += vec[n] & 1;
+        pct = 100.0 * (double)resident / (double)pages;
+    }
+
+    if (MAP_FAILED != map)
+        (void)munmap(map, (size_t)size);
+    systest_safefree(&vec);
+    return pct;
+}
+
+/** Asks the kernel to drop the file's (clean) pages from the page cache. */
+static void scan_drop_cache(int fd, uint64_t size) {
+    (void)fdatasync(fd);
+    (void)posix_fadvise(fd, 0, (off_t)size, POSIX_FADV_DONTNEED);
+}
+
+bool check_scan_bench(void) {
+    const uint64_t size = (uint64_t)opts.bench_file_mb * 1024ULL * 1024ULL;
+
+    char* cwd = systest_getcwd();
+    if (!cwd)
+        return false;
+
+    uint64_t free_bytes = 0;
+    if (!systest_getfreediskspace(&free_bytes) || free_bytes < size * 2) {
+        systest_printf(YELLOW("not enough free space in '%s' for a %ld MiB test file") "\n", cwd,
+            opts.bench_file_mb);
+        systest_safefree(&cwd);
+        return false;
+    }
+
+    char path[] = "systest-scan-XXXXXX";
+    int fd = mkstemp(path);
+    char* buf = malloc(SCAN_CHUNK);
+    bool passed = false;
+
+    /* unlinked straight away, so nothing is left behind however we exit. */
+    if (-1 != fd)
+        (void)unlink(path);
+
+    if (-1 == fd || !buf) {
+        handle_error(errno, -1 == fd ? "mkstemp() failed!" : "malloc() failed!");
+        goto cleanup;
+    }
+
+    uint64_t seed = 0x9e3779b97f4a7c15ULL, expected = 0;
+    for (uint64_t written = 0; written < size; written += SCAN_CHUNK) {
+        uint64_t* words = (uint64_t*)buf;
+        for (size_t n = 0; n < SCAN_CHUNK / sizeof(uint64_t); n++)
+            words[n] = systest_rand64(&seed);
+        expected = scan_sum(words, SCAN_CHUNK / sizeof(uint64_t), expected);
+        if (SCAN_CHUNK != write(fd, buf, SCAN_CHUNK)) {
+            handle_error(errno, "write() failed!");
+            goto cleanup;
+        }
+    }
+
+    systest_printf("file scan benchmark in '%s': %ld MiB file\n", cwd, opts.bench_file_mb);
+    systest_printf("%-24s %12s %12s\n", "method", "cold MiB/s", "warm MiB/s");
+
+    passed = true;
+    bool warned = false;
+    for (size_t n = 0; n < __countof(scan_variants) && passed; n++) {
+        const scan_variant* v = &scan_variants[n];
+        double rates[2] = {0.0, 0.0};
+
+        for (int warm = 0; warm < 2 && passed; warm++) {
+            if (!warm) {
+                scan_drop_cache(fd, size);
+                double pct = scan_resident_pct(fd, size);
+                if (pct > 10.0 && !warned) {
+                    systest_printf(YELLOW("couldn't evict the file (%.0f%% still cached);"
+                        " cold figures are optimistic") "\n", pct);
+                    warned = true;
+                }
+            }
+
+            uint64_t sum = 0, start = systest_monotonic_ns();
+            passed &= scan_file(fd, size, v, buf, &sum);
+            uint64_t elapsed = systest_monotonic_ns() - start;
+
+            if (passed && sum != expected) {
+                systest_printf(RED("%s: checksum mismatch") "\n", v->name);
+                passed = false;
+            }
+            rates[warm] = ((double)size / (1024.0 * 1024.0)) / ((double)elapsed / 1e9);
+        }
+
+        if (passed)
+            systest_printf("%-24s %12.1f %12.1f\n", v->name, rates[0], rates[1]);
+    }
+
+cleanup:
+    systest_safeclose(&fd);
+    systest_safefree(&buf);
+    systest_safefree(&cwd);
+    return passed;
+}
+#endif
+
+bool check_cpu_count(void) {
+    int cpus = 0;
+    if (!systest_getcpucount(&cpus))
+        return false;
+
+    systest_printf("logical core count = %d\n", cpus);
+
+    systest_cputopo topo;
+    if (!systest_getcputopology(&topo))
+        return false;
+
+    if (topo.vendor[0])
+        systest_printf("cpu: %s%s%s\n", topo.vendor, topo.brand[0] ? ", " : "", topo.brand);
+    systest_printf("%zu package(s), %zu core(s), %zu thread(s), %zu NUMA node(s); %zu allowed"
+        " by affinity\n", topo.packages, topo.cores, topo.threads, topo.nodes, topo.allowed);
+
+    for (size_t c = 0; c < topo.ncaches; c++) {
+        const systest_cache* cache = &topo.caches[c];
+        systest_printf("L%u%s: %" PRIu64 " KiB x %zu (shared by %zu), %u B lines, %u-way\n",
+            cache->level, 'D' == cache->type ? "d" : 'I' == cache->type ? "i" : "",
+            cache->size / 1024, cache->instances, cache->shared_by, cache->line_size, cache->ways);
+    }
+
+    /* a line per CPU gets unreadable on big machines. */
+    if (topo.ncpus > 0 && topo.ncpus <= 64) {
+        systest_printf("%5s %7s %5s %3s %4s %7s  %s\n", "cpu", "package", "core", "smt", "node",
+            "allowed", "cache ids");
+        for (size_t n = 0; n < topo.ncpus; n++) {
+            const systest_cpu* cpu = &topo.cpus[n];
+            char ids[SYSTEST_MAX_CACHES * 8] = {0};
+            size_t len = 0;
+            for (size_t c = 0; c < topo.ncaches && len < sizeof(ids); c++)
+                len += (size_t)snprintf(ids + len, sizeof(ids) - len, "%s%d", c ? "/" : "",
+                    cpu->cache_ids[c]);
+            systest_printf("%5d %7d %5d %3d %4d %7s  %s\n", cpu->id, cpu->package, cpu->core,
+                cpu->smt, cpu->node, cpu->allowed ? "yes" : "no", ids);
+        }
+    }
+
+    bool consistent = topo.allowed > 0 && topo.allowed <= topo.threads && topo.cores <= topo.threads &&
+        (size_t)cpus <= topo.threads;
+    if (!consistent)
+        systest_printf(RED("topology doesn't add up: %d usable, %zu allowed, %zu threads") "\n", cpus,
+            topo.allowed, topo.threads);
+
+    systest_freecputopology(&topo);
+    return cpus > 0 && consistent;
+}
+
+bool check_cgroup_limits(void) {
+    systest_cgroup_limits limits;
+    if (!systest_getcgrouplimits(&limits))
+        return false;
+
+    if (0 == limits.version)
+        systest_printf("cgroup: none found\n");
+    else
+        systest_printf("cgroup: v%d\n", limits.version);
+
+    if (limits.cpu_quota > 0.0)
+        systest_printf("cpu quota: %.2f CPUs\n", limits.cpu_quota);
+    else
+        systest_printf("cpu quota: none\n");
+    systest_printf("cpus: %zu online, %zu in affinity mask, %zu in cpuset\n", limits.online_cpus,
+        limits.affinity_cpus, limits.cpuset_cpus);
+    systest_printf("effective cpu count = %.2f\n", limits.effective_cpus);
+
+    const struct { const char* name; uint64_t value; } mem_fields[] = {
+        {"memory max",      limits.memory_max},
+        {"memory high",     limits.memory_high},
+        {"memory current",  limits.memory_current},
+        {"physical memory", limits.physical_memory},
+        {"memory budget",   limits.memory_budget},
+    };
+    for (size_t n = 0; n < __countof(mem_fields); n++) {
+        if (UINT64_MAX == mem_fields[n].value)
+            systest_printf("%s: none\n", mem_fields[n].name);
+        else
+            systest_printf("%s: %.1f MiB\n", mem_fields[n].name,
+                (double)mem_fields[n].value / (1024.0 * 1024.0));
+    }
+
+    return limits.effective_cpus > 0.0 && limits.memory_budget > 0;
+}
+
+bool check_cpu_features(void) {
+    uint64_t features = systest_getcpufeatures();
+    char supported[256] = {0}, missing[256] = {0};
+    size_t slen = 0, mlen = 0;
+
+    for (int f = 0; f < SYSTEST_CPU_FEATURE_COUNT; f++) {
+#if defined(__HAVE_CPUID__)
+        if (f >= SYSTEST_CPU_NEON)
+            continue;
+#elif defined(__HAVE_HWCAP__)
+        if (f < SYSTEST_CPU_NEON && SYSTEST_CPU_SHA != f)
+            continue;
+#endif
+        const char* name = systest_cpufeaturename((systest_cpu_feature)f);
+        if (features & (1ULL << f))
+            slen += (size_t)snprintf(supported + slen, sizeof(supported) - slen, " %s", name);
+        else
+            mlen += (size_t)snprintf(missing + mlen, sizeof(missing) - mlen, " %s", name);
+    }
+
+#if defined(__HAVE_CPUID__) || defined(__HAVE_HWCAP__)
+    systest_printf("supported:%s\n", slen ? supported : " (none)");
+    systest_printf("not supported:%s\n", mlen ? missing : " (none)");
+#else
+    systest_printf("no feature detection for this architecture\n");
+#endif
+    return true;
+}
+
+#if !defined(__WIN__)
+/* --- clocks: what reading each clock id costs, how finely it ticks, and
+ * whether the TSC underneath can be trusted --- */
+
+# define CLOCK_CALLS 100000
+
+static const struct {
+    const char* name;
+    clockid_t id;
+    bool monotonic; /**< Must never go backwards. */
+} clock_ids[] = {
+    {"REALTIME", CLOCK_REALTIME, false},
+# if defined(CLOCK_REALTIME_COARSE)
+    {"REALTIME_COARSE", CLOCK_REALTIME_COARSE, false},
+# endif
+    {"MONOTONIC", CLOCK_MONOTONIC, true},
+# if defined(CLOCK_MONOTONIC_COARSE)
+    {"MONOTONIC_COARSE", CLOCK_MONOTONIC_COARSE, true},
+# endif
+# if defined(CLOCK_MONOTONIC_RAW)
+    {"MONOTONIC_RAW", CLOCK_MONOTONIC_RAW, true},
+# endif
+# if defined(CLOCK_BOOTTIME)
+    {"BOOTTIME", CLOCK_BOOTTIME, true},
+# endif
+};
+
+static uint64_t clock_ts_ns(const struct timespec* ts) {
+    return ((uint64_t)ts->tv_sec * 1000000000ULL) + (uint64_t)ts->tv_nsec;
+}
+
+/** Average nanoseconds per clock_gettime(id). Sets *backwards if a
+ * reading was ever earlier than the one before it. */
+static double clock_cost(clockid_t id, bool* backwards) {
+    struct timespec ts;
+    uint64_t last = 0;
+    uint64_t start = systest_monotonic_ns();
+    for (int n = 0; n < CLOCK_CALLS; n++) {
+        (void)clock_gettime(id, &ts);
+        uint64_t now = clock_ts_ns(&ts);
+        *backwards |= (now < last);
+        last = now;
+    }
+    return (double)(systest_monotonic_ns() - start) / CLOCK_CALLS;
+}
+
+# if defined(__linux__)
+/** The same, but making the system call that the vDSO is there to avoid. */
+static double clock_syscall_cost(clockid_t id) {
+    struct timespec ts;
+    uint64_t start = systest_monotonic_ns();
+    for (int n = 0; n < CLOCK_CALLS / 10; n++)
+        (void)syscall(SYS_clock_gettime, id, &ts);
+    return (double)(systest_monotonic_ns() - start) / (CLOCK_CALLS / 10);
+}
+# endif
+
+/** The smallest step seen between successive different readings, which
+ * for a coarse clock is its tick; 0 if it didn't move within 50 ms. */
+static uint64_t clock_step(clockid_t id) {
+    struct timespec ts;
+    (void)clock_gettime(id, &ts);
+    uint64_t last = clock_ts_ns(&ts), step = 0;
+    uint64_t deadline = systest_monotonic_ns() + 50000000ULL;
+
+    /* the first change may come part-way through a tick. */
+    for (int changes = 0; changes < 3 && systest_monotonic_ns() < deadline; ) {
+        (void)clock_gettime(id, &ts);
+        uint64_t now = clock_ts_ns(&ts);
+        if (now != last) {
+            if (changes > 0 && now > last && (0 == step || now - last < step))
+                step = now - last;
+            changes++;
+            last = now;
+        }
+    }
+    return step;
+}
+
+# if defined(__HAVE_CPUID__)
+/** Reports whether the TSC is invariant, what CPUID says its frequency is,
+ * and what it measures as against CLOCK_MONOTONIC. */
+static void print_tsc(void) {
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    bool invariant = false;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) && eax >= 0x80000007 &&
+        __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        invariant = (edx & (1U << 8));
+
+    /* leaf 0x15: TSC = crystal * ebx / eax, if the crystal is given. */
+    double cpuid_mhz = 0.0;
+    unsigned max_leaf = __get_cpuid_max(0, NULL);
+    if (max_leaf >= 0x15 && __get_cpuid(0x15, &eax, &ebx, &ecx, &edx) && eax && ebx && ecx)
+        cpuid_mhz = ((double)ecx * (double)ebx / (double)eax) / 1e6;
+    else if (max_leaf >= 0x16 && __get_cpuid(0x16, &eax, &ebx, &ecx, &edx) && (eax & 0xffff))
+        cpuid_mhz = (double)(eax & 0xffff); /* base frequency: usually, not always, the TSC's */
+
+    uint64_t start_ns = systest_monotonic_ns();
+    uint64_t start_tsc = __builtin_ia32_rdtsc();
+    while (systest_monotonic_ns() - start_ns < 20000000ULL)
+        ;
+    uint64_t tsc = __builtin_ia32_rdtsc() - start_tsc;
+    uint64_t ns = systest_monotonic_ns() - start_ns;
+    double measured_mhz = (double)tsc * 1e3 / (double)ns;
+
+    uint64_t begin = systest_monotonic_ns();
+    volatile uint64_t sink = 0;
+    for (int n = 0; n < CLOCK_CALLS; n++)
+        sink += __builtin_ia32_rdtsc();
+    (void)sink;
+    double rdtsc_ns = (double)(systest_monotonic_ns() - begin) / CLOCK_CALLS;
+
+    if (invariant)
+        systest_printf("TSC: invariant");
+    else
+        systest_printf(YELLOW("TSC: not invariant; it may change rate with power states"));
+    if (cpuid_mhz > 0.0)
+        systest_printf(", %.1f MHz per CPUID", cpuid_mhz);
+    systest_printf(", %.1f MHz measured, rdtsc %.1f ns\n", measured_mhz, rdtsc_ns);
+}
+# endif
+
+bool check_clocks(void) {
+    bool passed = true;
+
+# if defined(__linux__)
+    char source[64] = "", available[256] = "";
+    FILE* f = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+    if (f) {
+        if (fgets(source, sizeof(source), f))
+            source[strcspn(source, "\n")] = '\0';
+        (void)fclose(f);
+    }
+    f = fopen("/sys/devices/system/clocksource/clocksource0/available_clocksource", "r");
+    if (f) {
+        if (fgets(available, sizeof(available), f)) {
+            size_t len = strcspn(available, "\n");
+            while (len > 0 && ' ' == available[len - 1])
+                len--;
+            available[len] = '\0';
+        }
+        (void)fclose(f);
+    }
+    systest_printf("clocksource: %s (available: %s)\n", source[0] ? source : "?", available[0] ? available : "?");
+
+    unsigned long vdso = getauxval(AT_SYSINFO_EHDR);
+    systest_printf("vDSO: %s\n", vdso ? "mapped" : "not mapped");
+# endif
+
+    systest_printf("%-17s %9s %9s %9s", "clock", "res ns", "step ns", "ns/call");
+# if defined(__linux__)
+    systest_printf(" %11s  %s", "syscall ns", "via");
+# endif
+    systest_printf("\n");
+
+    for (size_t n = 0; n < __countof(clock_ids); n++) {
+        struct timespec res;
+        if (0 != clock_getres(clock_ids[n].id, &res)) {
+            systest_printf("%-17s %s\n", clock_ids[n].name, strerror(errno));
+            passed &= (CLOCK_REALTIME != clock_ids[n].id && CLOCK_MONOTONIC != clock_ids[n].id);
+            continue;
+        }
+
+        bool backwards = false;
+        double cost = clock_cost(clock_ids[n].id, &backwards);
+        uint64_t step = clock_step(clock_ids[n].id);
+        systest_printf("%-17s %9" PRIu64 " %9" PRIu64 " %9.1f", clock_ids[n].name, clock_ts_ns(&res), step, cost);
+# if defined(__linux__)
+        /* the vDSO is several times cheaper than the kernel round trip. */
+        double raw = clock_syscall_cost(clock_ids[n].id);
+        bool fast = (cost < raw / 2.0);
+        systest_printf(" %11.1f  %s", raw, fast ? "vDSO" : "syscall");
+        if (!fast && CLOCK_MONOTONIC == clock_ids[n].id)
+            systest_printf(YELLOW(" (clocksource %s isn't vDSO-capable?)"), source[0] ? source : "?");
+# endif
+        systest_printf("\n");
+
+        if (backwards && clock_ids[n].monotonic) {
+            systest_printf(RED("%s went backwards!") "\n", clock_ids[n].name);
+            passed = false;
+        }
+    }
+
+# if defined(__HAVE_CPUID__)
+    print_tsc();
+# endif
+    return passed;
+}
+#endif
+
+#if defined(__linux__) && defined(__HAVE_SCHED__)
+/* --- timer jitter, cyclictest-style: how late each way of sleeping wakes
+ * up, with the default timer slack, with 1 ns of slack and under
+ * SCHED_FIFO --- */
+
+# define TIMER_MAX_SAMPLES 10000
+# define TIMER_MIN_SAMPLES 20
+
+typedef enum {
+    SLEEP_NANOSLEEP,
+    SLEEP_ABSTIME,
+    SLEEP_TIMERFD,
+    SLEEP_EPOLL,
+    SLEEP_METHODS
+} sleep_method;
+
+static const char* const timer_names[SLEEP_METHODS] = {
+    "nanosleep", "clock_nanosleep ABSTIME", "timerfd", "epoll_wait"
+};
+
+static const uint64_t timer_intervals_ns[] = {10000, 100000, 1000000, 10000000};
+
+typedef enum {
+    SLEEP_DEFAULT,
+    SLEEP_SLACK,
+    SLEEP_FIFO,
+    SLEEP_CONFIGS
+} sleep_config;
+
+typedef struct {
+    bool valid;
+    uint64_t p50, p99, max;
+} timer_stats;
+
+static bool timer_epoll(int epfd, uint64_t interval_ns, bool precise) {
+    struct epoll_event event;
+# if defined(SYS_epoll_pwait2)
+    if (precise) {
+        struct timespec ts = {(time_t)(interval_ns / 1000000000ULL), (long)(interval_ns % 1000000000ULL)};
+        return -1 != syscall(SYS_epoll_pwait2, epfd, &event, 1, &ts, NULL, (size_t)0);
+    }
+# else
+    (void)precise;
+# endif
+    return -1 != epoll_wait(epfd, &event, 1, (int)(interval_ns / 1000000ULL));
+}
+
+/** Sleeps count times for interval_ns by method, and records how late
+ * each wake-up was, in nanoseconds. */
+static bool timer_measure(sleep_method method, uint64_t interval_ns, int tfd, int epfd, bool precise_epoll,
+    uint64_t* samples, size_t count) {
+    struct timespec next;
+    (void)clock_gettime(CLOCK_MONOTONIC, &next);
+    for (size_t n = 0; n < count; n++) {
+        uint64_t start = systest_monotonic_ns(), target = start + interval_ns;
+        struct timespec ts = {(time_t)(interval_ns / 1000000000ULL), (long)(interval_ns % 1000000000ULL)};
+        struct itimerspec its = {{0, 0}, ts};
+        uint64_t expirations = 0;
+        bool ok = true;
+
+        switch (method) {
+            case SLEEP_NANOSLEEP:
+                ok = (0 == nanosleep(&ts, NULL));
+                break;
+            case SLEEP_ABSTIME:
+                /* periodic, as cyclictest does; start over after an overrun. */
+                next.tv_nsec += (long)(interval_ns % 1000000000ULL);
+                next.tv_sec += (time_t)(interval_ns / 1000000000ULL) + (next.tv_nsec / 1000000000L);
+                next.tv_nsec %= 1000000000L;
+                target = clock_ts_ns(&next);
+                if (target <= start) {
+                    target = start + interval_ns;
+                    next.tv_sec = (time_t)(target / 1000000000ULL);
+                    next.tv_nsec = (long)(target % 1000000000ULL);
+                }
+                ok = (0 == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL));
+                break;
+            case SLEEP_TIMERFD:
+                ok = (0 == timerfd_settime(tfd, 0, &its, NULL)) &&
+                    (sizeof(expirations) == read(tfd, &expirations, sizeof(expirations)));
+                break;
+            case SLEEP_EPOLL:
+                ok = timer_epoll(epfd, interval_ns, precise_epoll);
+                break;
+            case SLEEP_METHODS:
+                break;
+        }
+        if (!ok)
+            return false;
+
+        uint64_t now = systest_monotonic_ns();
+        samples[n] = now > target ? now - target : 0;
+    }
+    return true;
+}
+
+bool check_timer_bench(void) {
+    uint64_t* samples = malloc(TIMER_MAX_SAMPLES * sizeof(uint64_t));
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    bool passed = (samples && -1 != tfd && -1 != epfd);
+    if (!passed)
+        handle_error(errno, "couldn't set up the timers!");
+
+    /* epoll_wait() only takes milliseconds; epoll_pwait2() (5.11) takes a timespec. */
+    bool precise_epoll = false;
+# if defined(SYS_epoll_pwait2)
+    if (passed) {
+        struct epoll_event event;
+        struct timespec zero = {0, 0};
+        precise_epoll = (-1 != syscall(SYS_epoll_pwait2, epfd, &event, 1, &zero, NULL, (size_t)0));
+    }
+# endif
+
+    int slack = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+    systest_printf("timer slack: %d ns; epoll timeouts via %s\n", slack,
+        precise_epoll ? "epoll_pwait2()" : "epoll_wait() (milliseconds)");
+
+    static timer_stats stats[SLEEP_CONFIGS][SLEEP_METHODS][__countof(timer_intervals_ns)];
+    memset(stats, 0, sizeof(stats));
+    const char* config_names[SLEEP_CONFIGS] = {"default", "slack 1 ns", "SCHED_FIFO"};
+    uint64_t budget_ns = (uint64_t)opts.bench_ms * 1000000ULL / 2;
+
+    /* put back whatever we were started with, e.g. under chrt. */
+    struct sched_param saved_param;
+    int saved_policy = sched_getscheduler(0);
+    if (-1 != saved_policy && 0 != sched_getparam(0, &saved_param))
+        saved_policy = -1;
+
+    for (int config = 0; passed && config < SLEEP_CONFIGS; config++) {
+        if (SLEEP_SLACK == config && 0 != prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0)) {
+            systest_printf("PR_SET_TIMERSLACK: %s\n", strerror(errno));
+            continue;
+        }
+        if (SLEEP_FIFO == config) {
+            struct sched_param param = {.sched_priority = 1};
+            if (-1 == saved_policy) {
+                systest_printf("SCHED_FIFO: skipped, couldn't save the current policy\n");
+                continue;
+            }
+            if (0 != sched_setscheduler(0, SCHED_FIFO, &param)) {
+                systest_printf("SCHED_FIFO: %s\n", strerror(errno));
+                continue;
+            }
+        }
+
+        for (int method = 0; passed && method < SLEEP_METHODS; method++) {
+            for (size_t i = 0; passed && i < __countof(timer_intervals_ns); i++) {
+                uint64_t interval = timer_intervals_ns[i];
+                if (SLEEP_EPOLL == method && !precise_epoll && interval < 1000000ULL)
+                    continue;
+
+                size_t count = (size_t)(budget_ns / interval);
+                count = count < TIMER_MIN_SAMPLES ? TIMER_MIN_SAMPLES : count;
+                count = count > TIMER_MAX_SAMPLES ? TIMER_MAX_SAMPLES : count;
+                if (!timer_measure((sleep_method)method, interval, tfd, epfd, precise_epoll, samples, count)) {
+                    systest_printf(RED("%s: %s") "\n", timer_names[method], strerror(errno));
+                    passed = false;
+                    break;
+                }
+
+                /* the histograms for the defaults; the other configurations are summarised. */
+                char label[64];
+                (void)snprintf(label, sizeof(label), "%s, %" PRIu64 " us: oversleep", timer_names[method],
+                    interval / 1000);
+                if (SLEEP_DEFAULT == config)
+                    print_latency_stats(label, samples, count);
+                else
+                    systest_sortu64(samples, count);
+                stats[config][method][i] = (timer_stats){true, systest_percentile(samples, count, 50.0),
+                    systest_percentile(samples, count, 99.0), samples[count - 1]};
+            }
+        }
+
+        if (SLEEP_SLACK == config)
+            (void)prctl(PR_SET_TIMERSLACK, (unsigned long)(slack > 0 ? slack : 0), 0, 0, 0);
+        if (SLEEP_FIFO == config)
+            (void)sched_setscheduler(0, saved_policy, &saved_param);
+    }
+
+    if (passed) {
+        systest_printf("oversleep p50/p99/max, us:\n%-32s", "");
+        for (int config = 0; config < SLEEP_CONFIGS; config++)
+            systest_printf(" %22s", config_names[config]);
+        systest_printf("\n");
+        for (int method = 0; method < SLEEP_METHODS; method++) {
+            for (size_t i = 0; i < __countof(timer_intervals_ns); i++) {
+                if (!stats[SLEEP_DEFAULT][method][i].valid)
+                    continue;
+                char label[48];
+                (void)snprintf(label, sizeof(label), "%s, %" PRIu64 " us", timer_names[method],
+                    timer_intervals_ns[i] / 1000);
+                systest_printf("%-32s", label);
+                for (int config = 0; config < SLEEP_CONFIGS; config++) {
+                    const timer_stats* st = &stats[config][method][i];
+                    char cell[48] = "-";
+                    if (st->valid) {
+                        (void)snprintf(cell, sizeof(cell), "%.0f/%.0f/%.0f", (double)st->p50 / 1e3,
+                            (double)st->p99 / 1e3, (double)st->max / 1e3);
+                    }
+                    systest_printf(" %22s", cell);
+                }
+                systest_printf("\n");
+            }
+        }
+    }
+
+    systest_safeclose(&tfd);
+    systest_safeclose(&epfd);
+    systest_safefree(&samples);
+    return passed;
+}
+#endif
+
+/* --- SIMD dispatch benchmark: each kernel in plain C and in every vector
+ * flavour the CPU supports, selected at run time --- */
+
+#if (defined(__x86_64__) && defined(__HAVE_CPUID__)) || \
+    (defined(__aarch64__) && defined(__HAVE_HWCAP__) && defined(__GNUC__))
+# define __HAVE_SIMD_BENCH__
+
+# if defined(__x86_64__)
+#  include <immintrin.h>
+# else
+#  include <arm_neon.h>
+#  include <arm_acle.h>
+# endif
+
+/* keeps the compiler from vectorizing the "scalar" versions behind our back. */
+# if defined(__clang__)
+#  define SIMD_SCALAR __attribute__((noinline))
+#  define SIMD_SCALAR_LOOP _Pragma("clang loop vectorize(disable) interleave(disable)")
+# else
+#  define SIMD_SCALAR __attribute__((noinline, optimize("no-tree-vectorize")))
+#  define SIMD_SCALAR_LOOP
+# endif
+
+/** Every kernel takes the buffer and returns something to check: the offset
+ * of the first match (memchr), the checksum (crc32c) or the total (sum). */
+typedef uint64_t (*simd_fn)(const unsigned char* buf, size_t len);
+
+/** The byte simd_memchr_* look for; the buffer only has it at the end. */
+# define SIMD_NEEDLE 0xa5
+
+static uint64_t simd_memchr_libc(const unsigned char* buf, size_t len) {
+    const unsigned char* hit = memchr(buf, SIMD_NEEDLE, len);
+    return hit ? (uint64_t)(hit - buf) : len;
+}
+
+SIMD_SCALAR static uint64_t simd_memchr_scalar(const unsigned char* buf, size_t len) {
+    SIMD_SCALAR_LOOP
+    for (size_t n = 0; n < len; n++) {
+        if (SIMD_NEEDLE == buf[n])
+            return n;
+    }
+    return len;
+}
+
+static uint32_t simd_crc32c_table[256];
+
+static void simd_crc32c_init(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t crc = n;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0x82f63b78U & (0U - (crc & 1U)));
+        simd_crc32c_table[n] = crc;
+    }
+}
+
+SIMD_SCALAR static uint64_t simd_crc32c_scalar(const unsigned char* buf, size_t len) {
+    uint32_t crc = 0xffffffffU;
+    SIMD_SCALAR_LOOP
+    for (size_t n = 0; n < len; n++)
+        crc = simd_crc32c_table[(crc ^ buf[n]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffU;
+}
+
+SIMD_SCALAR static uint64_t simd_sum_scalar(const unsigned char* buf, size_t len) {
+    const uint32_t* words = (const uint32_t*)(const void*)buf;
+    uint64_t sum = 0;
+    SIMD_SCALAR_LOOP
+    for (size_t n = 0; n < len / sizeof(uint32_t); n++)
+        sum += words[n];
+    return sum;
+}
+
+# if defined(__x86_64__)
+static uint64_t simd_memchr_sse2(const unsigned char* buf, size_t len) {
+    const __m128i needle = _mm_set1_epi8((char)SIMD_NEEDLE);
+    size_t n = 0;
+    for (; n + 16 <= len; n += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(const void*)(buf + n));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle));
+        if (mask)
+            return n + (uint64_t)__builtin_ctz(mask);
+    }
+    for (; n < len; n++) {
+        if (SIMD_NEEDLE == buf[n])
+            return n;
+    }
+    return len;
+}
+
+__attribute__((target("avx2")))
+static uint64_t simd_memchr_avx2(const unsigned char* buf, size_t len) {
+    const __m256i needle = _mm256_set1_epi8((char)SIMD_NEEDLE);
+    size_t n = 0;
+    for (; n + 32 <= len; n += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(const void*)(buf + n));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle));
+        if (mask)
+            return n + (uint64_t)__builtin_ctz(mask);
+    }
+    for (; n < len; n++) {
+        if (SIMD_NEEDLE == buf[n])
+            return n;
+    }
+    return len;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static uint64_t simd_memchr_avx512(const unsigned char* buf, size_t len) {
+    const __m512i needle = _mm512_set1_epi8((char)SIMD_NEEDLE);
+    size_t n = 0;
+    for (; n + 64 <= len; n += 64) {
+        __m512i v = _mm512_loadu_si512((const void*)(buf + n));
+        __mmask64 mask = _mm512_cmpeq_epi8_mask(v, needle);
+        if (mask)
+            return n + (uint64_t)__builtin_ctzll(mask);
+    }
+    for (; n < len; n++) {
+        if (SIMD_NEEDLE == buf[n])
+            return n;
+    }
+    return len;
+}
+
+__attribute__((target("sse4.2")))
+static uint64_t simd_crc32c_sse42(const unsigned char* buf, size_t len) {
+    uint64_t crc = 0xffffffffU;
+    size_t n = 0;
+    for (; n + 8 <= len; n += 8) {
+        uint64_t word;
+        memcpy(&word, buf + n, sizeof(word));
+        crc = _mm_crc32_u64(crc, word);
+    }
+    uint32_t crc32 = (uint32_t)crc;
+    for (; n < len; n++)
+        crc32 = _mm_crc32_u8(crc32, buf[n]);
+    return crc32 ^ 0xffffffffU;
+}
+
+static uint64_t simd_sum_sse2(const unsigned char* buf, size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    size_t words = len / sizeof(uint32_t), n = 0;
+    for (; n + 4 <= words; n += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(const void*)(buf + (n * sizeof(uint32_t))));
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)(void*)lanes, acc);
+    uint64_t sum = lanes[0] + lanes[1];
+    for (; n < words; n++) {
+        uint32_t word;
+        memcpy(&word, buf + (n * sizeof(uint32_t)), sizeof(word));
+        sum += word;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2")))
+static uint64_t simd_sum_avx2(const unsigned char* buf, size_t len) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t words = len / sizeof(uint32_t), n = 0;
+    for (; n + 8 <= words; n += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(const void*)(buf + (n * sizeof(uint32_t))));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)(void*)lanes, acc);
+    uint64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; n < words; n++) {
+        uint32_t word;
+        memcpy(&word, buf + (n * sizeof(uint32_t)), sizeof(word));
+        sum += word;
+    }
+    return sum;
+}
+
+__attribute__((target("avx512f")))
+static uint64_t simd_sum_avx512(const unsigned char* buf, size_t len) {
+    __m512i acc = _mm512_setzero_si512();
+    size_t words = len / sizeof(uint32_t), n = 0;
+    for (; n + 16 <= words; n += 16) {
+        const unsigned char* p = buf + (n * sizeof(uint32_t));
+        acc = _mm512_add_epi64(acc, _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i*)(const void*)p)));
+        acc = _mm512_add_epi64(acc, _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i*)(const void*)(p + 32))));
+    }
+    uint64_t sum = (uint64_t)_mm512_reduce_add_epi64(acc);
+    for (; n < words; n++) {
+        uint32_t word;
+        memcpy(&word, buf + (n * sizeof(uint32_t)), sizeof(word));
+        sum += word;
+    }
+    return sum;
+}
+# else /* __aarch64__ */
+static uint64_t simd_memchr_neon(const unsigned char* buf, size_t len) {
+    const uint8x16_t needle = vdupq_n_u8(SIMD_NEEDLE);
+    size_t n = 0;
+    for (; n + 16 <= len; n += 16) {
+        if (0 != vmaxvq_u8(vceqq_u8(vld1q_u8(buf + n), needle)))
+            break;
+    }
+    for (; n < len; n++) {
+        if (SIMD_NEEDLE == buf[n])
+            return n;
+    }
+    return len;
+}
+
+__attribute__((target("+crc")))
+static uint64_t simd_crc32c_armv8(const unsigned char* buf, size_t len) {
+    uint32_t crc = 0xffffffffU;
+    size_t n = 0;
+    for (; n + 8 <= len; n += 8) {
+        uint64_t word;
+        memcpy(&word, buf + n, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    for (; n < len; n++)
+        crc = __crc32cb(crc, buf[n]);
+    return crc ^ 0xffffffffU;
+}
+
+static uint64_t simd_sum_neon(const unsigned char* buf, size_t len) {
+    uint64x2_t acc = vdupq_n_u64(0);
+    size_t words = len / sizeof(uint32_t), n = 0;
+    for (; n + 4 <= words; n += 4)
+        acc = vpadalq_u32(acc, vld1q_u32((const uint32_t*)(const void*)(buf + (n * sizeof(uint32_t)))));
+    uint64_t sum = vaddvq_u64(acc);
+    for (; n < words; n++) {
+        uint32_t word;
+        memcpy(&word, buf + (n * sizeof(uint32_t)), sizeof(word));
+        sum += word;
+    }
+    return sum;
+}
+# endif
+
+/** -1: no feature needed. */
+static const struct {
+    const char* kernel;
+    const char* variant;
+    int feature;
+    simd_fn fn;
+} simd_kernels[] = {
+    {"memchr", "scalar",   -1,                   &simd_memchr_scalar},
+    {"memchr", "libc",     -1,                   &simd_memchr_libc},
+# if defined(__x86_64__)
+    {"memchr", "sse2",     -1,                   &simd_memchr_sse2},
+    {"memchr", "avx2",     SYSTEST_CPU_AVX2,     &simd_memchr_avx2},
+    {"memchr", "avx512bw", SYSTEST_CPU_AVX512BW, &simd_memchr_avx512},
+# else
+    {"memchr", "neon",     SYSTEST_CPU_NEON,     &simd_memchr_neon},
+# endif
+    {"crc32c", "scalar",   -1,                   &simd_crc32c_scalar},
+# if defined(__x86_64__)
+    {"crc32c", "sse4.2",   SYSTEST_CPU_SSE42,    &simd_crc32c_sse42},
+# else
+    {"crc32c", "crc32",    SYSTEST_CPU_CRC32,    &simd_crc32c_armv8},
+# endif
+    {"sum",    "scalar",   -1,                   &simd_sum_scalar},
+# if defined(__x86_64__)
+    {"sum",    "sse2",     -1,                   &simd_sum_sse2},
+    {"sum",    "avx2",     SYSTEST_CPU_AVX2,     &simd_sum_avx2},
+    {"sum",    "avx512f",  SYSTEST_CPU_AVX512F,  &simd_sum_avx512},
+# else
+    {"sum",    "neon",     SYSTEST_CPU_NEON,     &simd_sum_neon},
+# endif
+};
+
+/** Buffer size: big enough to stream, small enough to stay in L2/L3. */
+# define SIMD_BUF_SIZE (1024 * 1024)
+
+bool check_simd_bench(void) {
+    const uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL / 4;
+    uint64_t features = systest_getcpufeatures();
+
+    uint32_t* words = malloc(SIMD_BUF_SIZE);
+    if (!words) {
+        handle_error(errno, "malloc() failed!");
+        return false;
+    }
+
+    /* random, but with the memchr needle only in the last byte. */
+    uint64_t seed = 0x2545f4914f6cdd1dULL;
+    for (size_t n = 0; n < SIMD_BUF_SIZE / sizeof(uint32_t); n++)
+        words[n] = (uint32_t)systest_rand64(&seed);
+    unsigned char* buf = (unsigned char*)words;
+    for (size_t n = 0; n < SIMD_BUF_SIZE; n++) {
+        if (SIMD_NEEDLE == buf[n])
+            buf[n] = 0;
+    }
+    buf[SIMD_BUF_SIZE - 1] = SIMD_NEEDLE;
+
+    simd_crc32c_init();
+    bool passed = (0xe3069283U == simd_crc32c_scalar((const unsigned char*)"123456789", 9));
+    if (!passed)
+        systest_printf(RED("scalar crc32c fails its check value") "\n");
+
+    systest_printf("%-8s %-10s %10s %9s\n", "kernel", "variant", "GiB/s", "speedup");
+
+    double scalar_rate = 0.0;
+    uint64_t expected  = 0;
+    for (size_t n = 0; n < __countof(simd_kernels) && passed; n++) {
+        bool first = (0 == n || 0 != strcmp(simd_kernels[n].kernel, simd_kernels[n - 1].kernel));
+        if (-1 != simd_kernels[n].feature && !(features & (1ULL << simd_kernels[n].feature))) {
+            systest_printf("%-8s %-10s %10s\n", simd_kernels[n].kernel, simd_kernels[n].variant,
+                "n/a");
+            continue;
+        }
+
+        uint64_t result = 0, passes = 0, start = systest_monotonic_ns(), elapsed = 0;
+        do {
+            result = simd_kernels[n].fn(buf, SIMD_BUF_SIZE);
+            passes++;
+            elapsed = systest_monotonic_ns() - start;
+        } while (elapsed < duration_ns);
+
+        double rate = ((double)passes * SIMD_BUF_SIZE / (1024.0 * 1024.0 * 1024.0)) / ((double)elapsed / 1e9);
+        if (first) {
+            scalar_rate = rate;
+            expected    = result;
+        } else if (result != expected) {
+            systest_printf(RED("%s/%s: got %" PRIu64 ", expected %" PRIu64) "\n",
+                simd_kernels[n].kernel, simd_kernels[n].variant, result, expected);
+            passed = false;
+            break;
+        }
+
+        systest_printf("%-8s %-10s %10.2f %8.2fx\n", simd_kernels[n].kernel, simd_kernels[n].variant,
+            rate, rate / scalar_rate);
+    }
+
+    systest_safefree(&words);
+    return passed;
+}
+#endif
+
+/* macOS has no pthread barriers. */
+#if defined(__HAVE_PTHREADS__) && !defined(__WIN__) && !defined(__MACOS__)
+/** The L1 data cache line size the C library reports, or 0 if it can't
+ * tell: _SC_LEVEL1_DCACHE_LINESIZE is a glibc extension. */
+static size_t cache_line_size(void) {
+# if defined(_SC_LEVEL1_DCACHE_LINESIZE)
+    long line = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    return line > 0 ? (size_t)line : 0;
+# else
+    return 0;
+# endif
+}
+
+/* --- STREAM-style bandwidth: copy, scale, add and triad over arrays much
+ * bigger than the caches, on 1..N threads --- */
+
+# define STREAM_ITERATIONS 5
+# define STREAM_MIN_ARRAY (16ULL * 1024 * 1024) /**< Bytes per array, at least. */
+# define STREAM_SCALAR 3.0
+
+typedef enum {
+    STREAM_COPY,
+    STREAM_SCALE,
+    STREAM_ADD,
+    STREAM_TRIAD,
+    STREAM_KERNELS
+} stream_kernel;
+
+static const struct { const char* name; unsigned arrays; } stream_kernels[STREAM_KERNELS] = {
+    {"copy", 2}, {"scale", 2}, {"add", 3}, {"triad", 3}
+};
+
+/** Holds the threads back until all of them exist, so that if one can't be
+ * created the others can be sent home instead of left at a barrier which
+ * counts on it. Shared by the stream and lock benchmarks. */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool open;
+    bool cancel;
+} bench_gate;
+
+/** Returns false if the run was called off. */
+static bool bench_gate_wait(bench_gate* gate) {
+    (void)pthread_mutex_lock(&gate->lock);
+    while (!gate->open)
+        (void)pthread_cond_wait(&gate->cond, &gate->lock);
+    bool cancel = gate->cancel;
+    (void)pthread_mutex_unlock(&gate->lock);
+    return !cancel;
+}
+
+static void bench_gate_open(bench_gate* gate, bool cancel) {
+    (void)pthread_mutex_lock(&gate->lock);
+    gate->cancel = cancel;
+    gate->open   = true;
+    (void)pthread_cond_broadcast(&gate->cond);
+    (void)pthread_mutex_unlock(&gate->lock);
+}
+
+typedef struct {
+    double* a;
+    double* b;
+    double* c;
+    size_t begin;
+    size_t end;
+    bench_gate* gate;
+    pthread_barrier_t* barrier;
+    uint64_t* best_ns; /**< Per kernel; only thread 0 writes these. */
+    bool timer;        /**< This is thread 0. */
+} stream_job;
+
+static void* stream_worker(void* arg) {
+    stream_job* job = (stream_job*)arg;
+    double* restrict a = job->a;
+    double* restrict b = job->b;
+    double* restrict c = job->c;
+
+    if (!bench_gate_wait(job->gate))
+        return NULL;
+
+    for (size_t n = job->begin; n < job->end; n++) {
+        a[n] = 1.0;
+        b[n] = 2.0;
+        c[n] = 0.0;
+    }
+
+    for (int iter = 0; iter < STREAM_ITERATIONS; iter++) {
+        for (int k = 0; k < STREAM_KERNELS; k++) {
+            (void)pthread_barrier_wait(job->barrier);
+            uint64_t start = job->timer ? systest_monotonic_ns() : 0;
+
+            switch ((stream_kernel)k) {
+                case STREAM_COPY:
+                    for (size_t n = job->begin; n < job->end; n++)
+                        c[n] = a[n];
+                    break;
+                case STREAM_SCALE:
+                    for (size_t n = job->begin; n < job->end; n++)
+                        b[n] = STREAM_SCALAR * c[n];
+                    break;
+                case STREAM_ADD:
+                    for (size_t n = job->begin; n < job->end; n++)
+                        c[n] = a[n] + b[n];
+                    break;
+                case STREAM_TRIAD:
+                    for (size_t n = job->begin; n < job->end; n++)
+                        a[n] = b[n] + (STREAM_SCALAR * c[n]);
+                    break;
+                case STREAM_KERNELS:
+                    break;
+            }
+
+            (void)pthread_barrier_wait(job->barrier);
+            if (job->timer) {
+                uint64_t took = systest_monotonic_ns() - start;
+                if (0 == job->best_ns[k] || took < job->best_ns[k])
+                    job->best_ns[k] = took;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/** Runs every kernel on nthreads threads; best_ns receives the fastest
+ * iteration of each. The arrays are checked afterwards, as STREAM does. */
+static bool stream_run(double* a, double* b, double* c, size_t count, size_t nthreads,
+    uint64_t best_ns[STREAM_KERNELS]) {
+    stream_job* jobs     = calloc(nthreads, sizeof(stream_job));
+    pthread_t* threads   = calloc(nthreads, sizeof(pthread_t));
+    bench_gate gate = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, false, false};
+    pthread_barrier_t barrier;
+    bool passed = false;
+    size_t started = 1;
+
+    memset(best_ns, 0, STREAM_KERNELS * sizeof(uint64_t));
+    if (!jobs || !threads) {
+        handle_error(ENOMEM, "couldn't set up stream threads!");
+        goto cleanup;
+    }
+
+    for (size_t n = 0; n < nthreads; n++) {
+        jobs[n] = (stream_job){a, b, c, (count * n) / nthreads, (count * (n + 1)) / nthreads,
+            &gate, &barrier, best_ns, 0 == n};
+    }
+
+    int ret = 0;
+    for (; started < nthreads; started++) {
+        ret = pthread_create(&threads[started], NULL, &stream_worker, &jobs[started]);
+        if (0 != ret) {
+            handle_error(ret, "pthread_create() failed!");
+            break;
+        }
+    }
+    if (0 == ret && 0 != (ret = pthread_barrier_init(&barrier, NULL, (unsigned)nthreads)))
+        handle_error(ret, "pthread_barrier_init() failed!");
+
+    /* thread 0 is this one, so it goes through the gate it opens. */
+    bench_gate_open(&gate, 0 != ret);
+    if (0 == ret)
+        (void)stream_worker(&jobs[0]);
+    for (size_t n = 1; n < started; n++)
+        (void)pthread_join(threads[n], NULL);
+    if (0 != ret)
+        goto cleanup;
+    (void)pthread_barrier_destroy(&barrier);
+
+    double ea = 1.0, eb = 2.0, ec = 0.0;
+    for (int iter = 0; iter < STREAM_ITERATIONS; iter++) {
+        ec = ea;
+        eb = STREAM_SCALAR * ec;
+        ec = ea + eb;
+        ea = eb + (STREAM_SCALAR * ec);
+    }
+    passed = true;
+    for (size_t n = 0; n < count; n += (count / 7) + 1)
+        passed &= (a[n] == ea && b[n] == eb && c[n] == ec);
+
+cleanup:
+    systest_safefree(&jobs);
+    systest_safefree(&threads);
+    return passed;
+}
+
+/* --- pointer chasing: one dependent load after another through a random
+ * cycle of cache lines, over working sets from 4 KiB up --- */
+
+# define CHASE_MIN_SIZE (4ULL * 1024)
+# define CHASE_STEPS 4096
+
+/** Formats a power-of-two-ish size as "4 KiB", "2 MiB"... */
+static void size_str_binary(uint64_t size, char* buf, size_t len) {
+    if (size >= 1024ULL * 1024 * 1024)
+        (void)snprintf(buf, len, "%" PRIu64 " GiB", size >> 30);
+    else if (size >= 1024ULL * 1024)
+        (void)snprintf(buf, len, "%" PRIu64 " MiB", size >> 20);
+    else
+        (void)snprintf(buf, len, "%" PRIu64 " KiB", size >> 10);
+}
+
+/** Where, within its stride, node slot goes: the start, or with a stride of
+ * several cache lines, a scrambled line so the nodes don't all share a set. */
+static size_t chase_offset(size_t slot, size_t stride, size_t line) {
+    if (stride <= line)
+        return slot * stride;
+    uint64_t scramble = ((uint64_t)slot * 0x9e3779b97f4a7c15ULL) >> 40;
+    return (slot * stride) + ((size_t)(scramble % (stride / line)) * line);
+}
+
+/** Links the first size bytes of buf into a single random cycle with one
+ * node per stride bytes (Sattolo's algorithm). Returns the start. */
+static void* chase_build(char* buf, size_t size, size_t stride, size_t line, size_t* order,
+    uint64_t* seed) {
+    size_t nodes = size / stride;
+    for (size_t n = 0; n < nodes; n++)
+        order[n] = n;
+    for (size_t n = nodes - 1; n > 0; n--) {
+        size_t j = (size_t)(systest_rand64(seed) % n);
+        size_t t = order[n];
+        order[n] = order[j];
+        order[j] = t;
+    }
+    for (size_t n = 0; n < nodes; n++) {
+        *(void**)(void*)(buf + chase_offset(order[n], stride, line)) =
+            buf + chase_offset(order[(n + 1) % nodes], stride, line);
+    }
+    return buf + chase_offset(order[0], stride, line);
+}
+
+/** Returns the average time, in nanoseconds, of each load. */
+static double chase_measure(void* start, uint64_t duration_ns) {
+    void* p = start;
+    uint64_t steps = 0, begin = systest_monotonic_ns(), elapsed = 0;
+    do {
+        for (int n = 0; n < CHASE_STEPS; n += 8) {
+            p = *(void**)p; p = *(void**)p; p = *(void**)p; p = *(void**)p;
+            p = *(void**)p; p = *(void**)p; p = *(void**)p; p = *(void**)p;
+        }
+        steps += CHASE_STEPS;
+        elapsed = systest_monotonic_ns() - begin;
+    } while (elapsed < duration_ns);
+
+    /* make sure the loads can't be thrown away. */
+    __asm__ __volatile__("" : : "r"(p) : "memory");
+    return (double)elapsed / (double)steps;
+}
+
+bool check_memory_bench(void) {
+    systest_cputopo topo;
+    systest_cgroup_limits limits;
+    bool have_topo = systest_getcputopology(&topo);
+    (void)systest_getcgrouplimits(&limits);
+
+    /* the largest cache, in total, decides how big "much bigger" is. */
+    uint64_t biggest_cache = 0;
+    for (size_t n = 0; have_topo && n < topo.ncaches; n++) {
+        uint64_t total = topo.caches[n].size * (topo.caches[n].instances ? topo.caches[n].instances : 1);
+        if (total > biggest_cache)
+            biggest_cache = total;
+    }
+
+    uint64_t budget = limits.memory_budget / 4;
+    uint64_t array_bytes = biggest_cache * 4 > STREAM_MIN_ARRAY ? biggest_cache * 4 : STREAM_MIN_ARRAY;
+    if (array_bytes * 3 > budget)
+        array_bytes = budget / 3;
+    uint64_t chase_max = (uint64_t)opts.mem_max_mb * 1024ULL * 1024ULL;
+    if (chase_max > budget)
+        chase_max = budget;
+
+    int cpus = 1;
+    (void)systest_getcpucount(&cpus);
+    size_t max_threads = limits.effective_cpus >= 1.0 && limits.effective_cpus < (double)cpus ?
+        (size_t)limits.effective_cpus : (size_t)(cpus > 0 ? cpus : 1);
+
+    size_t count = (size_t)(array_bytes / sizeof(double));
+    double* a = malloc(count * sizeof(double));
+    double* b = malloc(count * sizeof(double));
+    double* c = malloc(count * sizeof(double));
+    bool passed = (a && b && c);
+    if (!passed)
+        handle_error(ENOMEM, "malloc() failed!");
+
+    if (passed) {
+        systest_printf("stream: 3 x %.1f MiB arrays, best of %d\n",
+            (double)array_bytes / (1024.0 * 1024.0), STREAM_ITERATIONS);
+        systest_printf("%7s %10s %10s %10s %10s  (MiB/s)\n", "threads", "copy", "scale", "add", "triad");
+    }
+
+    for (size_t nthreads = 1; passed && nthreads <= max_threads; ) {
+        uint64_t best_ns[STREAM_KERNELS];
+        passed = stream_run(a, b, c, count, nthreads, best_ns);
+        if (!passed) {
+            systest_printf(RED("stream arrays hold the wrong values after %zu thread(s)") "\n", nthreads);
+            break;
+        }
+
+        systest_printf("%7zu", nthreads);
+        for (int k = 0; k < STREAM_KERNELS; k++) {
+            double bytes = (double)stream_kernels[k].arrays * (double)count * sizeof(double);
+            systest_printf(" %10.0f", (bytes / (1024.0 * 1024.0)) / ((double)best_ns[k] / 1e9));
+        }
+        systest_printf("\n");
+
+        if (nthreads == max_threads)
+            break;
+        nthreads = nthreads * 2 > max_threads ? max_threads : nthreads * 2;
+    }
+
+    systest_safefree(&a);
+    systest_safefree(&b);
+    systest_safefree(&c);
+
+    size_t stride = cache_line_size();
+    stride = stride ? stride : 64;
+    char* chase = passed ? malloc((size_t)chase_max) : NULL;
+    size_t* order = passed ? malloc((size_t)(chase_max / stride) * sizeof(size_t)) : NULL;
+    if (passed && (!chase || !order)) {
+        handle_error(ENOMEM, "malloc() failed!");
+        passed = false;
+    }
+
+    if (passed) {
+        uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL / 8;
+        uint64_t seed = 0x853c49e6748fea9bULL;
+        systest_printf("pointer chase: %zu B stride, up to %.0f MiB\n", stride,
+            (double)chase_max / (1024.0 * 1024.0));
+        systest_printf("%12s %10s  %s\n", "working set", "ns/load", "fits in");
+
+        for (uint64_t size = CHASE_MIN_SIZE; size <= chase_max; size *= 2) {
+            void* start = chase_build(chase, (size_t)size, stride, stride, order, &seed);
+            double ns = chase_measure(start, duration_ns);
+
+            /* the smallest data cache it fits in, per core. */
+            const char* level = "memory";
+            char label[16];
+            for (size_t n = 0; have_topo && n < topo.ncaches; n++) {
+                if ('I' != topo.caches[n].type && size <= topo.caches[n].size) {
+                    (void)snprintf(label, sizeof(label), "L%u", topo.caches[n].level);
+                    level = label;
+                    break;
+                }
+            }
+
+            char size_str[16];
+            size_str_binary(size, size_str, sizeof(size_str));
+            systest_printf("%12s %10.2f  %s\n", size_str, ns, level);
+        }
+    }
+
+    systest_safefree(&chase);
+    systest_safefree(&order);
+    if (have_topo)
+        systest_freecputopology(&topo);
+    return passed;
+}
+
+# if defined(__linux__)
+/* --- huge pages: what's configured, whether it can actually be had, and
+ * what the TLB misses it saves are worth --- */
+
+/** Returns how much of the mapping containing addr is backed by transparent
+ * huge pages, according to /proc/self/smaps. */
+static uint64_t huge_thp_bytes(const void* addr) {
+    FILE* smaps = fopen("/proc/self/smaps", "r");
+    if (!smaps)
+        return 0;
+
+    char line[512];
+    bool inside = false;
+    uint64_t bytes = 0;
+    while (fgets(line, sizeof(line), smaps)) {
+        unsigned long start = 0, end = 0;
+        unsigned long long kb = 0;
+        if (2 == sscanf(line, "%lx-%lx ", &start, &end)) {
+            inside = ((uintptr_t)addr >= start && (uintptr_t)addr < end);
+        } else if (inside && 1 == sscanf(line, "AnonHugePages: %llu kB", &kb)) {
+            bytes = (uint64_t)kb * 1024;
+            break;
+        }
+    }
+    (void)fclose(smaps);
+    return bytes;
+}
+
+typedef enum {
+    HUGE_NONE,    /**< Plain 4 KiB pages, with THP turned off for the range. */
+    HUGE_THP,     /**< madvise(MADV_HUGEPAGE) on a THP-aligned range. */
+    HUGE_HUGETLB  /**< MAP_HUGETLB, from the pool of the given size. */
+} huge_kind;
+
+typedef struct {
+    char* base;   /**< What to munmap(). */
+    size_t length;
+    char* buf;    /**< size usable bytes, suitably aligned. */
+} huge_mapping;
+
+static bool huge_map(huge_mapping* map, size_t size, huge_kind kind, uint64_t page_size) {
+    memset(map, 0, sizeof(huge_mapping));
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    size_t length = size;
+
+    if (HUGE_HUGETLB == kind) {
+#  if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+        int shift = 0;
+        while ((1ULL << shift) < page_size)
+            shift++;
+        flags |= MAP_HUGETLB | (shift << MAP_HUGE_SHIFT);
+        length = (size_t)(((size + page_size - 1) / page_size) * page_size);
+#  else
+        errno = ENOTSUP;
+        return false;
+#  endif
+    } else if (HUGE_THP == kind) {
+        length = size + (size_t)page_size; /* room to align */
+    }
+
+    char* base = mmap(NULL, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (MAP_FAILED == base)
+        return false;
+    map->base = map->buf = base;
+    map->length = length;
+
+#  if defined(MADV_HUGEPAGE) && defined(MADV_NOHUGEPAGE)
+    int advice = -1;
+    if (HUGE_THP == kind) {
+        map->buf = (char*)(((uintptr_t)base + (uintptr_t)page_size - 1) & ~((uintptr_t)page_size - 1));
+        advice = MADV_HUGEPAGE;
+    } else if (HUGE_NONE == kind) {
+        advice = MADV_NOHUGEPAGE;
+    }
+    if (-1 != advice && 0 != madvise(map->buf, size, advice)) {
+        int err = errno;
+        (void)munmap(map->base, map->length);
+        memset(map, 0, sizeof(huge_mapping));
+        errno = err;
+        return false;
+    }
+#  else
+    if (HUGE_THP == kind) {
+        (void)munmap(map->base, map->length);
+        memset(map, 0, sizeof(huge_mapping));
+        errno = ENOTSUP;
+        return false;
+    }
+#  endif
+    return true;
+}
+
+static void huge_unmap(huge_mapping* map) {
+    if (map->base)
+        (void)munmap(map->base, map->length);
+    memset(map, 0, sizeof(huge_mapping));
+}
+
+bool check_hugepages(void) {
+    systest_hugepages info;
+    if (!systest_gethugepages(&info)) {
+        systest_printf("no transparent or hugetlbfs huge pages on this kernel\n");
+        return true;
+    }
+
+    char size_str[16];
+    bool passed = true;
+    if ('\0' != info.thp_enabled[0]) {
+        size_str_binary(info.thp_size, size_str, sizeof(size_str));
+        systest_printf("THP: enabled=%s defrag=%s shmem=%s, %s pages, %" PRIu64 " MiB in use\n",
+            info.thp_enabled, info.thp_defrag, '\0' != info.thp_shmem[0] ? info.thp_shmem : "?",
+            size_str, info.anon_huge_bytes >> 20);
+
+        /* with "never", madvise() is accepted but does nothing. */
+        huge_mapping map;
+        uint64_t thp_size = info.thp_size ? info.thp_size : 2ULL * 1024 * 1024;
+        if (!huge_map(&map, (size_t)thp_size, HUGE_THP, thp_size)) {
+            handle_error(errno, "MADV_HUGEPAGE mapping failed!");
+            passed = false;
+        } else {
+            memset(map.buf, 1, (size_t)thp_size);
+            uint64_t got = huge_thp_bytes(map.buf);
+            if (got >= thp_size)
+                systest_printf("  MADV_HUGEPAGE: got a huge page\n");
+            else
+                systest_printf(YELLOW("  MADV_HUGEPAGE: got no huge page (enabled=%s, defrag=%s)") "\n",
+                    info.thp_enabled, info.thp_defrag);
+            huge_unmap(&map);
+        }
+    } else {
+        systest_printf("THP: not available\n");
+    }
+
+    size_str_binary(info.default_size, size_str, sizeof(size_str));
+    systest_printf("hugetlb: default page size %s\n", size_str);
+    for (size_t n = 0; n < info.npools; n++) {
+        const systest_hugepage_pool* pool = &info.pools[n];
+        size_str_binary(pool->size, size_str, sizeof(size_str));
+        systest_printf("  %-6s pool: %ld total, %ld free, %ld reserved, %ld surplus, %ld overcommit\n",
+            size_str, pool->total, pool->free, pool->reserved, pool->surplus, pool->overcommit);
+
+        huge_mapping map;
+        if (huge_map(&map, (size_t)pool->size, HUGE_HUGETLB, pool->size)) {
+            memset(map.buf, 1, (size_t)pool->size);
+            systest_printf("  %-6s MAP_HUGETLB: ok\n", size_str);
+            huge_unmap(&map);
+        } else if (pool->free - pool->reserved > 0 || pool->overcommit - pool->surplus > 0) {
+            /* there should have been one to be had. */
+            systest_printf(RED("  %-6s MAP_HUGETLB: %s") "\n", size_str, strerror(errno));
+            passed = false;
+        } else {
+            systest_printf("  %-6s MAP_HUGETLB: %s (none reserved)\n", size_str, strerror(errno));
+        }
+    }
+
+    return passed;
+}
+
+bool check_hugepage_bench(void) {
+    systest_hugepages info;
+    systest_cgroup_limits limits;
+    bool have_info = systest_gethugepages(&info);
+    (void)systest_getcgrouplimits(&limits);
+
+    /* big enough that 4 KiB pages overwhelm the TLB, which 2 MiB ones won't. */
+    uint64_t size = (uint64_t)opts.mem_max_mb * 1024ULL * 1024ULL;
+    if (size > limits.memory_budget / 4)
+        size = limits.memory_budget / 4;
+    size &= ~((2ULL * 1024 * 1024) - 1);
+    if (0 == size) {
+        systest_printf(RED("not enough memory for the benchmark") "\n");
+        return false;
+    }
+
+    long page = sysconf(_SC_PAGESIZE);
+    size_t stride = page > 0 ? (size_t)page : 4096;
+    size_t line_size = cache_line_size();
+    line_size = line_size ? line_size : 64;
+    size_t* order = malloc((size_t)(size / stride) * sizeof(size_t));
+    if (!order) {
+        handle_error(ENOMEM, "malloc() failed!");
+        return false;
+    }
+
+    struct {
+        char name[24];
+        huge_kind kind;
+        uint64_t page_size;
+    } runs[2 + SYSTEST_MAX_HUGEPAGE_SIZES];
+    size_t nruns = 0;
+    char size_str[16];
+
+    size_str_binary(stride, size_str, sizeof(size_str));
+    (void)snprintf(runs[nruns].name, sizeof(runs[nruns].name), "%s", size_str);
+    runs[nruns].kind = HUGE_NONE;
+    runs[nruns++].page_size = stride;
+    if (have_info && '\0' != info.thp_enabled[0] && info.thp_size) {
+        size_str_binary(info.thp_size, size_str, sizeof(size_str));
+        (void)snprintf(runs[nruns].name, sizeof(runs[nruns].name), "THP %s", size_str);
+        runs[nruns].kind = HUGE_THP;
+        runs[nruns++].page_size = info.thp_size;
+    }
+    for (size_t n = 0; have_info && n < info.npools; n++) {
+        size_str_binary(info.pools[n].size, size_str, sizeof(size_str));
+        (void)snprintf(runs[nruns].name, sizeof(runs[nruns].name), "hugetlb %s", size_str);
+        runs[nruns].kind = HUGE_HUGETLB;
+        runs[nruns++].page_size = info.pools[n].size;
+    }
+
+    size_str_binary(size, size_str, sizeof(size_str));
+    systest_printf("random loads over %s, one per %zu B page\n", size_str, stride);
+    systest_printf("%-16s %10s %10s\n", "pages", "ns/load", "vs base");
+
+    uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL;
+    double base_ns = 0.0, best_ns = 0.0;
+    const char* best_name = NULL;
+    bool passed = true;
+    for (size_t n = 0; n < nruns; n++) {
+        huge_mapping map;
+        if (!huge_map(&map, (size_t)size, runs[n].kind, runs[n].page_size)) {
+            if (HUGE_NONE == runs[n].kind) {
+                handle_error(errno, "mmap() failed!");
+                passed = false;
+                break;
+            }
+            systest_printf("%-16s %10s  (%s)\n", runs[n].name, "-", strerror(errno));
+            continue;
+        }
+
+        uint64_t seed = 0x853c49e6748fea9bULL;
+        void* start = chase_build(map.buf, (size_t)size, stride, line_size, order, &seed);
+        double ns = chase_measure(start, duration_ns);
+
+        if (HUGE_NONE == runs[n].kind) {
+            base_ns = ns;
+            systest_printf("%-16s %10.2f\n", runs[n].name, ns);
+        } else {
+            char note[48] = "";
+            if (HUGE_THP == runs[n].kind) {
+                (void)snprintf(note, sizeof(note), "  (%.0f%% huge)",
+                    100.0 * (double)huge_thp_bytes(map.buf) / (double)size);
+            }
+            systest_printf("%-16s %10.2f %+10.2f%s\n", runs[n].name, ns, ns - base_ns, note);
+            if (!best_name || ns < best_ns) {
+                best_ns = ns;
+                best_name = runs[n].name;
+            }
+        }
+        huge_unmap(&map);
+    }
+
+    if (passed && best_name)
+        systest_printf("TLB-miss penalty: ~%.2f ns per load (base pages vs %s)\n", base_ns - best_ns, best_name);
+    else if (passed)
+        systest_printf("no huge pages to compare against\n");
+
+    systest_safefree(&order);
+    return passed;
+}
+
+#  if defined(__HAVE_MEMPOLICY__) && defined(__HAVE_SCHED__)
+/* --- NUMA: where memory actually lands, and what it costs to reach it from
+ * each node. mbind()/get_mempolicy() are called directly, without libnuma. */
+
+#   define NUMA_MASK_WORDS ((SYSTEST_MAX_NODES / (8 * sizeof(unsigned long))) + 1)
+#   define NUMA_CHECK_PAGES 64
+
+static long numa_bind(void* addr, size_t length, int node) {
+    unsigned long mask[NUMA_MASK_WORDS] = {0};
+    mask[(size_t)node / (8 * sizeof(unsigned long))] |= 1UL << ((size_t)node % (8 * sizeof(unsigned long)));
+    return syscall(SYS_mbind, addr, length, MPOL_BIND, mask, (unsigned long)SYSTEST_MAX_NODES + 1,
+        (unsigned)MPOL_MF_STRICT);
+}
+
+/** Returns the node holding the page at addr, or -1. */
+static int numa_page_node(void* addr) {
+    int node = -1;
+    if (0 != syscall(SYS_get_mempolicy, &node, NULL, 0UL, addr, (unsigned long)(MPOL_F_NODE | MPOL_F_ADDR)))
+        return -1;
+    return node;
+}
+
+/** Counts how many of the pages in buf are on node. Fails, with errno set,
+ * if get_mempolicy() can't say: ENOSYS without CONFIG_NUMA, or EPERM under
+ * a seccomp filter. */
+static bool numa_pages_on(char* buf, size_t length, int node, size_t* count) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t step = page > 0 ? (size_t)page : 4096;
+    *count = 0;
+    for (size_t off = 0; off < length; off += step) {
+        int found = numa_page_node(buf + off);
+        if (-1 == found)
+            return false;
+        *count += (node == found);
+    }
+    return true;
+}
+
+/** Pins the calling thread to the allowed CPUs of node. Without NUMA in
+ * sysfs, every CPU counts as node 0. */
+static bool numa_pin(const systest_cputopo* topo, int node) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    size_t count = 0;
+    for (size_t n = 0; n < topo->ncpus; n++) {
+        const systest_cpu* cpu = &topo->cpus[n];
+        if (cpu->allowed && cpu->id < CPU_SETSIZE && (cpu->node == node || (cpu->node < 0 && 0 == node))) {
+            CPU_SET(cpu->id, &set);
+            count++;
+        }
+    }
+    if (0 == count) {
+        errno = ESRCH;
+        return false;
+    }
+    return 0 == sched_setaffinity(0, sizeof(cpu_set_t), &set);
+}
+
+static uint64_t numa_read(const uint64_t* buf, size_t count) {
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t n = 0;
+    for (; n + 4 <= count; n += 4) {
+        s0 += buf[n];
+        s1 += buf[n + 1];
+        s2 += buf[n + 2];
+        s3 += buf[n + 3];
+    }
+    for (; n < count; n++)
+        s0 += buf[n];
+    return s0 + s1 + s2 + s3;
+}
+
+bool check_numa(void) {
+    systest_numa_node* nodes = NULL;
+    size_t count = 0;
+    systest_cputopo topo;
+    if (!systest_getnumanodes(&nodes, &count))
+        return false;
+    if (!systest_getcputopology(&topo)) {
+        free(nodes);
+        return false;
+    }
+
+    systest_printf("%4s %5s %10s %10s  %s\n", "node", "cpus", "mem MiB", "free MiB", "distances");
+    for (size_t n = 0; n < count; n++) {
+        char distances[SYSTEST_MAX_NODES * 5] = {0};
+        size_t len = 0;
+        for (size_t j = 0; j < count && len < sizeof(distances); j++)
+            len += (size_t)snprintf(distances + len, sizeof(distances) - len, " %3d", nodes[n].distance[j]);
+        systest_printf("%4d %5zu %10" PRIu64 " %10" PRIu64 " %s\n", nodes[n].id, nodes[n].cpus,
+            nodes[n].mem_total >> 20, nodes[n].mem_free >> 20, distances);
+    }
+
+    cpu_set_t saved;
+    bool restore = (0 == sched_getaffinity(0, sizeof(cpu_set_t), &saved));
+    long page = sysconf(_SC_PAGESIZE);
+    size_t length = (size_t)NUMA_CHECK_PAGES * (page > 0 ? (size_t)page : 4096);
+    bool passed = true;
+
+    for (size_t n = 0; n < count && passed; n++) {
+        const systest_numa_node* node = &nodes[n];
+        if (0 == node->mem_total)
+            continue;
+
+        /* first touch: memory faulted in by a thread lands on its node. */
+        if (node->cpus > 0 && numa_pin(&topo, node->id)) {
+            char* buf = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (MAP_FAILED == buf) {
+                handle_error(errno, "mmap() failed!");
+                passed = false;
+                break;
+            }
+            memset(buf, 1, length);
+            size_t local = 0;
+            if (!numa_pages_on(buf, length, node->id, &local))
+                systest_printf(YELLOW("node %d: first touch: can't tell: get_mempolicy(): %s") "\n",
+                    node->id, strerror(errno));
+            else if (local == NUMA_CHECK_PAGES)
+                systest_printf("node %d: first touch: all %d pages local\n", node->id, NUMA_CHECK_PAGES);
+            else if (local >= NUMA_CHECK_PAGES / 2)
+                systest_printf(YELLOW("node %d: first touch: %zu of %d pages local") "\n", node->id, local,
+                    NUMA_CHECK_PAGES);
+            else {
+                systest_printf(RED("node %d: first touch: %zu of %d pages local") "\n", node->id, local,
+                    NUMA_CHECK_PAGES);
+                passed = false;
+            }
+            (void)munmap(buf, length);
+        }
+
+        /* mbind(MPOL_BIND) has to be obeyed, wherever we're running. */
+        char* buf = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == buf) {
+            handle_error(errno, "mmap() failed!");
+            passed = false;
+            break;
+        }
+        if (0 != numa_bind(buf, length, node->id)) {
+            /* e.g. EINVAL: not in this cpuset's mems. */
+            systest_printf(YELLOW("node %d: mbind(): %s") "\n", node->id, strerror(errno));
+        } else {
+            memset(buf, 1, length);
+            size_t bound = 0;
+            if (!numa_pages_on(buf, length, node->id, &bound)) {
+                systest_printf(YELLOW("node %d: mbind(MPOL_BIND): can't tell: get_mempolicy(): %s") "\n",
+                    node->id, strerror(errno));
+            } else if (bound == NUMA_CHECK_PAGES) {
+                systest_printf("node %d: mbind(MPOL_BIND): all %d pages on node\n", node->id, NUMA_CHECK_PAGES);
+            } else {
+                systest_printf(RED("node %d: mbind(MPOL_BIND): only %zu of %d pages on node") "\n",
+                    node->id, bound, NUMA_CHECK_PAGES);
+                passed = false;
+            }
+        }
+        (void)munmap(buf, length);
+    }
+
+    if (restore)
+        (void)sched_setaffinity(0, sizeof(cpu_set_t), &saved);
+    systest_freecputopology(&topo);
+    free(nodes);
+    return passed;
+}
+
+bool check_numa_bench(void) {
+    systest_numa_node* nodes = NULL;
+    size_t count = 0;
+    systest_cputopo topo;
+    systest_cgroup_limits limits;
+    if (!systest_getnumanodes(&nodes, &count))
+        return false;
+    if (!systest_getcputopology(&topo)) {
+        free(nodes);
+        return false;
+    }
+    (void)systest_getcgrouplimits(&limits);
+
+    uint64_t size = (uint64_t)opts.mem_max_mb * 1024ULL * 1024ULL;
+    if (size > limits.memory_budget / 4)
+        size = limits.memory_budget / 4;
+    for (size_t n = 0; n < count; n++) {
+        if (nodes[n].mem_total > 0 && size > nodes[n].mem_free / 4)
+            size = nodes[n].mem_free / 4;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    size_t page_size = page > 0 ? (size_t)page : 4096;
+    size_t stride = cache_line_size();
+    stride = stride ? stride : 64;
+    size -= size % page_size;
+
+    double* bandwidth = calloc(count * count, sizeof(double));
+    double* latency = calloc(count * count, sizeof(double));
+    size_t* order = size ? malloc((size_t)(size / stride) * sizeof(size_t)) : NULL;
+    if (!bandwidth || !latency || !order) {
+        handle_error(ENOMEM, "couldn't allocate the benchmark buffers!");
+        systest_safefree(&bandwidth);
+        systest_safefree(&latency);
+        systest_safefree(&order);
+        systest_freecputopology(&topo);
+        free(nodes);
+        return false;
+    }
+
+    cpu_set_t saved;
+    bool restore = (0 == sched_getaffinity(0, sizeof(cpu_set_t), &saved));
+    uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL / 2;
+    bool passed = true;
+
+    for (size_t i = 0; i < count && passed; i++) {
+        if (0 == nodes[i].cpus || !numa_pin(&topo, nodes[i].id))
+            continue;
+
+        for (size_t j = 0; j < count && passed; j++) {
+            if (0 == nodes[j].mem_total)
+                continue;
+
+            char* buf = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (MAP_FAILED == buf) {
+                handle_error(errno, "mmap() failed!");
+                passed = false;
+                break;
+            }
+            if (0 != numa_bind(buf, (size_t)size, nodes[j].id)) {
+                (void)munmap(buf, (size_t)size);
+                continue;
+            }
+            memset(buf, 1, (size_t)size);
+
+            /* a sample is enough to catch the policy being ignored. */
+            size_t bound = 0;
+            if (numa_pages_on(buf, page_size * NUMA_CHECK_PAGES, nodes[j].id, &bound) &&
+                bound != NUMA_CHECK_PAGES) {
+                systest_printf(RED("memory bound to node %d isn't there") "\n", nodes[j].id);
+                passed = false;
+            }
+
+            size_t words = (size_t)size / sizeof(uint64_t);
+            uint64_t best_ns = 0;
+            for (int pass = 0; pass < 3 && passed; pass++) {
+                uint64_t start = systest_monotonic_ns();
+                uint64_t sum = numa_read((const uint64_t*)(void*)buf, words);
+                uint64_t took = systest_monotonic_ns() - start;
+                if (sum != (uint64_t)words * 0x0101010101010101ULL) {
+                    systest_printf(RED("read back the wrong data from node %d") "\n", nodes[j].id);
+                    passed = false;
+                }
+                if (0 == best_ns || took < best_ns)
+                    best_ns = took;
+            }
+            bandwidth[(i * count) + j] = ((double)size / (1024.0 * 1024.0)) / ((double)best_ns / 1e9);
+
+            uint64_t seed = 0x853c49e6748fea9bULL;
+            void* start = chase_build(buf, (size_t)size, stride, stride, order, &seed);
+            latency[(i * count) + j] = chase_measure(start, duration_ns);
+            (void)munmap(buf, (size_t)size);
+        }
+    }
+
+    if (restore)
+        (void)sched_setaffinity(0, sizeof(cpu_set_t), &saved);
+
+    if (passed) {
+        char size_str[16];
+        size_str_binary(size, size_str, sizeof(size_str));
+        systest_printf("%s per node pair; rows: CPU node, columns: memory node\n", size_str);
+
+        const char* titles[] = {"read MiB/s", "load ns"};
+        const double* tables[] = {bandwidth, latency};
+        for (size_t t = 0; t < __countof(tables); t++) {
+            systest_printf("%-10s", titles[t]);
+            for (size_t j = 0; j < count; j++)
+                systest_printf(" %9d", nodes[j].id);
+            systest_printf("\n");
+            for (size_t i = 0; i < count; i++) {
+                if (0 == nodes[i].cpus)
+                    continue;
+                systest_printf("%10d", nodes[i].id);
+                for (size_t j = 0; j < count; j++) {
+                    double value = tables[t][(i * count) + j];
+                    if (0.0 == value)
+                        systest_printf(" %9s", "-");
+                    else
+                        systest_printf(t ? " %9.1f" : " %9.0f", value);
+                }
+                systest_printf("\n");
+            }
+        }
+    }
+
+    systest_safefree(&bandwidth);
+    systest_safefree(&latency);
+    systest_safefree(&order);
+    systest_freecputopology(&topo);
+    free(nodes);
+    return passed;
+}
+#  endif
+
+#  if defined(__HAVE_SCHED__)
+/* --- core to core: a cache line bounced between two pinned threads, and
+ * two counters pushed apart until they stop sharing a line --- */
+
+#   define CORE_MAX_CPUS 64     /**< Beyond this the matrix is unreadable. */
+#   define CORE_ROUNDS 2000     /**< Round trips per batch. */
+#   define CORE_BATCHES 5       /**< The fastest batch counts. */
+#   define CORE_FALSE_SHARING_MAX 512
+
+static inline void core_relax(void) {
+#   if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#   elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#   endif
+}
+
+static bool core_pin(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return 0 == sched_setaffinity(0, sizeof(cpu_set_t), &set);
+}
+
+typedef struct {
+    _Alignas(128) atomic_int ball; /**< Odd: the ping's serve; even: the pong's return. */
+    _Alignas(128) atomic_int ready;
+    int cpu;
+    int rounds;
+} core_pingpong;
+
+static void* core_pong(void* arg) {
+    core_pingpong* pp = (core_pingpong*)arg;
+    if (!core_pin(pp->cpu)) {
+        atomic_store(&pp->ready, -1);
+        return NULL;
+    }
+    atomic_store(&pp->ready, 1);
+
+    for (int r = 0; r < pp->rounds; r++) {
+        while (atomic_load_explicit(&pp->ball, memory_order_acquire) != (2 * r) + 1)
+            core_relax();
+        atomic_store_explicit(&pp->ball, (2 * r) + 2, memory_order_release);
+    }
+    return NULL;
+}
+
+/** Returns the fastest round trip, in nanoseconds, between the calling
+ * thread on cpu a and a thread on cpu b, or a negative number on error. */
+static double core_roundtrip(int a, int b) {
+    core_pingpong pp;
+    memset(&pp, 0, sizeof(pp));
+    pp.cpu = b;
+    pp.rounds = CORE_ROUNDS * CORE_BATCHES;
+
+    if (!core_pin(a))
+        return -1.0;
+
+    pthread_t thread;
+    int ret = pthread_create(&thread, NULL, &core_pong, &pp);
+    if (0 != ret) {
+        handle_error(ret, "pthread_create() failed!");
+        return -1.0;
+    }
+    while (0 == atomic_load(&pp.ready))
+        core_relax();
+    if (atomic_load(&pp.ready) < 0) {
+        (void)pthread_join(thread, NULL);
+        return -1.0;
+    }
+
+    uint64_t best = 0;
+    for (int batch = 0; batch < CORE_BATCHES; batch++) {
+        uint64_t start = systest_monotonic_ns();
+        for (int n = 0; n < CORE_ROUNDS; n++) {
+            int r = (batch * CORE_ROUNDS) + n;
+            atomic_store_explicit(&pp.ball, (2 * r) + 1, memory_order_release);
+            while (atomic_load_explicit(&pp.ball, memory_order_acquire) != (2 * r) + 2)
+                core_relax();
+        }
+        uint64_t took = systest_monotonic_ns() - start;
+        if (0 == best || took < best)
+            best = took;
+    }
+
+    (void)pthread_join(thread, NULL);
+    return (double)best / CORE_ROUNDS;
+}
+
+/** How two CPUs are related, for summarising the matrix. */
+static const char* core_relation(const systest_cputopo* topo, const systest_cpu* a, const systest_cpu* b) {
+    static char label[24];
+    if (a->package == b->package && a->core == b->core)
+        return "same core";
+    for (size_t c = 0; c < topo->ncaches; c++) {
+        if ('I' != topo->caches[c].type && a->cache_ids[c] >= 0 && a->cache_ids[c] == b->cache_ids[c]) {
+            (void)snprintf(label, sizeof(label), "shared L%u", topo->caches[c].level);
+            return label;
+        }
+    }
+    return a->package == b->package ? "same package" : "other package";
+}
+
+typedef struct {
+    volatile uint64_t* counter;
+    atomic_bool* stop;
+    int cpu;
+    uint64_t count;
+    bool pinned;
+} core_sharer;
+
+static void* core_share(void* arg) {
+    core_sharer* sharer = (core_sharer*)arg;
+    sharer->pinned = core_pin(sharer->cpu);
+    uint64_t count = 0;
+    while (!atomic_load_explicit(sharer->stop, memory_order_relaxed)) {
+        for (int n = 0; n < 64; n++)
+            (*sharer->counter)++;
+        count += 64;
+    }
+    sharer->count = count;
+    return NULL;
+}
+
+/** Nanoseconds per increment with two threads hammering counters distance
+ * bytes apart, or a negative number on error. */
+static double core_false_sharing(char* buf, size_t distance, int a, int b, uint64_t duration_ns) {
+    _Alignas(128) atomic_bool stop = false;
+    memset(buf, 0, CORE_FALSE_SHARING_MAX * 2);
+    core_sharer sharers[2] = {
+        {(volatile uint64_t*)(void*)buf, &stop, a, 0, false},
+        {(volatile uint64_t*)(void*)(buf + distance), &stop, b, 0, false}
+    };
+
+    pthread_t threads[2];
+    size_t started = 0;
+    for (; started < 2; started++) {
+        int ret = pthread_create(&threads[started], NULL, &core_share, &sharers[started]);
+        if (0 != ret) {
+            handle_error(ret, "pthread_create() failed!");
+            break;
+        }
+    }
+    uint64_t start = systest_monotonic_ns();
+    if (2 == started) {
+        struct timespec ts = {(time_t)(duration_ns / 1000000000ULL), (long)(duration_ns % 1000000000ULL)};
+        (void)nanosleep(&ts, NULL);
+    }
+    atomic_store(&stop, true);
+    uint64_t elapsed = systest_monotonic_ns() - start;
+    for (size_t n = 0; n < started; n++)
+        (void)pthread_join(threads[n], NULL);
+
+    if (2 != started || !sharers[0].pinned || !sharers[1].pinned)
+        return -1.0;
+    if (*sharers[0].counter != sharers[0].count || *sharers[1].counter != sharers[1].count)
+        return -1.0; /* they trampled each other: the distance was too small for a uint64_t. */
+    return (double)elapsed / ((double)(sharers[0].count + sharers[1].count) / 2.0);
+}
+
+bool check_core_bench(void) {
+    systest_cputopo topo;
+    if (!systest_getcputopology(&topo))
+        return false;
+
+    /* the first CORE_MAX_CPUS CPUs we're allowed onto. */
+    const systest_cpu* cpus[CORE_MAX_CPUS];
+    size_t ncpus = 0;
+    for (size_t n = 0; n < topo.ncpus && ncpus < CORE_MAX_CPUS; n++) {
+        if (topo.cpus[n].allowed && topo.cpus[n].id < CPU_SETSIZE)
+            cpus[ncpus++] = &topo.cpus[n];
+    }
+    if (ncpus < 2) {
+        systest_printf("only %zu CPU allowed; need two to ping-pong between\n", ncpus);
+        systest_freecputopology(&topo);
+        return true;
+    }
+
+    cpu_set_t saved;
+    bool restore = (0 == sched_getaffinity(0, sizeof(cpu_set_t), &saved));
+    double* matrix = calloc(ncpus * ncpus, sizeof(double));
+    char* buf = aligned_alloc(4096, CORE_FALSE_SHARING_MAX * 2);
+    bool passed = (matrix && buf);
+    if (!passed)
+        handle_error(ENOMEM, "couldn't allocate the benchmark buffers!");
+
+    for (size_t i = 0; passed && i < ncpus; i++) {
+        for (size_t j = i + 1; passed && j < ncpus; j++) {
+            double ns = core_roundtrip(cpus[i]->id, cpus[j]->id);
+            if (ns < 0.0) {
+                handle_error(errno, "couldn't pin the ping-pong threads!");
+                passed = false;
+            }
+            matrix[(i * ncpus) + j] = matrix[(j * ncpus) + i] = ns;
+        }
+    }
+    if (restore)
+        (void)sched_setaffinity(0, sizeof(cpu_set_t), &saved);
+
+    if (passed) {
+        systest_printf("cache line round trip, ns; rows and columns are CPU ids\n");
+        systest_printf("%5s", "");
+        for (size_t j = 0; j < ncpus; j++)
+            systest_printf(" %5d", cpus[j]->id);
+        systest_printf("\n");
+        for (size_t i = 0; i < ncpus; i++) {
+            systest_printf("%5d", cpus[i]->id);
+            for (size_t j = 0; j < ncpus; j++) {
+                if (i == j)
+                    systest_printf(" %5s", "-");
+                else
+                    systest_printf(" %5.0f", matrix[(i * ncpus) + j]);
+            }
+            systest_printf("\n");
+        }
+
+        /* averages for each kind of pair, in the order they first turn up. */
+        const char* labels[SYSTEST_MAX_CACHES + 3];
+        char label_store[SYSTEST_MAX_CACHES + 3][24];
+        double sums[SYSTEST_MAX_CACHES + 3] = {0};
+        size_t counts[SYSTEST_MAX_CACHES + 3] = {0}, nlabels = 0;
+        for (size_t i = 0; i < ncpus; i++) {
+            for (size_t j = i + 1; j < ncpus; j++) {
+                const char* relation = core_relation(&topo, cpus[i], cpus[j]);
+                size_t k = 0;
+                while (k < nlabels && 0 != strcmp(labels[k], relation))
+                    k++;
+                if (k == nlabels) {
+                    if (nlabels == __countof(labels))
+                        continue;
+                    (void)snprintf(label_store[k], sizeof(label_store[k]), "%s", relation);
+                    labels[nlabels++] = label_store[k];
+                }
+                sums[k] += matrix[(i * ncpus) + j];
+                counts[k]++;
+            }
+        }
+        for (size_t k = 0; k < nlabels; k++)
+            systest_printf("%-14s %7.1f ns average over %zu pair(s)\n", labels[k], sums[k] / (double)counts[k],
+                counts[k]);
+    }
+
+    /* false sharing: use the pair furthest apart that still shares a
+     * package, so both caches really have to fight over the line. */
+    int a = cpus[0]->id, b = cpus[1]->id;
+    double furthest = 0.0;
+    for (size_t j = 1; passed && j < ncpus; j++) {
+        if (cpus[j]->package == cpus[0]->package && matrix[j] > furthest &&
+            0 != strcmp("same core", core_relation(&topo, cpus[0], cpus[j]))) {
+            furthest = matrix[j];
+            b = cpus[j]->id;
+        }
+    }
+
+    if (passed) {
+        uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL / 4;
+        double apart_ns = core_false_sharing(buf, CORE_FALSE_SHARING_MAX, a, b, duration_ns);
+        size_t measured = 0;
+        systest_printf("false sharing, CPUs %d and %d:\n%10s %14s\n", a, b, "distance", "ns/increment");
+        for (size_t distance = sizeof(uint64_t); passed && distance <= CORE_FALSE_SHARING_MAX; distance *= 2) {
+            double ns = distance == CORE_FALSE_SHARING_MAX ? apart_ns :
+                core_false_sharing(buf, distance, a, b, duration_ns);
+            if (ns < 0.0) {
+                systest_printf(RED("false sharing run at %zu bytes failed") "\n", distance);
+                passed = false;
+                break;
+            }
+            systest_printf("%10zu %14.2f\n", distance, ns);
+            /* the line ends where the penalty does, for good. */
+            if (ns >= apart_ns * 1.25)
+                measured = 0;
+            else if (0 == measured)
+                measured = distance;
+        }
+
+        size_t line = cache_line_size();
+        if (passed && 0 == line)
+            systest_printf("measured line size %zu B; the C library doesn't report one\n", measured);
+        else if (passed && measured == line)
+            systest_printf("measured line size %zu B matches _SC_LEVEL1_DCACHE_LINESIZE\n", measured);
+        else if (passed && measured == 2 * line)
+            systest_printf(YELLOW("measured line size %zu B is twice _SC_LEVEL1_DCACHE_LINESIZE (%zu B);"
+                " the adjacent-line prefetcher pairs lines, so pad to %zu B") "\n", measured, line, measured);
+        else if (passed)
+            systest_printf(YELLOW("measured line size %zu B, but _SC_LEVEL1_DCACHE_LINESIZE says %zu B") "\n",
+                measured, line);
+    }
+
+    systest_safefree(&matrix);
+    free(buf);
+    systest_freecputopology(&topo);
+    return passed;
+}
+#  endif
+# endif
+
+/* --- lock and atomic contention: every thread hammering one primitive,
+ * at 1, 2, 4... threads --- */
+
+typedef enum {
+    LOCK_MUTEX,
+# if defined(PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP)
+    LOCK_MUTEX_ADAPTIVE,
+# endif
+# if defined(__HAVE_FUTEX__)
+    LOCK_FUTEX,
+# endif
+    LOCK_SPIN,
+    LOCK_RWLOCK_READ,
+    LOCK_RWLOCK_WRITE,
+    LOCK_ADD_SHARED,
+    LOCK_ADD_PADDED,
+    LOCK_CAS_SHARED,
+    LOCK_CAS_PADDED,
+    LOCK_KINDS
+} lock_kind;
+
+static const char* const lock_names[LOCK_KINDS] = {
+    "mutex",
+# if defined(PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP)
+    "mutex (adaptive)",
+# endif
+# if defined(__HAVE_FUTEX__)
+    "futex lock",
+# endif
+    "spinlock", "rwlock (read)", "rwlock (write)", "fetch_add shared", "fetch_add padded",
+    "CAS shared", "CAS padded"
+};
+
+typedef struct {
+    lock_kind kind;
+    pthread_mutex_t mutex;
+    pthread_spinlock_t spin;
+    pthread_rwlock_t rwlock;
+    bench_gate gate;
+    pthread_barrier_t barrier;
+    atomic_int futex;     /**< 0: free, 1: held, 2: held with waiters. */
+    _Alignas(128) uint64_t counter; /**< Protected by whichever lock is on test. */
+    _Alignas(128) atomic_uint_fast64_t atomic_counter;
+    _Alignas(128) atomic_bool stop;
+} lock_shared;
+
+typedef struct {
+    _Alignas(128) atomic_uint_fast64_t padded; /**< This thread's own counter. */
+    uint64_t ops;
+    lock_shared* shared;
+} lock_job;
+
+# if defined(__HAVE_FUTEX__)
+/* Drepper's three-state mutex, from "Futexes Are Tricky". */
+static void lock_futex_acquire(atomic_int* futex) {
+    int state = 0;
+    if (atomic_compare_exchange_strong(futex, &state, 1))
+        return;
+    if (2 != state)
+        state = atomic_exchange(futex, 2);
+    while (0 != state) {
+        (void)syscall(SYS_futex, (void*)futex, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+        state = atomic_exchange(futex, 2);
+    }
+}
+
+static void lock_futex_release(atomic_int* futex) {
+    if (1 != atomic_fetch_sub(futex, 1)) {
+        atomic_store(futex, 0);
+        (void)syscall(SYS_futex, (void*)futex, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+}
+# endif
+
+static void* lock_worker(void* arg) {
+    lock_job* job = (lock_job*)arg;
+    lock_shared* shared = job->shared;
+    uint64_t ops = 0;
+    volatile uint64_t sink = 0;
+
+    if (!bench_gate_wait(&shared->gate))
+        return NULL;
+    (void)pthread_barrier_wait(&shared->barrier);
+    while (!atomic_load_explicit(&shared->stop, memory_order_relaxed)) {
+        switch (shared->kind) {
+            case LOCK_MUTEX:
+# if defined(PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP)
+            case LOCK_MUTEX_ADAPTIVE:
+# endif
+                (void)pthread_mutex_lock(&shared->mutex);
+                shared->counter++;
+                (void)pthread_mutex_unlock(&shared->mutex);
+                break;
+# if defined(__HAVE_FUTEX__)
+            case LOCK_FUTEX:
+                lock_futex_acquire(&shared->futex);
+                shared->counter++;
+                lock_futex_release(&shared->futex);
+                break;
+# endif
+            case LOCK_SPIN:
+                (void)pthread_spin_lock(&shared->spin);
+                shared->counter++;
+                (void)pthread_spin_unlock(&shared->spin);
+                break;
+            case LOCK_RWLOCK_READ:
+                (void)pthread_rwlock_rdlock(&shared->rwlock);
+                sink = shared->counter;
+                (void)pthread_rwlock_unlock(&shared->rwlock);
+                break;
+            case LOCK_RWLOCK_WRITE:
+                (void)pthread_rwlock_wrlock(&shared->rwlock);
+                shared->counter++;
+                (void)pthread_rwlock_unlock(&shared->rwlock);
+                break;
+            case LOCK_ADD_SHARED:
+                (void)atomic_fetch_add(&shared->atomic_counter, 1);
+                break;
+            case LOCK_ADD_PADDED:
+                (void)atomic_fetch_add(&job->padded, 1);
+                break;
+            case LOCK_CAS_SHARED:
+            case LOCK_CAS_PADDED: {
+                atomic_uint_fast64_t* target = (LOCK_CAS_SHARED == shared->kind) ?
+                    &shared->atomic_counter : &job->padded;
+                uint_fast64_t old = atomic_load_explicit(target, memory_order_relaxed);
+                while (!atomic_compare_exchange_weak(target, &old, old + 1))
+                    ;
+                break;
+            }
+            case LOCK_KINDS:
+                break;
+        }
+        ops++;
+    }
+    (void)sink;
+
+    job->ops = ops;
+    return NULL;
+}
+
+/** Runs kind on nthreads threads for duration_ns. Checks that no increment
+ * got lost, and reports throughput and how evenly it was spread. */
+static bool lock_run(lock_kind kind, size_t nthreads, uint64_t duration_ns, double* mops, double* fairness,
+    double* spread) {
+    lock_shared* shared = aligned_alloc(128, sizeof(lock_shared));
+    lock_job* jobs = aligned_alloc(128, nthreads * sizeof(lock_job));
+    pthread_t* threads = calloc(nthreads, sizeof(pthread_t));
+    bool passed = false;
+    if (!shared || !jobs || !threads) {
+        handle_error(ENOMEM, "couldn't allocate the lock benchmark!");
+        goto cleanup;
+    }
+
+    memset(shared, 0, sizeof(lock_shared));
+    memset(jobs, 0, nthreads * sizeof(lock_job));
+    shared->kind = kind;
+    shared->gate = (bench_gate){PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, false, false};
+
+    pthread_mutexattr_t attr;
+    (void)pthread_mutexattr_init(&attr);
+# if defined(PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP)
+    (void)pthread_mutexattr_settype(&attr, LOCK_MUTEX_ADAPTIVE == kind ?
+        PTHREAD_MUTEX_ADAPTIVE_NP : PTHREAD_MUTEX_NORMAL);
+# else
+    (void)pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_NORMAL);
+# endif
+    int ret = pthread_mutex_init(&shared->mutex, &attr);
+    (void)pthread_mutexattr_destroy(&attr);
+    if (0 == ret)
+        ret = pthread_spin_init(&shared->spin, PTHREAD_PROCESS_PRIVATE);
+    if (0 == ret)
+        ret = pthread_rwlock_init(&shared->rwlock, NULL);
+    if (0 != ret) {
+        handle_error(ret, "couldn't initialize the locks!");
+        goto cleanup;
+    }
+
+    size_t started = 0;
+    for (; started < nthreads; started++) {
+        jobs[started].shared = shared;
+        ret = pthread_create(&threads[started], NULL, &lock_worker, &jobs[started]);
+        if (0 != ret) {
+            handle_error(ret, "pthread_create() failed!");
+            break;
+        }
+    }
+    if (0 == ret && 0 != (ret = pthread_barrier_init(&shared->barrier, NULL, (unsigned)nthreads + 1)))
+        handle_error(ret, "pthread_barrier_init() failed!");
+
+    bench_gate_open(&shared->gate, 0 != ret);
+    if (0 != ret) {
+        for (size_t n = 0; n < started; n++)
+            (void)pthread_join(threads[n], NULL);
+        goto destroy;
+    }
+
+    (void)pthread_barrier_wait(&shared->barrier);
+    uint64_t start = systest_monotonic_ns();
+    struct timespec ts = {(time_t)(duration_ns / 1000000000ULL), (long)(duration_ns % 1000000000ULL)};
+    (void)nanosleep(&ts, NULL);
+    atomic_store(&shared->stop, true);
+    for (size_t n = 0; n < nthreads; n++)
+        (void)pthread_join(threads[n], NULL);
+    uint64_t elapsed = systest_monotonic_ns() - start;
+
+    uint64_t total = 0, least = UINT64_MAX, most = 0;
+    double squares = 0.0;
+    passed = true;
+    for (size_t n = 0; n < nthreads; n++) {
+        uint64_t ops = jobs[n].ops;
+        total += ops;
+        squares += (double)ops * (double)ops;
+        least = ops < least ? ops : least;
+        most = ops > most ? ops : most;
+        if ((LOCK_ADD_PADDED == kind || LOCK_CAS_PADDED == kind) && atomic_load(&jobs[n].padded) != ops)
+            passed = false;
+    }
+    if (LOCK_ADD_SHARED == kind || LOCK_CAS_SHARED == kind)
+        passed &= (atomic_load(&shared->atomic_counter) == total);
+    else if (LOCK_RWLOCK_READ != kind && LOCK_ADD_PADDED != kind && LOCK_CAS_PADDED != kind)
+        passed &= (shared->counter == total);
+    if (!passed)
+        systest_printf(RED("%s lost updates with %zu thread(s)") "\n", lock_names[kind], nthreads);
+
+    /* Jain's index: 1 when every thread got the same share, 1/n when one got it all. */
+    *mops = (double)total / ((double)elapsed / 1e3);
+    *fairness = squares > 0.0 ? ((double)total * (double)total) / ((double)nthreads * squares) : 0.0;
+    *spread = most ? (double)least / (double)most : 0.0;
+
+    (void)pthread_barrier_destroy(&shared->barrier);
+
+destroy:
+    (void)pthread_rwlock_destroy(&shared->rwlock);
+    (void)pthread_spin_destroy(&shared->spin);
+    (void)pthread_mutex_destroy(&shared->mutex);
+
+cleanup:
+    free(shared);
+    free(jobs);
+    systest_safefree(&threads);
+    return passed;
+}
+
+bool check_lock_bench(void) {
+    int cpus = 1;
+    (void)systest_getcpucount(&cpus);
+    size_t max_threads = cpus > 0 ? (size_t)cpus : 1;
+    uint64_t duration_ns = (uint64_t)opts.bench_ms * 1000000ULL / 4;
+    bool passed = true;
+
+    systest_printf("%-18s %7s %10s %9s %8s\n", "primitive", "threads", "Mops/s", "fairness", "min/max");
+    for (size_t nthreads = 1; passed; ) {
+        for (int kind = 0; kind < LOCK_KINDS && passed; kind++) {
+            double mops = 0.0, fairness = 0.0, spread = 0.0;
+            if (!lock_run((lock_kind)kind, nthreads, duration_ns, &mops, &fairness, &spread)) {
+                passed = false;
+                break;
+            }
+            systest_printf("%-18s %7zu %10.2f %9.3f %8.2f\n", lock_names[kind], nthreads, mops, fairness, spread);
+        }
+
+        if (nthreads == max_threads)
+            break;
+        nthreads = nthreads * 2 > max_threads ? max_threads : nthreads * 2;
+    }
+
+    return passed;
+}
+#endif
+
+bool check_build_env(void) {
+#if !defined(__WIN__)
+# if defined(__STDC_LIB_EXT1__)
+   systest_printf("__STDC_LIB_EXT1__ is defined\n");
+# else
+   systest_printf("__STDC_LIB_EXT1__ NOT defined\n");
+# endif
+# if defined(__GLIBC__)
+    systest_printf("Using GNU libc version: %d.%d\n", __GLIBC__, __GLIBC_MINOR__);
+# else
+    systest_printf("Not using GNU libc\n");
+# endif
+#else // __WIN__
+# if defined(__STDC_SECURE_LIB__)
+   systest_printf("__STDC_SECURE_LIB__ is defined\n");
+# else
+   systest_printf("__STDC_SECURE_LIB__ NOT defined\n");
+# endif
+#endif
+#if defined(__clang__)
+    systest_printf("Using Clang %s\n", __clang_version__);
+#elif defined(__GNUC__)
+    systest_printf("Using GCC %d.%d\n", __GNUC__, __GNUC_MINOR__);
+#elif defined(_MSC_VER)
+    systest_printf("Using MSVC %lld\n", (long long)_MSC_FULL_VER);
+#else
+    systest_printf("Using unknown toolset\n");
+#endif
+    return true;
+}
+
+bool check_safefree(void) {
+    int *ptr = malloc(sizeof(int));
+    if (!ptr) {
+        handle_error(errno, "malloc() failed!");
+        return false;
+    }
+
+    *ptr = 1234;
+    systest_safefree(&ptr);
+
+    if (!ptr) {
+        systest_printf("safe_free() does reset the pointer\n");
+        return true;
+    }
+
+    systest_printf(RED("safe_free() does NOT reset the pointer!\n"));
+    return false;
+}
+
+//
+// probe registry
+//
+
+static const systest_probe probes[] = {
+    /* environment */
+    {"build-env", "env", "build environment", &check_build_env, SYSTEST_COST_CHEAP, SYSTEST_PROBE_INFO},
+    /* curiosity */
+    {"safefree", "curiosity", "safefree", &check_safefree, SYSTEST_COST_CHEAP, SYSTEST_PROBE_INFO},
+    /* feature */
+    {"sysconf", "feature", "sysconf()", &check_sysconf, SYSTEST_COST_CHEAP, SYSTEST_PROBE_NONE},
+    {"system", "feature", "system()", &check_system, SYSTEST_COST_MODERATE, SYSTEST_PROBE_NONE},
+#if !defined(__WIN__)
+    {"spawn-bench", "feature", "process spawn latency benchmark", &check_spawn_bench, SYSTEST_COST_EXPENSIVE,
+        SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+#endif
+    {"z-printf", "feature", "z prefix in *printf", &check_z_printf, SYSTEST_COST_CHEAP, SYSTEST_PROBE_NONE},
+    /* portability */
+    {"filesystem", "filesystem", "filesystem api", &check_filesystem_api, SYSTEST_COST_MODERATE, SYSTEST_PROBE_NONE},
+#if defined(__linux__) && defined(__HAVE_PTHREADS__)
+    {"mounts", "filesystem", "mount capacity and health", &check_mounts, SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_NONE},
+#endif
+    {"hostname", "network", "get hostname", &check_get_hostname, SYSTEST_COST_CHEAP, SYSTEST_PROBE_NONE},
+    {"uname", "platform", "get uname", &check_get_uname, SYSTEST_COST_CHEAP, SYSTEST_PROBE_NONE},
+    {"inet", "network", "test internet connection", &check_inet_conn, SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_NONE},
+    {"cgroup", "platform", "cgroup cpu/memory limits", &check_cgroup_limits, SYSTEST_COST_CHEAP, SYSTEST_PROBE_NONE},
+    {"cpu-features", "platform", "cpu instruction set extensions", &check_cpu_features, SYSTEST_COST_CHEAP,
+        SYSTEST_PROBE_INFO},
+#if defined(__HAVE_SIMD_BENCH__)
+    {"simd-bench", "platform", "simd kernel dispatch benchmark", &check_simd_bench, SYSTEST_COST_EXPENSIVE,
+        SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+#endif
+#if defined(__HAVE_PTHREADS__) && !defined(__WIN__) && !defined(__MACOS__)
+    {"mem-bench", "memory", "memory bandwidth and latency benchmark", &check_memory_bench,
+        SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+#endif
+#if defined(__HAVE_PTHREADS__) && !defined(__WIN__) && defined(__linux__)
+    {"hugepages", "memory", "huge page settings and allocations", &check_hugepages,
+        SYSTEST_COST_CHEAP, SYSTEST_PROBE_NONE},
+    {"hugepage-bench", "memory", "TLB-miss cost with and without huge pages", &check_hugepage_bench,
+        SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+#endif
+#if defined(__HAVE_PTHREADS__) && !defined(__WIN__) && defined(__linux__) && \
+    defined(__HAVE_MEMPOLICY__) && defined(__HAVE_SCHED__)
+    {"numa", "memory", "NUMA nodes, first-touch and mbind()", &check_numa, SYSTEST_COST_CHEAP,
+        SYSTEST_PROBE_SERIAL},
+    {"numa-bench", "memory", "cross-node memory bandwidth and latency", &check_numa_bench,
+        SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+#endif
+#if defined(__HAVE_PTHREADS__) && !defined(__WIN__) && !defined(__MACOS__)
+    {"lock-bench", "platform", "lock and atomic contention scaling", &check_lock_bench,
+        SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+#endif
+#if defined(__HAVE_PTHREADS__) && !defined(__WIN__) && defined(__linux__) && defined(__HAVE_SCHED__)
+    {"core-bench", "platform", "core-to-core latency and false sharing", &check_core_bench,
+        SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+#endif
+#if !defined(__WIN__)
+    {"clocks", "platform", "clock ids, vDSO and TSC", &check_clocks, SYSTEST_COST_MODERATE,
+        SYSTEST_PROBE_SERIAL},
+#endif
+#if defined(__linux__) && defined(__HAVE_SCHED__)
+    {"timer-bench", "platform", "timer and sleep jitter", &check_timer_bench, SYSTEST_COST_EXPENSIVE,
+        SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+#endif
+    {"cpu-count", "platform", "get logical core count", &check_cpu_count, SYSTEST_COST_CHEAP, SYSTEST_PROBE_NONE},
+#if defined(__HAVE_PTHREADS__)
+    {"dns", "network", "resolver latency", &check_dns_resolver, SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_SERIAL},
+#endif
+#if defined(__HAVE_PTHREADS__) && !defined(__WIN__)
+    {"net-loopback", "network", "loopback tcp/udp benchmark", &check_loopback_bench, SYSTEST_COST_EXPENSIVE,
+        SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+#endif
+#if defined(__HAVE_IO_URING__)
+    {"io-uring", "feature", "io_uring availability", &check_uring, SYSTEST_COST_CHEAP, SYSTEST_PROBE_NONE},
+    {"io-uring-bench", "feature", "io_uring queue depth benchmark", &check_uring_bench, SYSTEST_COST_EXPENSIVE,
+        SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+#endif
+#if defined(__linux__) && defined(__HAVE_PTHREADS__)
+    {"disk-bench", "filesystem", "storage throughput/IOPS benchmark", &check_storage_bench,
+        SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+    {"net-zerocopy", "network", "zero-copy send paths", &check_zerocopy_bench, SYSTEST_COST_EXPENSIVE,
+        SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+    {"walk-bench", "filesystem", "directory tree walk benchmark", &check_walk_bench,
+        SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+    {"meta-bench", "filesystem", "metadata operation benchmark", &check_meta_bench,
+        SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+    {"scan-bench", "filesystem", "mmap vs. read() file scan benchmark", &check_scan_bench,
+        SYSTEST_COST_EXPENSIVE, SYSTEST_PROBE_SERIAL | SYSTEST_PROBE_BENCH},
+#endif
+};
+
+static const char* const cost_names[] = {"cheap", "moderate", "expensive"};
+
+/** Returns true if the comma-separated list contains the given word. */
+static bool list_contains(const char* restrict list, const char* restrict word) {
+    if (!_validstr(list) || !_validstr(word))
+        return false;
+
+    size_t word_len = strlen(word);
+    const char* cur = list;
+    while (*cur) {
+        const char* comma = strchr(cur, ',');
+        size_t len = comma ? (size_t)(comma - cur) : strlen(cur);
+        if (len == word_len && 0 == strncmp(cur, word, len))
+            return true;
+        if (!comma)
+            break;
+        cur = comma + 1;
+    }
+
+    return false;
+}
+
+static bool probe_selected(const systest_probe* probe) {
+    if (probe->cost > opts.max_cost)
+        return false;
+
+    if (opts.only && !list_contains(opts.only, probe->name) &&
+        !list_contains(opts.only, probe->category))
+        return false;
+
+    /* benchmarks take a while and load the machine; they have to be asked for. */
+    if (systest_bittest(probe->flags, SYSTEST_PROBE_BENCH) && !opts.bench &&
+        !list_contains(opts.only, probe->name))
+        return false;
+
+    if (list_contains(opts.skip, probe->name) || list_contains(opts.skip, probe->category))
+        return false;
+
+    return true;
+}
+
+static void print_usage(const char* argv0) {
+    printf("usage: %s [options]\n"
+           "  --only <list>      run only the probes/categories in the comma-separated list\n"
+           "  --skip <list>      don't run the probes/categories in the comma-separated list\n"
+           "  --max-cost <cost>  don't run probes costlier than cheap|moderate|expensive\n"
+           "  --bench            also run benchmark probes\n"
+           "  --bench-time <ms>  duration of each benchmark measurement (default: 250)\n"
+           "  --bench-file-size <MiB> size of benchmark scratch files (default: 64)\n"
+           "  -j, --jobs <n>     run independent probes on n threads (default: CPU count;\n"
+           "                     1 runs everything serially with live output)\n"
+           "  --inet-host <host> host to connect to for the inet probe (default: " INET_TEST_HOST ")\n"
+           "  --inet-port <port> port or service for the inet probe (default: " INET_TEST_PORT ")\n"
+           "  --inet-timeout <ms> overall deadline for the inet probe (default: %d)\n"
+           "  --dns-names <list> comma-separated names for the dns probe (default: " INET_TEST_HOST ",localhost)\n"
+           "  --dns-lookups <n>  total lookups made by the dns probe (default: 64)\n"
+           "  --dns-server <addr[:port]> query this server directly rather than using getaddrinfo()\n"
+           "  --walk-root <path> directory tree for the walk benchmark (default: a generated one)\n"
+           "  --mount-timeout <ms> how long each mount gets to answer statvfs() (default: %d)\n"
+           "  --mem-max-size <MiB> largest working set for the memory benchmarks (default: 512)\n"
+           "  --list             list the available probes and exit\n"
+           "  --help             show this message and exit\n", argv0, SYSTEST_INET_TIMEOUT_MS,
+           SYSTEST_MOUNT_TIMEOUT_MS);
+}
+
+static bool parse_cost(const char* str, systest_cost* cost) {
+    for (size_t n = 0; n < __countof(cost_names); n++) {
+        if (0 == strcmp(str, cost_names[n])) {
+            *cost = (systest_cost)n;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_long(const char* str, long min, long max, long* value) {
+    char* end = NULL;
+    errno = 0;
+    long parsed = strtol(str, &end, 10);
+    if (0 != errno || end == str || '\0' != *end || parsed < min || parsed > max)
+        return false;
+
+    *value = parsed;
+    return true;
+}
+
+/** Parses argv into opts. Accepts both '--opt value' and '--opt=value'. */
+static bool parse_args(int argc, char** argv) {
+    for (int n = 1; n < argc; n++) {
+        const char* arg = argv[n];
+        const char* val = NULL;
+        size_t arg_len  = strlen(arg);
+        const char* eq  = strchr(arg, '=');
+        if (eq) {
+            arg_len = (size_t)(eq - arg);
+            val     = eq + 1;
+        }
+
+#define _argis(name) (arg_len == strlen(name) && 0 == strncmp(arg, name, arg_len))
+#define _argval() \
+    if (!val) { \
+        if (n + 1 >= argc) { \
+            fprintf(stderr, RED("%s requires a value") "\n", arg); \
+            return false; \
+        } \
+        val = argv[++n]; \
+    }
+
+        if (_argis("--only")) {
+            _argval();
+            opts.only = val;
+        } else if (_argis("--skip")) {
+            _argval();
+            opts.skip = val;
+        } else if (_argis("--max-cost")) {
+            _argval();
+            if (!parse_cost(val, &opts.max_cost)) {
+                fprintf(stderr, RED("invalid cost: '%s'") "\n", val);
+                return false;
+            }
+        } else if (_argis("--jobs") || _argis("-j")) {
+            _argval();
+            if (!parse_long(val, 0L, 1024L, &opts.jobs)) {
+                fprintf(stderr, RED("invalid job count: '%s'") "\n", val);
+                return false;
+            }
+        } else if (_argis("--inet-host")) {
+            _argval();
+            opts.inet_host = val;
+        } else if (_argis("--inet-port")) {
+            _argval();
+            opts.inet_port = val;
+        } else if (_argis("--inet-timeout")) {
+            _argval();
+            if (!parse_long(val, 1L, INT_MAX, &opts.inet_timeout)) {
+                fprintf(stderr, RED("invalid timeout: '%s'") "\n", val);
+                return false;
+            }
+        } else if (_argis("--dns-names")) {
+            _argval();
+            opts.dns_names = val;
+        } else if (_argis("--dns-server")) {
+            _argval();
+            opts.dns_server = val;
+        } else if (_argis("--dns-lookups")) {
+            _argval();
+            if (!parse_long(val, 1L, 1000000L, &opts.dns_lookups)) {
+                fprintf(stderr, RED("invalid lookup count: '%s'") "\n", val);
+                return false;
+            }
+        } else if (_argis("--mount-timeout")) {
+            _argval();
+            if (!parse_long(val, 1L, 600000L, &opts.mount_timeout)) {
+                fprintf(stderr, RED("invalid timeout: '%s'") "\n", val);
+                return false;
+            }
+        } else if (_argis("--mem-max-size")) {
+            _argval();
+            if (!parse_long(val, 1L, 1024L * 1024L, &opts.mem_max_mb)) {
+                fprintf(stderr, RED("invalid size: '%s'") "\n", val);
+                return false;
+            }
+        } else if (_argis("--walk-root")) {
+            _argval();
+            opts.walk_root = val;
+        } else if (_argis("--bench")) {
+            opts.bench = true;
+        } else if (_argis("--bench-time")) {
+            _argval();
+            if (!parse_long(val, 1L, 3600000L, &opts.bench_ms)) {
+                fprintf(stderr, RED("invalid benchmark time: '%s'") "\n", val);
+                return false;
+            }
+        } else if (_argis("--bench-file-size")) {
+            _argval();
+            if (!parse_long(val, BENCH_FILE_MIN_MB, 1024L * 1024L, &opts.bench_file_mb)) {
+                fprintf(stderr, RED("invalid file size: '%s' (at least %ld MiB)") "\n", val, BENCH_FILE_MIN_MB);
+                return false;
+            }
+        } else if (_argis("--list")) {
+            opts.list = true;
+        } else if (_argis("--help") || _argis("-h")) {
+            print_usage(argv[0]);
+            exit(EXIT_SUCCESS);
+        } else {
+            fprintf(stderr, RED("unknown option: '%s'") "\n", arg);
+            return false;
+        }
+
+#undef _argval
+#undef _argis
+    }
+
+    return true;
+}
+
+static void list_probes(void) {
+    printf("%-16s %-12s %-10s %s\n", "name", "category", "cost", "description");
+    for (size_t n = 0; n < __countof(probes); n++) {
+        printf("%-16s %-12s %-10s %s%s\n", probes[n].name, probes[n].category,
+            cost_names[probes[n].cost], probes[n].desc,
+            systest_bittest(probes[n].flags, SYSTEST_PROBE_BENCH) ? " (benchmark)" : "");
+    }
+}
+
+//
+// parallel executor
+//
+
+static void run_probe(size_t n, systest_probe_result* result) {
+    uint64_t start = systest_monotonic_ns();
+    result->passed = probes[n].fn();
+    result->duration_ns = systest_monotonic_ns() - start;
+    result->ran = true;
+}
+
+/** Number of workers to use when --jobs isn't given: the CPUs this process
+ * may actually run on, or its cgroup CPU quota if that's lower. Most probes spend their time waiting on I/O, so there
+ * are always at least two workers; one blocked probe shouldn't hold up the
+ * rest. */
+static size_t executor_default_jobs(void) {
+    int cpus = 0;
+    if (!systest_getcpucount(&cpus) || cpus < 1)
+        cpus = 1;
+
+    /* in a container, the CPU quota is usually the tighter limit. */
+    systest_cgroup_limits limits;
+    if (systest_getcgrouplimits(&limits) && limits.effective_cpus < (double)cpus) {
+        cpus = (int)limits.effective_cpus;
+        cpus += ((double)cpus < limits.effective_cpus);
+    }
+
+    return cpus < 2 ? 2 : (size_t)cpus;
+}
+
+#if defined(__HAVE_PTHREADS__)
+/** State shared by the executor's worker threads. */
+typedef struct {
+    const size_t* queue;   /**< Indexes into probes[]. */
+    size_t count;
+    atomic_size_t next;    /**< Next entry in queue to be claimed. */
+    systest_probe_result* results;
+} executor_work;
+
+static void* executor_worker(void* arg) {
+    executor_work* work = (executor_work*)arg;
+
+    for (size_t n = atomic_fetch_add(&work->next, 1); n < work->count;
+        n = atomic_fetch_add(&work->next, 1)) {
+        size_t idx = work->queue[n];
+        systest_probe_result* result = &work->results[idx];
+
+        FILE* capture = open_memstream(&result->output, &result->output_len);
+        if (!capture)
+            handle_error(errno, "open_memstream() failed!");
+
+        systest_setcapture(capture);
+        run_probe(idx, result);
+        systest_setcapture(NULL);
+
+        if (capture)
+            (void)fclose(capture);
+    }
+
+    return NULL;
+}
+#endif
+
+/** Runs the queued probes on a pool of worker threads, capturing the output
+ * of each in its result. Anything that couldn't be run (e.g. no threads) is
+ * left for the caller to run serially. */
+static void run_parallel(const size_t* queue, size_t count, systest_probe_result* results,
+    size_t jobs) {
+#if defined(__HAVE_PTHREADS__)
+    if (count < 2 || jobs < 2)
+        return;
+
+    if (jobs > count)
+        jobs = count;
+
+    pthread_t* threads = calloc(jobs, sizeof(pthread_t));
+    if (!threads) {
+        handle_error(errno, "calloc() failed!");
+        return;
+    }
+
+    executor_work work = {queue, count, 0, results};
+
+    size_t started = 0;
+    for (; started < jobs; started++) {
+        int ret = pthread_create(&threads[started], NULL, &executor_worker, &work);
+        if (0 != ret) {
+            handle_error(ret, "pthread_create() failed!");
+            break;
+        }
+    }
+
+    /* whatever is left over if no threads could be created. */
+    if (0 == started)
+        (void)executor_worker(&work);
+
+    for (size_t n = 0; n < started; n++) {
+        int ret = pthread_join(threads[n], NULL);
+        if (0 != ret)
+            handle_error(ret, "pthread_join() failed!");
+    }
+
+    systest_safefree(&threads);
+#else
+    (void)queue;
+    (void)count;
+    (void)results;
+    (void)jobs;
+#endif
+}
+
+int main(int argc, char** argv) {
+
+    if (!parse_args(argc, argv)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (opts.list) {
+        list_probes();
+        return EXIT_SUCCESS;
+    }
+
+    printf("\t" BLUEB("~~~~~~~~~~ <systest> ~~~~~~~~~~") "\n");
+
+    systest_probe_result results[__countof(probes)] = {0};
+    uint64_t run_start = systest_monotonic_ns();
+
+    /* independent probes run concurrently first; serial ones run afterward,
+     * on a quiet machine. results are printed in table order either way. */
+    size_t queue[__countof(probes)] = {0};
+    size_t queued = 0;
+
+    for (size_t n = 0; n < __countof(probes) && 1 != opts.jobs; n++) {
+        if (probe_selected(&probes[n]) && !systest_bittest(probes[n].flags, SYSTEST_PROBE_SERIAL))
+            queue[queued++] = n;
+    }
+
+    if (queued > 1)
+        run_parallel(queue, queued, results, opts.jobs > 0 ? (size_t)opts.jobs : executor_default_jobs());
+
+    for (size_t n = 0; n < __countof(probes); n++) {
+        if (!probe_selected(&probes[n]))
+            continue;
+
+        if (!results[n].ran) {
+            run_probe(n, &results[n]);
+        } else if (results[n].output) {
+            (void)fwrite(results[n].output, 1, results[n].output_len, stdout);
+            systest_safefree(&results[n].output);
+        }
+
+        if (!systest_bittest(probes[n].flags, SYSTEST_PROBE_INFO))
+            handle_result(results[n].passed, probes[n].desc, results[n].duration_ns);
+    }
+
+    uint64_t run_ns = systest_monotonic_ns() - run_start;
+
+    if (0 == num_attempted)
+        printf("\t" YELLOWB("--- no tests were selected ---\n"));
+    else if (num_succeeded != num_attempted)
+        printf("\t" REDB("--- %d/%d tests passed ---\n"), num_succeeded, num_attempted);
+    else
+        printf("\t" LGREENB("--- all %d tests passed! ---\n"), num_attempted);
+
+    /* the slowest probe is usually the one worth looking at. */
+    size_t slowest = __countof(probes);
+    for (size_t n = 0; n < __countof(probes); n++) {
+        if (results[n].ran && (slowest == __countof(probes) ||
+            results[n].duration_ns > results[slowest].duration_ns))
+            slowest = n;
+    }
+
+    if (slowest != __countof(probes)) {
+        printf("\t" DGRAY("total: %.3f ms; slowest: %s (%.3f ms)") "\n", (double)run_ns / 1e6,
+            probes[slowest].name, (double)results[slowest].duration_ns / 1e6);
+    }
+
+    printf("\t" BLUEB("~~~~~~~~~~ </systest> ~~~~~~~~~~") "\n");
+
+    return num_succeeded > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+//
+// portability test implementations
+//
+
+//
+// path cache
+//
+
+/** The app file name and app dir, resolved once and then reused, along with
+ * a descriptor for the app dir that relative paths are looked up from. Each
+ * is resolved on its own, so one that can't be doesn't take the others with
+ * it. The cwd isn't cached: it changes under chdir(), and REL_TO_CWD lookups
+ * go by the live one. systest_pathcache_invalidate() drops them. */
+static struct {
+    char* appfilename;
+    char* appdir;
+    int appdir_fd;
+} _pathcache = {NULL, NULL, -1};
+
+typedef enum {
+    PATHCACHE_APPFILENAME,
+    PATHCACHE_APPDIR,
+    PATHCACHE_APPDIR_FD /**< Not on Windows. */
+} pathcache_field;
+
+#if defined(__HAVE_PTHREADS__)
+static pthread_rwlock_t _pathcache_lock = PTHREAD_RWLOCK_INITIALIZER;
+# define _pathcache_rdlock()   (void)pthread_rwlock_rdlock(&_pathcache_lock)
+# define _pathcache_rdunlock() (void)pthread_rwlock_unlock(&_pathcache_lock)
+# define _pathcache_wrlock()   (void)pthread_rwlock_wrlock(&_pathcache_lock)
+# define _pathcache_wrunlock() (void)pthread_rwlock_unlock(&_pathcache_lock)
+#elif defined(__WIN__)
+static SRWLOCK _pathcache_lock = SRWLOCK_INIT;
+# define _pathcache_rdlock()   AcquireSRWLockShared(&_pathcache_lock)
+# define _pathcache_rdunlock() ReleaseSRWLockShared(&_pathcache_lock)
+# define _pathcache_wrlock()   AcquireSRWLockExclusive(&_pathcache_lock)
+# define _pathcache_wrunlock() ReleaseSRWLockExclusive(&_pathcache_lock)
+#else
+# define _pathcache_rdlock()
+# define _pathcache_rdunlock()
+# define _pathcache_wrlock()
+# define _pathcache_wrunlock()
+#endif
+
+static char* _systest_resolveappfilename(void);
+
+/** Drops whatever is cached; the write lock must be held. */
+static void _pathcache_clear(void) {
+    systest_safefree(&_pathcache.appfilename);
+    systest_safefree(&_pathcache.appdir);
+#if !defined(__WIN__)
+    systest_safeclose(&_pathcache.appdir_fd);
+#endif
+}
+
+/** Returns the cached string for field, or NULL if it isn't (yet). */
+static char* _pathcache_str(pathcache_field field) {
+    switch (field) {
+        case PATHCACHE_APPFILENAME:
+            return _pathcache.appfilename;
+        case PATHCACHE_APPDIR:
+            return _pathcache.appdir;
+        case PATHCACHE_APPDIR_FD:
+            break;
+    }
+    return NULL;
+}
+
+static bool _pathcache_have(pathcache_field field) {
+    if (PATHCACHE_APPDIR_FD == field)
+        return -1 != _pathcache.appdir_fd;
+    return NULL != _pathcache_str(field);
+}
+
+/** Resolves field, and whatever it's derived from if that's missing too; the
+ * write lock must be held. */
+static bool _pathcache_fill(pathcache_field field) {
+    switch (field) {
+        case PATHCACHE_APPFILENAME:
+            _pathcache.appfilename = _systest_resolveappfilename();
+            break;
+
+        case PATHCACHE_APPDIR: {
+            if (!_pathcache_have(PATHCACHE_APPFILENAME) && !_pathcache_fill(PATHCACHE_APPFILENAME))
+                return false;
+            /* dirname() may modify its argument. */
+            char* tmp = strdup(_pathcache.appfilename);
+            if (tmp)
+                _pathcache.appdir = strdup(systest_getdirname(tmp));
+            if (!_pathcache.appdir)
+                handle_error(errno, "strdup() failed!");
+            systest_safefree(&tmp);
+            break;
+        }
+
+        case PATHCACHE_APPDIR_FD: {
+#if !defined(__WIN__)
+            if (!_pathcache_have(PATHCACHE_APPDIR) && !_pathcache_fill(PATHCACHE_APPDIR))
+                return false;
+# if defined(__MACOS__)
+            int open_flags = O_SEARCH;
+# elif defined(__linux__)
+            int open_flags = O_PATH | O_DIRECTORY;
+# elif defined(__BSD__)
+            int open_flags = O_EXEC | O_DIRECTORY;
+# else
+            /* e.g. Haiku; a plain descriptor works with the *at() calls too. */
+            int open_flags = O_RDONLY;
+# endif
+            _pathcache.appdir_fd = open(_pathcache.appdir, open_flags | O_CLOEXEC);
+            if (-1 == _pathcache.appdir_fd)
+                handle_error(errno, "open() failed!");
+#endif
+            break;
+        }
+    }
+
+    return _pathcache_have(field);
+}
+
+/** On success, returns with field filled in and the read lock held. */
+static bool _pathcache_acquire(pathcache_field field) {
+    _pathcache_rdlock();
+    while (!_pathcache_have(field)) {
+        _pathcache_rdunlock();
+        _pathcache_wrlock();
+        bool filled = _pathcache_have(field) || _pathcache_fill(field);
+        _pathcache_wrunlock();
+        if (!filled)
+            return false;
+        _pathcache_rdlock();
+    }
+    return true;
+}
+
+/** Returns a copy of a cached string, which the caller must free. */
+static char* _pathcache_dup(pathcache_field field) {
+    if (!_pathcache_acquire(field))
+        return NULL;
+
+    char* copy = strdup(_pathcache_str(field));
+    if (!copy)
+        handle_error(errno, "strdup() failed!");
+
+    _pathcache_rdunlock();
+    return copy;
+}
+
+void systest_pathcache_invalidate(void) {
+    _pathcache_wrlock();
+    _pathcache_clear();
+    _pathcache_wrunlock();
+}
+
+bool systest_pathgetstat(const char* restrict path, struct stat* restrict st, systest_rel_to rel_to) {
+    if (!_validstr(path) || !_validptr(st))
+        return false;
+
+    memset(st, 0, sizeof(struct stat));
+
+    int stat_ret  = -1;
+    bool relative = false;
+    if (!systest_ispathrelative(path, &relative))
+        return false;
+
+    if (relative) {
+        if (SYSTEST_PATH_REL_TO_APP != rel_to && SYSTEST_PATH_REL_TO_CWD != rel_to) {
+            self_log("invalid enum!");
+            return false;
+        }
+
+#if !defined(__WIN__)
+        /* AT_FDCWD is the kernel's own handle on the cwd; the app dir is held
+         * open by the path cache. either way, this is one system call. */
+        int base_fd = AT_FDCWD;
+        bool locked = false;
+        if (SYSTEST_PATH_REL_TO_APP == rel_to) {
+            if (!_pathcache_acquire(PATHCACHE_APPDIR_FD)) {
+                handle_error(errno, "couldn't get base path!");
+                return false;
+            }
+            locked  = true;
+            base_fd = _pathcache.appdir_fd;
+        }
+
+        stat_ret = fstatat(base_fd, path, st, AT_SYMLINK_NOFOLLOW);
+
+        if (locked) {
+            int stat_err = errno;
+            _pathcache_rdunlock();
+            errno = stat_err;
+        }
+    } else {
+        stat_ret = stat(path, st);
+    }
+#else // __WIN__
+        /* a relative path is already looked up from the live cwd. */
+        if (SYSTEST_PATH_REL_TO_CWD == rel_to) {
+            stat_ret = stat(path, st);
+        } else {
+            if (!_pathcache_acquire(PATHCACHE_APPDIR)) {
+                handle_error(errno, "couldn't get base path!");
+                return false;
+            }
+
+            char abs_path[SYSTEST_MAXPATH] = { 0 };
+            snprintf(abs_path, SYSTEST_MAXPATH, "%s\\%s", _pathcache.appdir, path);
+            _pathcache_rdunlock();
+
+            stat_ret = stat(abs_path, st);
+        }
+    } else {
+        stat_ret = stat(path, st);
+    }
+#endif
+    if (-1 == stat_ret) {
+        if (ENOENT == errno) {
+            st->st_size = SYSTEST_STAT_NONEXISTENT;
+            return true;
+        } else {
+            handle_error(errno, "stat() failed!");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool systest_pathexists(const char* restrict path, bool* restrict exists, systest_rel_to rel_to) {
+    if (!_validstr(path) || !_validptr(exists))
+        return false;
+
+    *exists = false;
+
+    struct stat st = {0};
+    bool stat_ret  = systest_pathgetstat(path, &st, rel_to);
+    if (!stat_ret)
+        return false;
+
+    *exists = (st.st_size != SYSTEST_STAT_NONEXISTENT);
+    return true;
+}
+
+/** Shared state for one systest_pathgetstat_many/systest_pathexists_many call;
+ * either of sts/exists may be NULL. */
+typedef struct {
+    const char* const* paths;
+    size_t count;
+    struct stat* sts;
+    bool* exists;
+    int dir_fd;
+    unsigned mask;   /**< statx fields needed: just the type, for existence checks. */
+    atomic_size_t next;
+    atomic_int err;  /**< First error other than ENOENT, or zero. */
+} pathbatch;
+
+/** Lookups claimed by a worker at a time. */
+#define PATHBATCH_CHUNK 16
+
+/** Upper bound on threads for SYSTEST_PATHBATCH_PARALLEL. */
+#define PATHBATCH_MAX_THREADS 8
+
+/** SQEs in flight for SYSTEST_PATHBATCH_URING. */
+#define PATHBATCH_URING_QD 64
+
+/** Records the outcome (0 or an errno value) of looking up paths[idx]. */
+static void pathbatch_store(pathbatch* batch, size_t idx, int err, const struct stat* st) {
+    if (0 != err && ENOENT != err) {
+        int expected = 0;
+        atomic_compare_exchange_strong(&batch->err, &expected, err);
+    }
+
+    if (batch->exists)
+        batch->exists[idx] = (0 == err);
+
+    if (batch->sts) {
+        if (0 == err) {
+            batch->sts[idx] = *st;
+        } else {
+            memset(&batch->sts[idx], 0, sizeof(struct stat));
+            if (ENOENT == err)
+                batch->sts[idx].st_size = SYSTEST_STAT_NONEXISTENT;
+        }
+    }
+}
+
+#if defined(__HAVE_STATX__)
+static void pathbatch_statx_to_stat(const struct statx* stx, struct stat* st) {
+    memset(st, 0, sizeof(struct stat));
+    st->st_dev           = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+    st->st_ino           = (ino_t)stx->stx_ino;
+    st->st_mode          = (mode_t)stx->stx_mode;
+    st->st_nlink         = (nlink_t)stx->stx_nlink;
+    st->st_uid           = (uid_t)stx->stx_uid;
+    st->st_gid           = (gid_t)stx->stx_gid;
+    st->st_rdev          = makedev(stx->stx_rdev_major, stx->stx_rdev_minor);
+    st->st_size          = (off_t)stx->stx_size;
+    st->st_blksize       = (blksize_t)stx->stx_blksize;
+    st->st_blocks        = (blkcnt_t)stx->stx_blocks;
+    st->st_atim.tv_sec   = (time_t)stx->stx_atime.tv_sec;
+    st->st_atim.tv_nsec  = (long)stx->stx_atime.tv_nsec;
+    st->st_mtim.tv_sec   = (time_t)stx->stx_mtime.tv_sec;
+    st->st_mtim.tv_nsec  = (long)stx->stx_mtime.tv_nsec;
+    st->st_ctim.tv_sec   = (time_t)stx->stx_ctime.tv_sec;
+    st->st_ctim.tv_nsec  = (long)stx->stx_ctime.tv_nsec;
+}
+#endif
+
+static void pathbatch_lookup(pathbatch* batch, size_t idx) {
+    struct stat st = {0};
+    int err = 0;
+#if defined(__HAVE_STATX__)
+    struct statx stx;
+    if (0 == statx(batch->dir_fd, batch->paths[idx], AT_SYMLINK_NOFOLLOW, batch->mask, &stx)) {
+        if (batch->sts)
+            pathbatch_statx_to_stat(&stx, &st);
+    } else {
+        err = errno;
+    }
+#else
+    if (0 != fstatat(batch->dir_fd, batch->paths[idx], &st, AT_SYMLINK_NOFOLLOW))
+        err = errno;
+#endif
+    pathbatch_store(batch, idx, err, &st);
+}
+
+static void* pathbatch_worker(void* ctx) {
+    pathbatch* batch = (pathbatch*)ctx;
+    for (;;) {
+        size_t first = atomic_fetch_add(&batch->next, PATHBATCH_CHUNK);
+        if (first >= batch->count)
+            break;
+
+        size_t last = first + PATHBATCH_CHUNK;
+        if (last > batch->count)
+            last = batch->count;
+
+        for (size_t n = first; n < last; n++)
+            pathbatch_lookup(batch, n);
+    }
+    return NULL;
+}
+
+#if defined(__HAVE_IO_URING__) && defined(__HAVE_STATX__)
+/** Runs the batch as IORING_OP_STATX requests, PATHBATCH_URING_QD at a time.
+ * Returns false if the ring can't be set up, the kernel doesn't support statx
+ * through it, or it fails part way; batch->next is then where to carry on. */
+/** Waits out count requests still in flight, so that what they write into
+ * can be freed. Only gives up on errors that won't go away by waiting. */
+static bool pathbatch_uring_drain(systest_uring* ring, size_t count) {
+    struct io_uring_cqe cqe;
+    while (count > 0) {
+        if (systest_uring_getcqe(ring, &cqe, true))
+            count--;
+        else if (EINTR != errno && EAGAIN != errno && EBUSY != errno)
+            return false;
+    }
+    return true;
+}
+
+static bool pathbatch_run_uring(pathbatch* batch) {
+    systest_uring ring;
+    if (!systest_uring_init(&ring, PATHBATCH_URING_QD))
+        return false;
+
+    bool supported[256] = {false};
+    unsigned last_op    = 0;
+    if (!systest_uring_probeops(&ring, supported, &last_op) || !supported[IORING_OP_STATX]) {
+        systest_uring_free(&ring);
+        return false;
+    }
+
+    struct statx* bufs = calloc(PATHBATCH_URING_QD, sizeof(struct statx));
+    if (!bufs) {
+        systest_uring_free(&ring);
+        return false;
+    }
+
+    size_t first = 0;
+    bool drained = true;
+    for (; first < batch->count; first += PATHBATCH_URING_QD) {
+        size_t window = batch->count - first;
+        if (window > PATHBATCH_URING_QD)
+            window = PATHBATCH_URING_QD;
+
+        for (size_t n = 0; n < window; n++) {
+            struct io_uring_sqe* sqe = systest_uring_getsqe(&ring);
+            sqe->opcode      = IORING_OP_STATX;
+            sqe->fd          = batch->dir_fd;
+            sqe->addr        = (uint64_t)(uintptr_t)batch->paths[first + n];
+            sqe->len         = batch->mask;
+            sqe->off         = (uint64_t)(uintptr_t)&bufs[n];
+            sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+            sqe->user_data   = n;
+        }
+
+        /* -1 means none went in; fewer than asked for can, too. */
+        int submitted = systest_uring_submit(&ring, (unsigned)window);
+        if (submitted <= 0)
+            break;
+
+        size_t reaped = 0;
+        for (; reaped < (size_t)submitted; reaped++) {
+            struct io_uring_cqe cqe;
+            if (!systest_uring_getcqe(&ring, &cqe, true))
+                break;
+
+            size_t slot    = (size_t)cqe.user_data;
+            struct stat st = {0};
+            if (0 == cqe.res && batch->sts)
+                pathbatch_statx_to_stat(&bufs[slot], &st);
+            pathbatch_store(batch, first + slot, -cqe.res, &st);
+        }
+
+        if (reaped < (size_t)submitted) {
+            drained = pathbatch_uring_drain(&ring, (size_t)submitted - reaped);
+            break;
+        }
+        if ((size_t)submitted < window)
+            break;
+    }
+
+    /* if some are somehow still in flight, io-wq may yet write into bufs,
+     * so they're left to leak rather than be freed under it. */
+    if (drained)
+        systest_safefree(&bufs);
+    systest_uring_free(&ring);
+
+    if (first < batch->count) {
+        atomic_store(&batch->next, first);
+        return false;
+    }
+    return true;
+}
+#endif
+
+static void pathbatch_run_parallel(pathbatch* batch) {
+#if defined(__HAVE_PTHREADS__)
+    int cpus = 0;
+    if (!systest_getcpucount(&cpus) || cpus < 1)
+        cpus = 1;
+
+    size_t threads = batch->count / SYSTEST_PATHBATCH_PER_THREAD;
+    if (threads > (size_t)cpus)
+        threads = (size_t)cpus;
+    if (threads > PATHBATCH_MAX_THREADS)
+        threads = PATHBATCH_MAX_THREADS;
+
+    /* the calling thread is one of the workers. */
+    pthread_t tids[PATHBATCH_MAX_THREADS];
+    size_t started = 0;
+    for (; started + 1 < threads; started++) {
+        if (0 != pthread_create(&tids[started], NULL, &pathbatch_worker, batch))
+            break;
+    }
+
+    (void)pathbatch_worker(batch);
+
+    for (size_t n = 0; n < started; n++)
+        (void)pthread_join(tids[n], NULL);
+#else
+    (void)pathbatch_worker(batch);
+#endif
+}
+
+static bool pathbatch_run(pathbatch* batch, systest_rel_to rel_to, unsigned flags) {
+#if !defined(__WIN__)
+    bool locked = false;
+    batch->dir_fd = AT_FDCWD;
+    if (SYSTEST_PATH_REL_TO_APP == rel_to) {
+        if (!_pathcache_acquire(PATHCACHE_APPDIR_FD))
+            return false;
+        locked        = true;
+        batch->dir_fd = _pathcache.appdir_fd;
+    } else if (SYSTEST_PATH_REL_TO_CWD != rel_to) {
+        errno = EINVAL;
+        return false;
+    }
+
+    bool done = false;
+# if defined(__HAVE_IO_URING__) && defined(__HAVE_STATX__)
+    if (0 != (flags & SYSTEST_PATHBATCH_URING))
+        done = pathbatch_run_uring(batch);
+# endif
+    if (!done) {
+        if (0 != (flags & SYSTEST_PATHBATCH_PARALLEL) &&
+            batch->count >= 2 * SYSTEST_PATHBATCH_PER_THREAD)
+            pathbatch_run_parallel(batch);
+        else
+            (void)pathbatch_worker(batch);
+    }
+
+    if (locked)
+        _pathcache_rdunlock();
+#else
+    (void)flags;
+    for (size_t n = 0; n < batch->count; n++) {
+        struct stat st = {0};
+        if (!systest_pathgetstat(batch->paths[n], &st, rel_to)) {
+            pathbatch_store(batch, n, 0 != errno ? errno : EIO, &st);
+        } else if (SYSTEST_STAT_NONEXISTENT == st.st_size) {
+            pathbatch_store(batch, n, ENOENT, &st);
+        } else {
+            pathbatch_store(batch, n, 0, &st);
+        }
+    }
+#endif
+
+    int err = atomic_load(&batch->err);
+    if (0 != err) {
+        errno = err;
+        return false;
+    }
+    return true;
+}
+
+bool systest_pathgetstat_many(const char* const* paths, size_t count, struct stat* sts,
+    systest_rel_to rel_to, unsigned flags) {
+    if (!_validptr(paths) || !_validptr(sts))
+        return false;
+
+#if defined(__HAVE_STATX__)
+    pathbatch batch = {paths, count, sts, NULL, AT_FDCWD, STATX_BASIC_STATS, 0, 0};
+#else
+    pathbatch batch = {paths, count, sts, NULL, -1, 0, 0, 0};
+#endif
+    return pathbatch_run(&batch, rel_to, flags);
+}
+
+bool systest_pathexists_many(const char* const* paths, size_t count, bool* exists,
+    systest_rel_to rel_to, unsigned flags) {
+    if (!_validptr(paths) || !_validptr(exists))
+        return false;
+
+#if defined(__HAVE_STATX__)
+    pathbatch batch = {paths, count, NULL, exists, AT_FDCWD, STATX_TYPE, 0, 0};
+#else
+    pathbatch batch = {paths, count, NULL, exists, -1, 0, 0, 0};
+#endif
+    return pathbatch_run(&batch, rel_to, flags);
+}
+
+char* systest_getcwd(void) {
+#if !defined(__WIN__)
+# if defined(__linux__) && defined(_GNU_SOURCE)
+    char* cur = get_current_dir_name();
+    if (NULL == cur)
+        handle_error(errno, "");
+    return cur;
+# else
+    char* cur = getcwd(NULL, 0);
+    if (NULL == cur)
+        handle_error(errno, "");
+    return cur;
+# endif
+#else // __WIN__
+    char* cur = _getcwd(NULL, 0);
+    if (NULL == cur)
+        handle_error(errno, "");
+    return cur;
+#endif
+}
+
+char* systest_getappfilename(void) {
+    return _pathcache_dup(PATHCACHE_APPFILENAME);
+}
+
+static char* _systest_resolveappfilename(void) {
+
+    char* buffer = (char*)calloc(SYSTEST_MAXPATH, sizeof(char));
+    if (NULL == buffer) {
+        handle_error(errno, "");
+        return NULL;
+    }
+
+    bool resolved = false;
+    size_t size   = SYSTEST_MAXPATH;
+    bool grow     = false;
+
+    do {
+        if (grow) {
+            systest_safefree(&buffer);
+
+            buffer = (char*)calloc(size, sizeof(char));
+            if (NULL == buffer) {
+                handle_error(errno, "");
+                resolved = false;
+                break;
+            }
+
+            grow = false;
+        }
+
+#if !defined(__WIN__)
+# if defined(__linux__)
+#  if defined(__HAVE_UNISTD_READLINK__)
+        ssize_t read = readlink("/proc/self/exe", buffer, size);
+        self_log("readlink() returned: %ld (size = %zu)", read, size);
+        if (-1 != read && read < (ssize_t)size) {
+            resolved = true;
+            break;
+        } else {
+            if (-1 == read) {
+                handle_error(errno, "");
+                resolved = false;
+                break;
+            } else if (read >= (ssize_t)size) {
+                /* readlink, like Windows' impl, doesn't have a concept
+                * of letting you know how much larger your buffer needs
+                * to be; it just truncates the string and returns how
+                * many chars it wrote there. */
+                size += SYSTEST_PATH_BUFFER_GROW_BY;
+                grow = true;
+                continue;
+            }
+        }
+#  else
+#   error "unable to resolve readlink(); see man readlink and its feature test macro requirements."
+#  endif
+# elif defined(__FreeBSD__)
+        int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PATHNAME, -1 };
+        int ret = sysctl(mib, 4, buffer, &size, NULL, 0);
+        self_log("sysctl() returned: %d (size = %zu)", ret, size);
+        if (0 == ret) {
+            resolved = true;
+            break;
+        } else {
+            handle_error(errno, "");
+            resolved = false;
+            break;
+        }
+# elif defined(__APPLE__)
+        int ret = _NSGetExecutablePath(buffer, (uint32_t*)&size);
+        if (0 == ret) {
+            resolved = true;
+            break;
+        } else if (-1 == ret) {
+            grow = true;
+            continue;
+        } else {
+            handle_error(errno, "");
+            resolved = false;
+            break;
+        }
+# else
+#  error "no implementation for your platform; please contact the author."
+# endif
+#else // __WIN__
+        DWORD ret = GetModuleFileNameA(NULL, buffer, (DWORD)size);
+        if (0 != ret && ret < (DWORD)size) {
+            resolved = true;
+            break;
+        } else {
+            if (0 == ret) {
+                handle_error(GetLastError(), "GetModuleFileNameA() failed!");
+                resolved = false;
+                break;
+            } else if (ret == (DWORD)size || ERROR_INSUFFICIENT_BUFFER == GetLastError()) {
+                /* Windows has no concept of letting you know how much larger
+                * your buffer needed to be; it just truncates the string and
+                * returns size. So, we'll guess. */
+                size += SYSTEST_PATH_BUFFER_GROW_BY;
+                grow = true;
+                continue;
+            }
+        }
+#endif
+
+    } while (true);
+
+    if (!resolved) {
+        systest_safefree(&buffer);
+        self_log("failed to resolve filename!");
+    }
+
+    return buffer;
+}
+
+char* systest_getappbasename(void) {
+    if (!_pathcache_acquire(PATHCACHE_APPFILENAME))
+        return NULL;
+
+    /* basename() may modify its argument. */
+    char* filename = strdup(_pathcache.appfilename);
+    _pathcache_rdunlock();
+    if (!filename) {
+        handle_error(errno, "strdup() failed!");
+        return NULL;
+    }
+
+    char* retval = systest_getbasename(filename);
+    char* bname  = strdup(retval);
+
+    systest_safefree(&filename);
+    return bname;
+}
+
+char* systest_getappdir(void) {
+    return _pathcache_dup(PATHCACHE_APPDIR);
+}
+
+char* systest_getbasename(char* restrict path) {
+    if (!_validstr(path))
+        return ".";
+
+#if !defined(__WIN__)
+    return basename(path);
+#else
+    return PathFindFileNameA(path);
+#endif
+}
+
+char* systest_getdirname(char* restrict path) {
+    if (!_validstr(path))
+        return ".";
+
+#if !defined(__WIN__)
+    return dirname(path);
+#else
+    if (!PathRemoveFileSpecA((LPSTR)path))
+        handle_error(GetLastError(), "PathRemoveFileSpecA() failed!");
+    return path;
+#endif
+}
+
+bool systest_ispathrelative(const char* restrict path, bool* restrict relative) {
+    if (!_validstr(path) || !_validptr(relative))
+        return false;
+
+#if !defined(__WIN__)
+    if (path[0] == '/' || (path[0] == '~' && path[1] == '/'))
+        *relative = false;
+    else
+        *relative = true;
+    return true;
+#else
+    *relative = (TRUE == PathIsRelativeA(path));
+    return true;
+#endif
+}
+
+char* systest_stattostring(struct stat* restrict st) {
+    if (!_validptr(st))
+        return NULL;
+
+    char* buffer = (char*)calloc(SYSTEST_STAT_BUFFER_SIZE, sizeof(char));
+    if (!buffer) {
+        handle_error(errno, "calloc() failed!");
+        return NULL;
+    }
+
+#if defined(__WIN__)
+# define S_IFBLK 0x0001
+# define S_IFLNK 0x0002
+# define S_IFSOCK 0x0003
+# define S_IFIFO _S_IFIFO
+# define S_IRUSR 0x0100
+# define S_IWUSR 0x0080
+# define S_IXUSR 0x0040
+# define S_IRGRP 0x0010
+# define S_IWGRP 0x0400
+# define S_IXGRP 0x0004
+# define S_IROTH 0x0020
+# define S_IWOTH 0x0800
+# define S_IXOTH 0x0008
+#endif
+
+    char* type = "";
+    switch (st->st_mode & S_IFMT) {
+        case S_IFBLK:  type = "block device"; break;
+        case S_IFCHR:  type = "character special"; break;
+        case S_IFDIR:  type = "directory"; break;
+        case S_IFIFO:  type = "pipe (fifo)"; break;
+        case S_IFLNK:  type = "symlink"; break;
+        case S_IFREG:  type = "regular"; break;
+        case S_IFSOCK: type = "socket"; break;
+        default:       type = "<unknown>"; break;
+    }
+
+    char mode[32] = {0};
+    snprintf(mode, sizeof(mode), "%c%c%c%c%c%c%c%c%c%c (%03o)",
+        (systest_bittest(st->st_mode & S_IFMT, S_IFDIR) ? 'd' :
+        (systest_bittest(st->st_mode & S_IFMT, S_IFSOCK) ? 's' : '-')),
+        (systest_bittest(st->st_mode & 0x0FFF, S_IRUSR) ? 'r' : '-'),
+        (systest_bittest(st->st_mode & 0x0FFF, S_IWUSR) ? 'w' : '-'),
+        (systest_bittest(st->st_mode & 0x0FFF, S_IXUSR) ? 'x' : '-'),
+        (systest_bittest(st->st_mode & 0x0FFF, S_IRGRP) ? 'r' : '-'),
+        (systest_bittest(st->st_mode & 0x0FFF, S_IWGRP) ? 'w' : '-'),
+        (systest_bittest(st->st_mode & 0x0FFF, S_IXGRP) ? 'x' : '-'),
+        (systest_bittest(st->st_mode & 0x0FFF, S_IROTH) ? 'r' : '-'),
+        (systest_bittest(st->st_mode & 0x0FFF, S_IWOTH) ? 'w' : '-'),
+        (systest_bittest(st->st_mode & 0x0FFF, S_IXOTH) ? 'x' : '-'),
+        ((st->st_mode & 0x0FFF) & ((S_IRUSR | S_IWUSR | S_IXUSR) |
+            (S_IRGRP | S_IWGRP | S_IXGRP) |
+            (S_IROTH | S_IWOTH | S_IXOTH))));
+
+    snprintf(buffer, SYSTEST_STAT_BUFFER_SIZE, "{ type: %s, size: %ld, "
+        "mode: %s }", type, (long)st->st_size, mode);
+
+    return buffer;
+}
+
+bool systest_add_slash(char* restrict path) {
+    if (!_validstr(path))
+        return false;
+
+    size_t path_len = strnlen(path, SYSTEST_MAXPATH);
+
+    if (path_len > SYSTEST_MAXPATH - 2)
+        return false;
+
+    if (path[path_len - 1] != '/' && path[path_len - 1] != '\\') {
+        path[path_len] = SYSTEST_PATH_SEP;
+        path[path_len + 1] = '\0';
+    }
+
+    return true;
+}
+
+#define GIB_FROM_BYTES(bytes) ((bytes) / 1024 / 1024 / 1024)
+
+bool systest_getfreediskspace(uint64_t* bytes) {
+    if (bytes == NULL) {
+        return false;
+    }
+#if !defined(__WIN__)
+    struct statvfs stvfs = {0};
+    if (-1 == statvfs(".", &stvfs)) {
+        handle_error(errno, "statvfs");
+        return false;
+    }
+
+    *bytes = (uint64_t)(stvfs.f_bavail * (stvfs.f_frsize ? stvfs.f_frsize : stvfs.f_bsize));
+    systest_printf("free disk space: %"PRIu64" GiB\n", GIB_FROM_BYTES(*bytes));
+    return true;
+#else
+    ULARGE_INTEGER free_bytes = {0};
+    if (!GetDiskFreeSpaceExA(NULL, &free_bytes, NULL, NULL)) {
+        handle_error(GetLastError(), "GetDiskFreeSpaceEx");
+        return false;
+    }
+    systest_printf("free disk space: %"PRIu64" GiB\n", GIB_FROM_BYTES(free_bytes.QuadPart));
+    *bytes = free_bytes.QuadPart;
+    return true;
+#endif
+}
+
+#if defined(__linux__) && defined(__HAVE_PTHREADS__)
+typedef enum {
+    MOUNT_PENDING,
+    MOUNT_RUNNING,
+    MOUNT_DONE,
+    MOUNT_STUCK
+} mount_state;
+
+/** State shared by systest_getmounts() and its workers. A worker stuck in
+ * statvfs() can't be cancelled, so whoever lets go of this last frees it. */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t refs;
+    systest_mount* mounts;
+    mount_state* states;
+    uint64_t* started_ns;
+    size_t count;
+    size_t next;      /**< Next mount to be claimed. */
+    size_t workers;   /**< Workers not stuck in statvfs(). */
+    size_t spawned;
+    bool finished;    /**< The caller has its results; stragglers just leave. */
+} mount_scan;
+
+/** Total threads a scan may start, replacements for stuck ones included. */
+#define MOUNT_MAX_SPAWNED (SYSTEST_MOUNT_THREADS * 4)
+
+static void mount_scan_release(mount_scan* scan) {
+    /* lock held. */
+    if (0 != --scan->refs) {
+        (void)pthread_mutex_unlock(&scan->lock);
+        return;
+    }
+
+    (void)pthread_mutex_unlock(&scan->lock);
+    systest_freemounts(scan->mounts, scan->count);
+    systest_safefree(&scan->states);
+    systest_safefree(&scan->started_ns);
+    (void)pthread_cond_destroy(&scan->cond);
+    (void)pthread_mutex_destroy(&scan->lock);
+    systest_safefree(&scan);
+}
+
+static void* mount_scan_worker(void* arg) {
+    mount_scan* scan = (mount_scan*)arg;
+
+    (void)pthread_mutex_lock(&scan->lock);
+    while (!scan->finished && scan->next < scan->count) {
+        size_t idx = scan->next++;
+        scan->states[idx]     = MOUNT_RUNNING;
+        scan->started_ns[idx] = systest_monotonic_ns();
+        const char* path      = scan->mounts[idx].mount_point;
+        (void)pthread_mutex_unlock(&scan->lock);
+
+        struct statvfs st = {0};
+        int err = (0 == statvfs(path, &st)) ? 0 : errno;
+
+        (void)pthread_mutex_lock(&scan->lock);
+        if (MOUNT_RUNNING == scan->states[idx]) {
+            systest_mount* m = &scan->mounts[idx];
+            uint64_t frsize  = st.f_frsize ? st.f_frsize : st.f_bsize;
+            m->err           = err;
+            m->total_bytes   = (uint64_t)st.f_blocks * frsize;
+            m->avail_bytes   = (uint64_t)st.f_bavail * frsize;
+            m->total_inodes  = (uint64_t)st.f_files;
+            m->free_inodes   = (uint64_t)st.f_ffree;
+            scan->states[idx] = MOUNT_DONE;
+        } else {
+            /* given up on while we were away; count as a worker again. */
+            scan->workers++;
+        }
+        (void)pthread_cond_broadcast(&scan->cond);
+    }
+
+    scan->workers--;
+    (void)pthread_cond_broadcast(&scan->cond);
+    mount_scan_release(scan);
+    return NULL;
+}
+
+/** Starts workers until there are enough; lock held. */
+static void mount_scan_spawn(mount_scan* scan) {
+    pthread_attr_t attr;
+    if (0 != pthread_attr_init(&attr))
+        return;
+    (void)pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    while (scan->workers < SYSTEST_MOUNT_THREADS && scan->workers < scan->count - scan->next &&
+        scan->spawned < MOUNT_MAX_SPAWNED) {
+        pthread_t tid;
+        scan->refs++;
+        int ret = pthread_create(&tid, &attr, &mount_scan_worker, scan);
+        if (0 != ret) {
+            scan->refs--;
+            handle_error(ret, "pthread_create() failed!");
+            break;
+        }
+        scan->workers++;
+        scan->spawned++;
+    }
+
+    (void)pthread_attr_destroy(&attr);
+}
+
+/** Splits a mountinfo line into the fields systest_getmounts() keeps. Paths
+ * have spaces etc. escaped as \ooo; those are decoded in place. */
+static bool mount_parse_line(char* line, systest_mount* m) {
+    char* fields[16] = {NULL};
+    size_t nfields   = 0;
+    char* save       = NULL;
+    for (char* tok = strtok_r(line, " \n", &save); tok && nfields < __countof(fields);
+        tok = strtok_r(NULL, " \n", &save))
+        fields[nfields++] = tok;
+
+    /* id parent dev root mount_point options [optional...] - type source super */
+    size_t sep = 6;
+    while (sep < nfields && 0 != strcmp(fields[sep], "-"))
+        sep++;
+    if (nfields < 5 || sep + 2 >= nfields)
+        return false;
+
+    for (char* in = fields[4], *out = fields[4]; ; in++, out++) {
+        if ('\\' == in[0] && in[1] >= '0' && in[1] <= '7' && in[2] >= '0' && in[2] <= '7' &&
+            in[3] >= '0' && in[3] <= '7') {
+            *out = (char)(((in[1] - '0') << 6) | ((in[2] - '0') << 3) | (in[3] - '0'));
+            in += 3;
+        } else {
+            *out = *in;
+        }
+        if ('\0' == *in)
+            break;
+    }
+
+    m->mount_point = strdup(fields[4]);
+    m->fs_type     = strdup(fields[sep + 1]);
+    m->source      = strdup(fields[sep + 2]);
+    return m->mount_point && m->fs_type && m->source;
+}
+
+static bool mount_read_mountinfo(systest_mount** mounts, size_t* count) {
+    FILE* f = fopen("/proc/self/mountinfo", "r");
+    if (!f) {
+        handle_error(errno, "fopen() failed!");
+        return false;
+    }
+
+    size_t cap = 0;
+    char* line = NULL;
+    size_t line_size = 0;
+    bool ok = true;
+    *mounts = NULL;
+    *count  = 0;
+
+    while (ok && -1 != getline(&line, &line_size, f)) {
+        if (*count == cap) {
+            size_t new_cap = cap ? cap * 2 : 64;
+            systest_mount* grown = realloc(*mounts, new_cap * sizeof(systest_mount));
+            if (!grown) {
+                handle_error(errno, "realloc() failed!");
+                ok = false;
+                break;
+            }
+            *mounts = grown;
+            cap     = new_cap;
+        }
+
+        systest_mount* m = &(*mounts)[*count];
+        memset(m, 0, sizeof(systest_mount));
+        if (mount_parse_line(line, m)) {
+            (*count)++;
+        } else {
+            systest_safefree(&m->mount_point);
+            systest_safefree(&m->fs_type);
+            systest_safefree(&m->source);
+        }
+    }
+
+    systest_safefree(&line);
+    (void)fclose(f);
+    if (!ok) {
+        systest_freemounts(*mounts, *count);
+        *mounts = NULL;
+        *count  = 0;
+    }
+    return ok;
+}
+
+bool systest_getmounts(systest_mount** mounts, size_t* count, int timeout_ms) {
+    if (!_validptr(mounts) || !_validptr(count))
+        return false;
+
+    *mounts = NULL;
+    *count  = 0;
+
+    mount_scan* scan = calloc(1, sizeof(mount_scan));
+    if (!scan) {
+        handle_error(errno, "calloc() failed!");
+        return false;
+    }
+
+    if (!mount_read_mountinfo(&scan->mounts, &scan->count)) {
+        systest_safefree(&scan);
+        return false;
+    }
+
+    /* the copy handed back; workers only ever touch the scan's own. */
+    systest_mount* result = calloc(scan->count ? scan->count : 1, sizeof(systest_mount));
+    scan->states          = calloc(scan->count ? scan->count : 1, sizeof(mount_state));
+    scan->started_ns      = calloc(scan->count ? scan->count : 1, sizeof(uint64_t));
+    if (!result || !scan->states || !scan->started_ns) {
+        handle_error(errno, "calloc() failed!");
+        systest_safefree(&result);
+        systest_freemounts(scan->mounts, scan->count);
+        systest_safefree(&scan->states);
+        systest_safefree(&scan->started_ns);
+        systest_safefree(&scan);
+        return false;
+    }
+
+    pthread_condattr_t cattr;
+    (void)pthread_condattr_init(&cattr);
+    (void)pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    (void)pthread_cond_init(&scan->cond, &cattr);
+    (void)pthread_condattr_destroy(&cattr);
+    (void)pthread_mutex_init(&scan->lock, NULL);
+    scan->refs = 1;
+
+    const uint64_t timeout_ns = (uint64_t)(timeout_ms > 0 ? timeout_ms : SYSTEST_MOUNT_TIMEOUT_MS) * 1000000ULL;
+
+    (void)pthread_mutex_lock(&scan->lock);
+    mount_scan_spawn(scan);
+
+    for (;;) {
+        uint64_t now = systest_monotonic_ns();
+        uint64_t wake = now + timeout_ns;
+        size_t settled = 0;
+
+        for (size_t n = 0; n < scan->count; n++) {
+            if (MOUNT_RUNNING == scan->states[n]) {
+                uint64_t deadline = scan->started_ns[n] + timeout_ns;
+                if (now >= deadline) {
+                    scan->states[n] = MOUNT_STUCK;
+                    scan->workers--;
+                } else if (deadline < wake) {
+                    wake = deadline;
+                }
+            }
+            if (MOUNT_DONE == scan->states[n] || MOUNT_STUCK == scan->states[n])
+                settled++;
+        }
+
+        if (settled == scan->count)
+            break;
+
+        mount_scan_spawn(scan);
+        if (0 == scan->workers) {
+            /* out of threads: whatever is left is as good as stuck. */
+            for (size_t n = scan->next; n < scan->count; n++)
+                scan->states[n] = MOUNT_STUCK;
+            scan->next = scan->count;
+            continue;
+        }
+
+        struct timespec ts = {(time_t)(wake / 1000000000ULL), (long)(wake % 1000000000ULL)};
+        (void)pthread_cond_timedwait(&scan->cond, &scan->lock, &ts);
+    }
+
+    scan->finished = true;
+    bool ok = true;
+    for (size_t n = 0; n < scan->count; n++) {
+        result[n] = scan->mounts[n];
+        result[n].stuck       = (MOUNT_STUCK == scan->states[n]);
+        result[n].mount_point = strdup(scan->mounts[n].mount_point);
+        result[n].fs_type     = strdup(scan->mounts[n].fs_type);
+        result[n].source      = strdup(scan->mounts[n].source);
+        ok &= result[n].mount_point && result[n].fs_type && result[n].source;
+    }
+    size_t result_count = scan->count;
+    mount_scan_release(scan);
+
+    if (!ok) {
+        handle_error(ENOMEM, "strdup() failed!");
+        systest_freemounts(result, result_count);
+        return false;
+    }
+
+    *mounts = result;
+    *count  = result_count;
+    return true;
+}
+
+void systest_freemounts(systest_mount* mounts, size_t count) {
+    if (!mounts)
+        return;
+
+    for (size_t n = 0; n < count; n++) {
+        systest_safefree(&mounts[n].mount_point);
+        systest_safefree(&mounts[n].fs_type);
+        systest_safefree(&mounts[n].source);
+    }
+    free(mounts);
+}
+#endif
+
+bool systest_gethostname(char hname[SYSTEST_MAXHOST]) {
+    hname[0] = '\0';
+#if !defined(__WIN__)
+    if (-1 == gethostname(hname, SYSTEST_MAXHOST - 1)) {
+        handle_error(errno, "gethostname() failed!");
+        return false;
+    }
+#else
+    WSADATA wsad = {0};
+    int ret = WSAStartup(MAKEWORD(2, 2), &wsad);
+    if (0 != ret) {
+        handle_error(ret, "WSAStartup() failed!");
+        return false;
+    }
+
+    if (SOCKET_ERROR == gethostname(hname, SYSTEST_MAXHOST)) {
+        handle_error(WSAGetLastError(), "gethostname() failed!");
+        WSACleanup();
+        return false;
+    }
+
+    WSACleanup();
+#endif // !__WIN__
+    return true;
+}
+
+bool systest_getuname(struct utsname* name) {
+    if (!_validptr(name))
+        return false;
+
+    memset(name, 0, sizeof(struct utsname));
+
+#if !defined(__WIN__)
+    if (-1 == uname(name)) {
+        handle_error(errno, "uname() failed!");
+        return false;
+    }
+#else
+    static const char* sys_name = "Windows";
+    static const char* kernel_dll = "kernel32.dll";
+
+    strncpy(name->sysname, sys_name, strnlen(sys_name, _SYS_NAMELEN));
+
+    char tmp[SYSTEST_MAXHOST];
+    if (!systest_gethostname(tmp))
+        return false;
+
+    strncpy(name->nodename, tmp, strnlen(tmp, _SYS_NAMELEN));
+
+    char path[SYSTEST_MAXPATH];
+    if (0 == GetSystemDirectoryA(path, SYSTEST_MAXPATH)) {
+        handle_error(GetLastError(), "GetSystemDirectoryA failed!");
+        return false;
+    }
+
+    if (!PathAppendA(path, kernel_dll)) {
+        handle_error(GetLastError(), "PathAppendA failed!");
+        return false;
+    }
+
+    self_log("kernel dll is at: %s; extracting version...", path);
+
+    DWORD vsize = GetFileVersionInfoSizeA(path, NULL);
+    if (0 == vsize) {
+        handle_error(GetLastError(), "GetFileVersionInfoSizeA failed!");
+        return false;
+    }
+
+    VS_FIXEDFILEINFO* fvi = calloc(1, vsize);
+    if (!fvi) {
+        handle_error(errno, "calloc failed!");
+        return false;
+    }
+
+    if (!GetFileVersionInfoA(path, 0, vsize, fvi)) {
+        handle_error(GetLastError(), "GetFileVersionInfoA failed!");
+        systest_safefree(fvi);
+        return false;
+    }
+
+    UINT blk_size = 0;
+    VS_FIXEDFILEINFO* blk = NULL;
+    if (!VerQueryValueA(fvi, "\\", &blk, &blk_size) || blk_size < sizeof(VS_FIXEDFILEINFO)) {
+        handle_error(GetLastError(), "VerQueryValueA failed!");
+        systest_safefree(fvi);
+        return false;
+    }
+
+    WORD verMajor = HIWORD(blk->dwProductVersionMS);
+    const WORD verMinor = LOWORD(blk->dwProductVersionMS);
+    const WORD verBuild = HIWORD(blk->dwProductVersionLS);
+
+    static const WORD build_win11_threshold = 22000;
+    if (verBuild >= build_win11_threshold) {
+        verMajor = 11;
+    }
+
+    systest_safefree(fvi);
+
+    int prn = sprintf(name->release, "%hu.%hu.%hu", verMajor, verMinor, verBuild);
+    assert(prn > 0);
+
+    SYSTEM_INFO si = {0};
+    GetNativeSystemInfo(&si);
+
+    const char* mach_hw_str = "";
+    switch (si.wProcessorArchitecture) {
+        case PROCESSOR_ARCHITECTURE_INTEL: mach_hw_str = "x86"; break;
+        case PROCESSOR_ARCHITECTURE_IA64: mach_hw_str = "IA64"; break;
+        case PROCESSOR_ARCHITECTURE_ARM64: mach_hw_str = "aarch64"; break;
+        case PROCESSOR_ARCHITECTURE_ARM: mach_hw_str = "armhf"; break;
+        case PROCESSOR_ARCHITECTURE_AMD64: mach_hw_str = "x86_64"; break;
+        case PROCESSOR_ARCHITECTURE_UNKNOWN:
+        default:
+            mach_hw_str = "<unknown>";
+            break;
+    }
+
+    prn = snprintf(name->version, _SYS_NAMELEN, "%s %hu.%hu.%hu-%s", sys_name, verMajor,
+        verMinor, verBuild, mach_hw_str);
+    assert(prn > 0);
+
+    strncpy(name->machine, mach_hw_str, strnlen(mach_hw_str, _SYS_NAMELEN));
+
+#endif // !__WIN__
+    return true;
+}
+
+bool systest_getcpucount(int* ncpus) {
+    if (!ncpus)
+        return false;
+    *ncpus = 0;
+
+#if defined(CTL_HW)
+# pragma message("have CTL_HW")
+#endif
+
+#if defined(__MACOS__)
+    static struct {
+        const char* const name;
+        const char* const desc;
+        int mib[2];
+    } sysctl_entries[] = {
+        {"hw.ncpu", "the maximum number of processors that could be available this boot", {6, 3}},
+        {"hw.activecpu", "the number of processors currently available for executing threads", {6, 25}},
+        {"hw.physicalcpu", "the number of physical processors available in the current power mode", {6, 104}},
+        {"hw.physicalcpu_max", "the maximum number of physical processors that could be available this boot", {6, 105}},
+        {"hw.logicalcpu", "the number of logical processors available in the current power mode", {6, 106}},
+        {"hw.logicalcpu_max", "the maximum number of logical processors that could be available this boot", {6, 107}}
+    };
+
+    for (size_t n = 0; n < __countof(sysctl_entries); n++) {
+        u_int mib_size = __countof(sysctl_entries[n].mib);
+        int ret_value = 0;
+        size_t ret_size = sizeof(int);
+        if (-1 == sysctl(sysctl_entries[n].mib, mib_size, &ret_value, &ret_size, NULL, 0)) {
+            handle_error(errno, "sysctl");
+            continue;
+        }
+        self_log("%s: value = %d", sysctl_entries[n].name, ret_value);
+        if (n == 4) {
+            *ncpus = ret_value;
+        }
+    }
+
+#elif defined(__WIN__)
+    /*DWORD count = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    self_log("GetActiveProcessorCount: %lu", count);*/
+    DWORD count2 = GetMaximumProcessorCount(ALL_PROCESSOR_GROUPS);
+    self_log("GetMaximumProcessorCount: %lu", count2);
+
+    *ncpus = (int)count2;
+
+    /*DWORD lpbuf_len = 0UL;
+    GetLogicalProcessorInformationEx(RelationGroup, NULL, &lpbuf_len);
+    if (ERROR_INSUFFICIENT_BUFFER != GetLastError())
+       return false;
+
+    self_log("lpbuf_len = %lu; allocating...", lpbuf_len);
+    PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX lp = malloc(lpbuf_len);
+    if (!lp)
+        return false;
+
+    if (!GetLogicalProcessorInformationEx(RelationGroup, lp, &lpbuf_len)) {
+        self_log("ERROR: 2nd call failed: %lu", GetLastError());
+        _systest_safefree(&lp);
+        return false;
+    }
+
+    size_t ret_count = (lpbuf_len / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX));
+    self_log("got %zu structures, enumerating...", ret_count);
+    for (size_t n = 0; n < ret_count; n++) {
+        self_log("relationship: %d, size: %lu", lp[n].Relationship, lp[n].Size);
+        self_log("group: active count: %hu, max count: %hu", lp[n].Group.ActiveGroupCount,
+            lp[n].Group.MaximumGroupCount);
+        for (size_t g = 0; g < lp[n].Group.ActiveGroupCount; g++) {
+            self_log("group[%zu]: MaxCPUs: %x, ActiveCPUs: %x, afffinity: %llx", g,
+                lp[n].Group.GroupInfo[g].MaximumProcessorCount,
+                lp[n].Group.GroupInfo[g].ActiveProcessorCount,
+                lp[n].Group.GroupInfo[g].ActiveProcessorMask);
+        }
+    }
+
+    _systest_safefree(&lp);*/
+#elif defined(__linux__) || defined(__BSD__)
+# if defined(__HAVE_GET_NPROCS__)
+    int gnprocs = get_nprocs();
+    int gnprocsc = get_nprocs_conf();
+    self_log("get_nprocs: available: %d, configured: %d", gnprocs, gnprocsc);
+    //*ncpus = gnprocs;
+# endif
+# if defined(__HAVE_SYSCTL__)
+    /*int scprocs = 0; // hw.logicalcpu works on macOS, not on FreeBSD.
+    size_t len = sizeof(int);
+    sysctlbyname("hw.logicalcpu", &scprocs, &len, NULL, 0);
+    self_log("__HAVE_SYSCTL__: logical cpus: %d", scprocs);
+    *ncpus = scprocs;*/
+    int mib[2] = {CTL_HW, HW_NCPU}; // hw.ncpu
+    u_int mib_size = 2;
+    int ret_value = 0;
+    size_t ret_size = sizeof(int);
+    if (-1 != sysctl(mib, mib_size, &ret_value, &ret_size, NULL, 0)) {
+        self_log("sysctl(%d, %d): %d", mib[0], mib[1], ret_value);
+        *ncpus = ret_value;
+    } else {
+        handle_error(errno, "sysctl");
+    }
+# endif
+    long sconfprocs = sysconf(_SC_NPROCESSORS_ONLN);
+    long sconfprocsc = sysconf(_SC_NPROCESSORS_CONF);
+    self_log("sysconf: available: %ld, configured: %ld", sconfprocs, sconfprocsc);
+    if (sconfprocs > 0)
+        *ncpus = (int)sconfprocs;
+# if defined(__HAVE_SCHED__) && !defined(__ANDROID__)
+    /* a cpuset or taskset narrows what this process can actually use. */
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &set)) {
+        handle_error(errno, "sched_getaffinity");
+    } else {
+        int gaprocs = CPU_COUNT(&set);
+        self_log("sched_getaffinity: %d", gaprocs);
+        if (gaprocs > 0 && (gaprocs < *ncpus || *ncpus < 1))
+            *ncpus = gaprocs;
+    }
+# endif
+#elif defined(__HAIKU__)
+    system_info si = {0};
+    status_t ret = get_system_info(&si);
+    if (B_OK != ret) {
+        handle_error(B_TO_POSIX_ERROR(ret), "get_system_info");
+    } else {
+        self_log("get_system_info: %u", si.cpu_count);
+        *ncpus = (int)si.cpu_count;
+    }
+#else
+#error "CPU count not implemented for this platform"
+#endif
+
+    return true;
+}
+
+#if defined(__linux__)
+/** Reads a single integer from a sysfs/procfs file. */
+static bool _sysfs_readlong(const char* path, long* value) {
+    FILE* f = fopen(path, "r");
+    if (!f)
+        return false;
+    bool ok = (1 == fscanf(f, "%ld", value));
+    (void)fclose(f);
+    return ok;
+}
+
+/** Reads the first line of a sysfs/procfs file, without the newline. */
+static bool _sysfs_readstr(const char* path, char* buf, size_t size) {
+    FILE* f = fopen(path, "r");
+    if (!f)
+        return false;
+    bool ok = (NULL != fgets(buf, (int)size, f));
+    (void)fclose(f);
+    if (ok)
+        buf[strcspn(buf, "\n")] = '\0';
+    return ok;
+}
+
+/** Parses a CPU list such as "0-3,8,10-11" into set (of max entries). Returns
+ * the number of CPUs in it, or -1 if it isn't one. */
+static int _parse_cpulist(const char* list, bool* set, size_t max) {
+    int count = 0;
+    memset(set, 0, max * sizeof(bool));
+    for (const char* cur = list; *cur; ) {
+        char* end = NULL;
+        long first = strtol(cur, &end, 10);
+        long last  = first;
+        if (end == cur || first < 0)
+            return -1;
+        if ('-' == *end) {
+            cur  = end + 1;
+            last = strtol(cur, &end, 10);
+            if (end == cur || last < first)
+                return -1;
+        }
+        for (long n = first; n <= last && (size_t)n < max; n++) {
+            if (!set[n])
+                count++;
+            set[n] = true;
+        }
+        cur = (',' == *end) ? end + 1 : end;
+        if (*cur && ('0' > *cur || *cur > '9'))
+            break;
+    }
+    return count;
+}
+
+/** Fills in the cache entries for cpu from its sysfs cache/indexN dirs. */
+static void _topo_read_caches(systest_cputopo* topo, systest_cpu* cpu, bool* scratch) {
+    char path[128], str[64];
+    for (size_t idx = 0; idx < SYSTEST_MAX_CACHES; idx++) {
+        long level = 0, line = 0, ways = 0;
+        (void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%zu/level",
+            cpu->id, idx);
+        if (!_sysfs_readlong(path, &level))
+            break;
+
+        char type = 'U';
+        (void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%zu/type",
+            cpu->id, idx);
+        if (_sysfs_readstr(path, str, sizeof(str)))
+            type = ('D' == str[0] || 'I' == str[0]) ? str[0] : 'U';
+
+        (void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%zu/shared_cpu_list",
+            cpu->id, idx);
+        char list[1024];
+        int sharing  = 0;
+        int lowest   = cpu->id;
+        if (_sysfs_readstr(path, list, sizeof(list)) &&
+            (sharing = _parse_cpulist(list, scratch, SYSTEST_MAX_CPUS)) > 0) {
+            for (int n = 0; n < SYSTEST_MAX_CPUS; n++) {
+                if (scratch[n]) {
+                    lowest = n;
+                    break;
+                }
+            }
+        }
+        cpu->cache_ids[idx] = lowest;
+
+        /* sizes etc. come from the first CPU read, which is wrong for the
+         * other core type on hybrid parts; see systest_cputopo. */
+        if (idx < topo->ncaches)
             continue;
-        } else {
-            handle_error(errno, "");
-            resolved = false;
-            break;
+
+        systest_cache* c = &topo->caches[topo->ncaches++];
+        c->level = (unsigned)level;
+        c->type  = type;
+        c->shared_by = sharing > 0 ? (size_t)sharing : 1;
+
+        (void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%zu/size",
+            cpu->id, idx);
+        if (_sysfs_readstr(path, str, sizeof(str))) {
+            char* end = NULL;
+            uint64_t size = strtoull(str, &end, 10);
+            if ('K' == *end)
+                size *= 1024;
+            else if ('M' == *end)
+                size *= 1024 * 1024;
+            c->size = size;
         }
+
+        (void)snprintf(path, sizeof(path),
+            "/sys/devices/system/cpu/cpu%d/cache/index%zu/coherency_line_size", cpu->id, idx);
+        if (_sysfs_readlong(path, &line))
+            c->line_size = (unsigned)line;
+        (void)snprintf(path, sizeof(path),
+            "/sys/devices/system/cpu/cpu%d/cache/index%zu/ways_of_associativity", cpu->id, idx);
+        if (_sysfs_readlong(path, &ways))
+            c->ways = (unsigned)ways;
+    }
+}
+
+static bool _topo_read_sysfs(systest_cputopo* topo) {
+    bool* online  = calloc(SYSTEST_MAX_CPUS, sizeof(bool));
+    bool* scratch = calloc(SYSTEST_MAX_CPUS, sizeof(bool));
+    char list[1024], path[128];
+    bool ok = false;
+
+    if (!online || !scratch) {
+        handle_error(errno, "calloc() failed!");
+        goto cleanup;
+    }
+
+    if (!_sysfs_readstr("/sys/devices/system/cpu/online", list, sizeof(list)) ||
+        _parse_cpulist(list, online, SYSTEST_MAX_CPUS) < 1)
+        goto cleanup;
+
+    size_t count = 0;
+    for (size_t n = 0; n < SYSTEST_MAX_CPUS; n++)
+        count += online[n];
+
+    topo->cpus = calloc(count, sizeof(systest_cpu));
+    if (!topo->cpus) {
+        handle_error(errno, "calloc() failed!");
+        goto cleanup;
+    }
+
+# if defined(__HAVE_SCHED__) && !defined(__ANDROID__)
+    cpu_set_t affinity;
+    CPU_ZERO(&affinity);
+    bool have_affinity = (0 == sched_getaffinity(0, sizeof(cpu_set_t), &affinity));
+# endif
+
+    /* sysfs core_id is only unique within a package. */
+    long* core_ids = calloc(count, sizeof(long));
+    if (!core_ids) {
+        handle_error(errno, "calloc() failed!");
+        goto cleanup;
+    }
+
+    for (int id = 0; id < SYSTEST_MAX_CPUS; id++) {
+        if (!online[id])
+            continue;
+
+        systest_cpu* cpu = &topo->cpus[topo->ncpus];
+        long package = 0, core_id = id;
+        cpu->id   = id;
+        cpu->node = -1;
+        for (size_t c = 0; c < SYSTEST_MAX_CACHES; c++)
+            cpu->cache_ids[c] = -1;
+# if defined(__HAVE_SCHED__) && !defined(__ANDROID__)
+        cpu->allowed = !have_affinity || (id < CPU_SETSIZE && CPU_ISSET(id, &affinity));
 # else
-#  error "no implementation for your platform; please contact the author."
+        cpu->allowed = true;
 # endif
-#else // __WIN__
-        DWORD ret = GetModuleFileNameA(NULL, buffer, (DWORD)size);
-        if (0 != ret && ret < (DWORD)size) {
-            resolved = true;
-            break;
-        } else {
-            if (0 == ret) {
-                handle_error(GetLastError(), "GetModuleFileNameA() failed!");
-                resolved = false;
-                break;
-            } else if (ret == (DWORD)size || ERROR_INSUFFICIENT_BUFFER == GetLastError()) {
-                /* Windows has no concept of letting you know how much larger
-                * your buffer needed to be; it just truncates the string and
-                * returns size. So, we'll guess. */
-                size += SYSTEST_PATH_BUFFER_GROW_BY;
-                grow = true;
-                continue;
+
+        (void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", id);
+        (void)_sysfs_readlong(path, &package);
+        (void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", id);
+        (void)_sysfs_readlong(path, &core_id);
+        cpu->package = (int)package;
+
+        cpu->core = -1;
+        for (size_t n = 0; n < topo->ncpus; n++) {
+            if (topo->cpus[n].package == cpu->package && core_ids[topo->cpus[n].core] == core_id) {
+                cpu->core = topo->cpus[n].core;
+                cpu->smt++;
             }
         }
-#endif
+        if (-1 == cpu->core) {
+            cpu->core = (int)topo->cores;
+            core_ids[topo->cores++] = core_id;
+        }
 
-    } while (true);
+        bool new_package = true;
+        for (size_t n = 0; n < topo->ncpus; n++)
+            new_package &= (topo->cpus[n].package != cpu->package);
+        topo->packages += new_package;
 
-    if (!resolved) {
-        systest_safefree(&buffer);
-        self_log("failed to resolve filename!");
+        _topo_read_caches(topo, cpu, scratch);
+        topo->allowed += cpu->allowed;
+        topo->ncpus++;
+    }
+    topo->threads = topo->ncpus;
+    systest_safefree(&core_ids);
+
+    for (size_t c = 0; c < topo->ncaches; c++) {
+        /* an instance per distinct lowest-sharing-CPU. */
+        memset(scratch, 0, SYSTEST_MAX_CPUS * sizeof(bool));
+        for (size_t n = 0; n < topo->ncpus; n++) {
+            int cid = topo->cpus[n].cache_ids[c];
+            if (cid >= 0 && cid < SYSTEST_MAX_CPUS && !scratch[cid]) {
+                scratch[cid] = true;
+                topo->caches[c].instances++;
+            }
+        }
     }
 
-    return buffer;
-}
+    DIR* nodes = opendir("/sys/devices/system/node");
+    if (nodes) {
+        struct dirent* ent = NULL;
+        while (NULL != (ent = readdir(nodes))) {
+            int node = 0;
+            if (1 != sscanf(ent->d_name, "node%d", &node))
+                continue;
+            topo->nodes++;
 
-char* systest_getappbasename(void) {
-    char* filename = systest_getappfilename();
-    if (!_validstr(filename))
-        return NULL;
+            (void)snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+            if (!_sysfs_readstr(path, list, sizeof(list)) ||
+                _parse_cpulist(list, scratch, SYSTEST_MAX_CPUS) < 1)
+                continue;
+            for (size_t n = 0; n < topo->ncpus; n++) {
+                if (scratch[topo->cpus[n].id])
+                    topo->cpus[n].node = node;
+            }
+        }
+        (void)closedir(nodes);
+    }
 
-    char* retval = systest_getbasename(filename);
-    char* bname  = strdup(retval);
+    ok = true;
 
-    systest_safefree(&filename);
-    return bname;
+cleanup:
+    systest_safefree(&online);
+    systest_safefree(&scratch);
+    return ok;
 }
+#endif
 
-char* systest_getappdir(void) {
-    char* filename = systest_getappfilename();
-    if (!_validstr(filename))
-        return NULL;
+#if defined(__HAVE_CPUID__)
+/** Vendor and brand strings, and the cache descriptors (leaf 4 on Intel,
+ * 0x8000001d on AMD) if sysfs didn't provide any. */
+static void _topo_read_cpuid(systest_cputopo* topo) {
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx))
+        return;
 
-    char* retval = systest_getdirname(filename);
-    char* dname = strdup(retval);
+    unsigned max_leaf = eax;
+    memcpy(topo->vendor, &ebx, 4);
+    memcpy(topo->vendor + 4, &edx, 4);
+    memcpy(topo->vendor + 8, &ecx, 4);
+    topo->vendor[12] = '\0';
+
+    unsigned max_ext = __get_cpuid_max(0x80000000, NULL);
+    if (max_ext >= 0x80000004) {
+        unsigned regs[12];
+        for (unsigned leaf = 0; leaf < 3; leaf++)
+            __cpuid(0x80000002 + leaf, regs[leaf * 4], regs[leaf * 4 + 1], regs[leaf * 4 + 2],
+                regs[leaf * 4 + 3]);
+        memcpy(topo->brand, regs, sizeof(regs));
+        topo->brand[sizeof(regs)] = '\0';
+
+        /* it's often padded with spaces at the front. */
+        char* start = topo->brand;
+        while (' ' == *start)
+            start++;
+        memmove(topo->brand, start, strlen(start) + 1);
+    }
 
-    systest_safefree(&filename);
-    return dname;
+    if (topo->ncaches > 0)
+        return;
+
+    unsigned leaf = 0;
+    if (0 == strcmp(topo->vendor, "GenuineIntel") && max_leaf >= 4)
+        leaf = 4;
+    else if (0 == strcmp(topo->vendor, "AuthenticAMD") && max_ext >= 0x8000001d)
+        leaf = 0x8000001d;
+    if (0 == leaf)
+        return;
+
+    for (unsigned sub = 0; topo->ncaches < SYSTEST_MAX_CACHES; sub++) {
+        __cpuid_count(leaf, sub, eax, ebx, ecx, edx);
+        unsigned type = eax & 0x1f;
+        if (0 == type)
+            break;
+
+        systest_cache* c = &topo->caches[topo->ncaches++];
+        c->level     = (eax >> 5) & 0x7;
+        c->type      = (1 == type) ? 'D' : (2 == type) ? 'I' : 'U';
+        c->line_size = (ebx & 0xfff) + 1;
+        c->ways      = ((ebx >> 22) & 0x3ff) + 1;
+        c->size      = (uint64_t)c->ways * (((ebx >> 12) & 0x3ff) + 1) * c->line_size * (ecx + 1ULL);
+        c->shared_by = ((eax >> 14) & 0xfff) + 1;
+        if (topo->threads > 0 && c->shared_by > topo->threads)
+            c->shared_by = topo->threads;
+        c->instances = topo->threads > 0 ? (topo->threads + c->shared_by - 1) / c->shared_by : 0;
+    }
 }
+#endif
 
-char* systest_getbasename(char* restrict path) {
-    if (!_validstr(path))
-        return ".";
+bool systest_getcputopology(systest_cputopo* topo) {
+    if (!_validptr(topo))
+        return false;
 
-#if !defined(__WIN__)
-    return basename(path);
-#else
-    return PathFindFileNameA(path);
+    memset(topo, 0, sizeof(systest_cputopo));
+
+#if defined(__linux__)
+    if (!_topo_read_sysfs(topo)) {
+        systest_freecputopology(topo);
+        memset(topo, 0, sizeof(systest_cputopo));
+    }
 #endif
-}
 
-char* systest_getdirname(char* restrict path) {
-    if (!_validstr(path))
-        return ".";
+    if (0 == topo->threads) {
+        int cpus = 0;
+        if (systest_getcpucount(&cpus) && cpus > 0)
+            topo->threads = topo->allowed = (size_t)cpus;
+    }
 
-#if !defined(__WIN__)
-    return dirname(path);
-#else
-    if (!PathRemoveFileSpecA((LPSTR)path))
-        handle_error(GetLastError(), "PathRemoveFileSpecA() failed!");
-    return path;
+#if defined(__HAVE_CPUID__)
+    _topo_read_cpuid(topo);
 #endif
+
+    return topo->threads > 0;
 }
 
-bool systest_ispathrelative(const char* restrict path, bool* restrict relative) {
-    if (!_validstr(path) || !_validptr(relative))
+void systest_freecputopology(systest_cputopo* topo) {
+    if (!topo)
+        return;
+    systest_safefree(&topo->cpus);
+    topo->ncpus = 0;
+}
+
+#if defined(__linux__)
+/** Splits a /proc/self/cgroup line, "hierarchy-id:controller,list:/path", in
+ * place. v2 is set for the unified hierarchy: id 0 with no controllers. */
+static bool _cgroup_parseline(char* line, const char** ctrls, const char** path, bool* v2) {
+    char* c = strchr(line, ':');
+    char* p = c ? strchr(c + 1, ':') : NULL;
+    if (!p)
         return false;
+    *c++ = '\0';
+    *p++ = '\0';
+    p[strcspn(p, "\n")] = '\0';
 
-#if !defined(__WIN__)
-    if (path[0] == '/' || (path[0] == '~' && path[1] == '/'))
-        *relative = false;
-    else
-        *relative = true;
-    return true;
-#else
-    *relative = (TRUE == PathIsRelativeA(path));
+    *ctrls = c;
+    *path  = p;
+    *v2    = '\0' == *c && 0 == strcmp(line, "0");
     return true;
-#endif
 }
 
-char* systest_stattostring(struct stat* restrict st) {
-    if (!_validptr(st))
-        return NULL;
+/** Finds the directory of this process's cgroup for the given controller,
+ * preferring v2 if the controller is enabled there. mount_len receives the
+ * length of the mount point prefix, above which there's nothing to read. */
+static bool _cgroup_dir(const char* controller, char* dir, size_t size, size_t* mount_len,
+    int* version) {
+    char v1_path[SYSTEST_MAXPATH] = {0}, v2_path[SYSTEST_MAXPATH] = {0};
+    bool have_v1 = false, have_v2 = false;
+    char* line = NULL;
+    size_t line_size = 0;
+
+    FILE* f = fopen("/proc/self/cgroup", "r");
+    if (!f)
+        return false;
+    while (-1 != getline(&line, &line_size, f)) {
+        const char *ctrls, *path;
+        bool v2;
+        if (!_cgroup_parseline(line, &ctrls, &path, &v2))
+            continue;
 
-    char* buffer = (char*)calloc(SYSTEST_STAT_BUFFER_SIZE, sizeof(char));
-    if (!buffer) {
-        handle_error(errno, "calloc() failed!");
-        return NULL;
+        if (v2) {
+            (void)snprintf(v2_path, sizeof(v2_path), "%s", path);
+            have_v2 = true;
+        } else if (list_contains(ctrls, controller)) {
+            (void)snprintf(v1_path, sizeof(v1_path), "%s", path);
+            have_v1 = true;
+        }
     }
+    (void)fclose(f);
 
-#if defined(__WIN__)
-# define S_IFBLK 0x0001
-# define S_IFLNK 0x0002
-# define S_IFSOCK 0x0003
-# define S_IFIFO _S_IFIFO
-# define S_IRUSR 0x0100
-# define S_IWUSR 0x0080
-# define S_IXUSR 0x0040
-# define S_IRGRP 0x0010
-# define S_IWGRP 0x0400
-# define S_IXGRP 0x0004
-# define S_IROTH 0x0020
-# define S_IWOTH 0x0800
-# define S_IXOTH 0x0008
-#endif
+    char v1_mount[SYSTEST_MAXPATH] = {0}, v2_mount[SYSTEST_MAXPATH] = {0};
+    char v1_root[SYSTEST_MAXPATH] = {0}, v2_root[SYSTEST_MAXPATH] = {0};
+    f = fopen("/proc/self/mountinfo", "r");
+    if (!f) {
+        systest_safefree(&line);
+        return false;
+    }
+    while (-1 != getline(&line, &line_size, f)) {
+        char root[SYSTEST_MAXPATH], mnt[SYSTEST_MAXPATH];
+        char* sep = strstr(line, " - ");
+        if (!sep || 2 != sscanf(line, "%*s %*s %*s %4095s %4095s", root, mnt))
+            continue;
 
-    char* type = "";
-    switch (st->st_mode & S_IFMT) {
-        case S_IFBLK:  type = "block device"; break;
-        case S_IFCHR:  type = "character special"; break;
-        case S_IFDIR:  type = "directory"; break;
-        case S_IFIFO:  type = "pipe (fifo)"; break;
-        case S_IFLNK:  type = "symlink"; break;
-        case S_IFREG:  type = "regular"; break;
-        case S_IFSOCK: type = "socket"; break;
-        default:       type = "<unknown>"; break;
+        char fstype[32], super[512];
+        if (2 != sscanf(sep + 3, "%31s %*s %511s", fstype, super))
+            continue;
+
+        if (0 == strcmp(fstype, "cgroup2") && '\0' == v2_mount[0]) {
+            (void)snprintf(v2_mount, sizeof(v2_mount), "%s", mnt);
+            (void)snprintf(v2_root, sizeof(v2_root), "%s", root);
+        } else if (0 == strcmp(fstype, "cgroup") && list_contains(super, controller) &&
+            '\0' == v1_mount[0]) {
+            (void)snprintf(v1_mount, sizeof(v1_mount), "%s", mnt);
+            (void)snprintf(v1_root, sizeof(v1_root), "%s", root);
+        }
     }
+    (void)fclose(f);
+    systest_safefree(&line);
+
+    /* the mount shows the hierarchy from its root down, which in a cgroup
+     * namespace is where this process's path starts anyway. */
+    for (int v = 2; v >= 1; v--) {
+        const char* mnt  = (2 == v) ? v2_mount : v1_mount;
+        const char* root = (2 == v) ? v2_root : v1_root;
+        const char* path = (2 == v) ? v2_path : v1_path;
+        if ('\0' == mnt[0] || !((2 == v) ? have_v2 : have_v1))
+            continue;
 
-    char mode[32] = {0};
-    snprintf(mode, sizeof(mode), "%c%c%c%c%c%c%c%c%c%c (%03o)",
-        (systest_bittest(st->st_mode & S_IFMT, S_IFDIR) ? 'd' :
-        (systest_bittest(st->st_mode & S_IFMT, S_IFSOCK) ? 's' : '-')),
-        (systest_bittest(st->st_mode & 0x0FFF, S_IRUSR) ? 'r' : '-'),
-        (systest_bittest(st->st_mode & 0x0FFF, S_IWUSR) ? 'w' : '-'),
-        (systest_bittest(st->st_mode & 0x0FFF, S_IXUSR) ? 'x' : '-'),
-        (systest_bittest(st->st_mode & 0x0FFF, S_IRGRP) ? 'r' : '-'),
-        (systest_bittest(st->st_mode & 0x0FFF, S_IWGRP) ? 'w' : '-'),
-        (systest_bittest(st->st_mode & 0x0FFF, S_IXGRP) ? 'x' : '-'),
-        (systest_bittest(st->st_mode & 0x0FFF, S_IROTH) ? 'r' : '-'),
-        (systest_bittest(st->st_mode & 0x0FFF, S_IWOTH) ? 'w' : '-'),
-        (systest_bittest(st->st_mode & 0x0FFF, S_IXOTH) ? 'x' : '-'),
-        ((st->st_mode & 0x0FFF) & ((S_IRUSR | S_IWUSR | S_IXUSR) |
-            (S_IRGRP | S_IWGRP | S_IXGRP) |
-            (S_IROTH | S_IWOTH | S_IXOTH))));
+        size_t root_len = strlen(root);
+        if (0 == strncmp(path, root, root_len) && 1 < root_len)
+            path += root_len;
 
-    snprintf(buffer, SYSTEST_STAT_BUFFER_SIZE, "{ type: %s, size: %ld, "
-        "mode: %s }", type, (long)st->st_size, mode);
+        int len = snprintf(dir, size, "%s%s", mnt, 0 == strcmp(path, "/") ? "" : path);
+        if (len < 0 || (size_t)len >= size)
+            continue;
 
-    return buffer;
-}
+        if (2 == v) {
+            /* enabled for this cgroup by its parent, or (at the top) available. */
+            char ctrl_path[SYSTEST_MAXPATH + 32], ctrls[256];
+            (void)snprintf(ctrl_path, sizeof(ctrl_path), "%s/cgroup.controllers", dir);
+            if (!_sysfs_readstr(ctrl_path, ctrls, sizeof(ctrls)))
+                continue;
+            for (char* c = ctrls; *c; c++) {
+                if (' ' == *c)
+                    *c = ',';
+            }
+            if (!list_contains(ctrls, controller))
+                continue;
+        }
 
-bool systest_add_slash(char* restrict path) {
-    if (!_validstr(path))
-        return false;
+        *mount_len = strlen(mnt);
+        *version   = v;
+        return true;
+    }
 
-    size_t path_len = strnlen(path, SYSTEST_MAXPATH);
+    return false;
+}
 
-    if (path_len > SYSTEST_MAXPATH - 2)
+/** Reads a limit; "max" and v1's page-rounded LONG_MAX both mean none. */
+static bool _cgroup_readlimit(const char* dir, const char* file, uint64_t* value) {
+    char path[SYSTEST_MAXPATH + 64], str[64];
+    (void)snprintf(path, sizeof(path), "%s/%s", dir, file);
+    if (!_sysfs_readstr(path, str, sizeof(str)))
         return false;
 
-    if (path[path_len - 1] != '/' && path[path_len - 1] != '\\') {
-        path[path_len] = SYSTEST_PATH_SEP;
-        path[path_len + 1] = '\0';
+    if (0 == strncmp(str, "max", 3)) {
+        *value = UINT64_MAX;
+        return true;
     }
 
+    char* end = NULL;
+    errno = 0;
+    unsigned long long parsed = strtoull(str, &end, 10);
+    if (0 != errno || end == str)
+        return false;
+    *value = parsed >= (1ULL << 62) ? UINT64_MAX : (uint64_t)parsed;
     return true;
 }
 
-#define GIB_FROM_BYTES(bytes) ((bytes) / 1024 / 1024 / 1024)
+/** Strips the last component from dir; false once at the mount point. */
+static bool _cgroup_parent(char* dir, size_t mount_len) {
+    char* slash = strrchr(dir, '/');
+    if (!slash || (size_t)(slash - dir) < mount_len)
+        return false;
+    *slash = '\0';
+    return true;
+}
+#endif
 
-bool systest_getfreediskspace(uint64_t* bytes) {
-    if (bytes == NULL) {
+bool systest_getcgrouplimits(systest_cgroup_limits* limits) {
+    if (!_validptr(limits))
         return false;
-    }
+
+    memset(limits, 0, sizeof(systest_cgroup_limits));
+    limits->memory_max      = UINT64_MAX;
+    limits->memory_high     = UINT64_MAX;
+    limits->physical_memory = UINT64_MAX;
+
 #if !defined(__WIN__)
-    char *cwd = systest_getcwd();
-    self_log("using path '%s' for statvfs", cwd);
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    limits->online_cpus = online > 0 ? (size_t)online : 1;
+# if defined(_SC_PHYS_PAGES)
+    long pages = sysconf(_SC_PHYS_PAGES), page_size = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0)
+        limits->physical_memory = (uint64_t)pages * (uint64_t)page_size;
+# endif
+#else
+    int cpus = 0;
+    limits->online_cpus = (systest_getcpucount(&cpus) && cpus > 0) ? (size_t)cpus : 1;
+    MEMORYSTATUSEX mem = {.dwLength = sizeof(MEMORYSTATUSEX)};
+    if (GlobalMemoryStatusEx(&mem))
+        limits->physical_memory = mem.ullTotalPhys;
+#endif
 
-    struct statvfs stvfs = {0};
-    if (-1 == statvfs(cwd, &stvfs)) {
-        handle_error(errno, "statvfs");
-        free(cwd);
-        return false;
+#if defined(__HAVE_SCHED__) && !defined(__ANDROID__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (0 == sched_getaffinity(0, sizeof(cpu_set_t), &set))
+        limits->affinity_cpus = (size_t)CPU_COUNT(&set);
+#endif
+
+#if defined(__linux__)
+    char dir[SYSTEST_MAXPATH];
+    size_t mount_len = 0;
+    int version = 0;
+
+    /* a quota anywhere up the tree applies; the tightest one wins. */
+    if (_cgroup_dir("cpu", dir, sizeof(dir), &mount_len, &version)) {
+        do {
+            double quota = 0.0;
+            char path[SYSTEST_MAXPATH + 64], str[64];
+            if (2 == version) {
+                (void)snprintf(path, sizeof(path), "%s/cpu.max", dir);
+                unsigned long long q = 0, period = 0;
+                if (_sysfs_readstr(path, str, sizeof(str)) &&
+                    2 == sscanf(str, "%llu %llu", &q, &period) && period > 0)
+                    quota = (double)q / (double)period;
+            } else {
+                uint64_t q = 0, period = 0;
+                (void)snprintf(path, sizeof(path), "%s/cpu.cfs_quota_us", dir);
+                long signed_q = -1;
+                if (_sysfs_readlong(path, &signed_q) && signed_q > 0 &&
+                    _cgroup_readlimit(dir, "cpu.cfs_period_us", &period) && period > 0) {
+                    q     = (uint64_t)signed_q;
+                    quota = (double)q / (double)period;
+                }
+            }
+            if (quota > 0.0 && (0.0 == limits->cpu_quota || quota < limits->cpu_quota))
+                limits->cpu_quota = quota;
+        } while (_cgroup_parent(dir, mount_len));
+        limits->version = version > limits->version ? version : limits->version;
     }
-    free(cwd);
 
-    *bytes = (uint64_t)(stvfs.f_bavail * (stvfs.f_frsize ? stvfs.f_frsize : stvfs.f_bsize));
-    printf("free disk space: %"PRIu64" GiB\n", GIB_FROM_BYTES(*bytes));
-    return true;
-#else
-    ULARGE_INTEGER free_bytes = {0};
-    if (!GetDiskFreeSpaceExA(NULL, &free_bytes, NULL, NULL)) {
-        handle_error(GetLastError(), "GetDiskFreeSpaceEx");
-        return false;
+    if (_cgroup_dir("cpuset", dir, sizeof(dir), &mount_len, &version)) {
+        char path[SYSTEST_MAXPATH + 64], list[1024];
+        (void)snprintf(path, sizeof(path), "%s/%s", dir,
+            2 == version ? "cpuset.cpus.effective" : "cpuset.effective_cpus");
+        bool* set_cpus = calloc(SYSTEST_MAX_CPUS, sizeof(bool));
+        if (set_cpus && _sysfs_readstr(path, list, sizeof(list))) {
+            int count = _parse_cpulist(list, set_cpus, SYSTEST_MAX_CPUS);
+            if (count > 0)
+                limits->cpuset_cpus = (size_t)count;
+        }
+        systest_safefree(&set_cpus);
+        limits->version = version > limits->version ? version : limits->version;
     }
-    printf("free disk space: %"PRIu64" GiB\n", GIB_FROM_BYTES(free_bytes.QuadPart));
-    *bytes = free_bytes.QuadPart;
+
+    if (_cgroup_dir("memory", dir, sizeof(dir), &mount_len, &version)) {
+        const char* max_file  = 2 == version ? "memory.max" : "memory.limit_in_bytes";
+        const char* high_file = 2 == version ? "memory.high" : "memory.soft_limit_in_bytes";
+        (void)_cgroup_readlimit(dir, 2 == version ? "memory.current" : "memory.usage_in_bytes",
+            &limits->memory_current);
+        do {
+            uint64_t value = UINT64_MAX;
+            if (_cgroup_readlimit(dir, max_file, &value) && value < limits->memory_max)
+                limits->memory_max = value;
+            value = UINT64_MAX;
+            if (_cgroup_readlimit(dir, high_file, &value) && value < limits->memory_high)
+                limits->memory_high = value;
+        } while (_cgroup_parent(dir, mount_len));
+        limits->version = version > limits->version ? version : limits->version;
+    }
+#endif
+
+    limits->effective_cpus = (double)limits->online_cpus;
+    if (limits->affinity_cpus > 0 && (double)limits->affinity_cpus < limits->effective_cpus)
+        limits->effective_cpus = (double)limits->affinity_cpus;
+    if (limits->cpuset_cpus > 0 && (double)limits->cpuset_cpus < limits->effective_cpus)
+        limits->effective_cpus = (double)limits->cpuset_cpus;
+    if (limits->cpu_quota > 0.0 && limits->cpu_quota < limits->effective_cpus)
+        limits->effective_cpus = limits->cpu_quota;
+
+    limits->memory_budget = limits->physical_memory;
+    if (limits->memory_max < limits->memory_budget)
+        limits->memory_budget = limits->memory_max;
+    if (limits->memory_high < limits->memory_budget)
+        limits->memory_budget = limits->memory_high;
+
     return true;
+}
+
+uint64_t systest_getcpufeatures(void) {
+    uint64_t features = 0;
+#if defined(__HAVE_CPUID__)
+# define _setfeature(cond, f) do { if (cond) features |= (1ULL << (f)); } while (false)
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+
+    _setfeature(ecx & (1U << 20), SYSTEST_CPU_SSE42);
+    _setfeature(ecx & (1U << 23), SYSTEST_CPU_POPCNT);
+    _setfeature(ecx & (1U << 1), SYSTEST_CPU_PCLMULQDQ);
+
+    /* the CPU having AVX doesn't help unless the OS saves the registers. */
+    uint64_t xcr0 = 0;
+    if (ecx & (1U << 27)) {
+        unsigned lo = 0, hi = 0;
+        __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        xcr0 = ((uint64_t)hi << 32) | lo;
+    }
+    bool ymm = (0x6 == (xcr0 & 0x6));
+    bool zmm = ymm && (0xe0 == (xcr0 & 0xe0));
+
+    _setfeature(ymm && (ecx & (1U << 28)), SYSTEST_CPU_AVX);
+    _setfeature(ymm && (ecx & (1U << 12)), SYSTEST_CPU_FMA);
+
+    if (__get_cpuid_max(0, NULL) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        _setfeature(ymm && (ebx & (1U << 5)), SYSTEST_CPU_AVX2);
+        _setfeature(ebx & (1U << 3), SYSTEST_CPU_BMI1);
+        _setfeature(ebx & (1U << 8), SYSTEST_CPU_BMI2);
+        _setfeature(ebx & (1U << 29), SYSTEST_CPU_SHA);
+        _setfeature(zmm && (ebx & (1U << 16)), SYSTEST_CPU_AVX512F);
+        _setfeature(zmm && (ebx & (1U << 17)), SYSTEST_CPU_AVX512DQ);
+        _setfeature(zmm && (ebx & (1U << 30)), SYSTEST_CPU_AVX512BW);
+        _setfeature(zmm && (ebx & (1U << 31)), SYSTEST_CPU_AVX512VL);
+        _setfeature(zmm && (ecx & (1U << 11)), SYSTEST_CPU_AVX512VNNI);
+        _setfeature(ymm && (ecx & (1U << 10)), SYSTEST_CPU_VPCLMULQDQ);
+    }
+# undef _setfeature
+#elif defined(__HAVE_HWCAP__)
+    unsigned long hwcap  = getauxval(AT_HWCAP);
+    unsigned long hwcap2 = getauxval(AT_HWCAP2);
+    if (hwcap & (1UL << 1))  /* HWCAP_ASIMD */
+        features |= (1ULL << SYSTEST_CPU_NEON);
+    if (hwcap & (1UL << 6))  /* HWCAP_SHA2 */
+        features |= (1ULL << SYSTEST_CPU_SHA);
+    if (hwcap & (1UL << 7))  /* HWCAP_CRC32 */
+        features |= (1ULL << SYSTEST_CPU_CRC32);
+    if (hwcap & (1UL << 22)) /* HWCAP_SVE */
+        features |= (1ULL << SYSTEST_CPU_SVE);
+    if (hwcap2 & (1UL << 1)) /* HWCAP2_SVE2 */
+        features |= (1ULL << SYSTEST_CPU_SVE2);
 #endif
+    return features;
 }
 
-bool systest_gethostname(char hname[SYSTEST_MAXHOST]) {
-    hname[0] = '\0';
-#if !defined(__WIN__)
-    if (-1 == gethostname(hname, SYSTEST_MAXHOST - 1)) {
-        handle_error(errno, "gethostname() failed!");
+const char* systest_cpufeaturename(systest_cpu_feature feature) {
+    static const char* const names[SYSTEST_CPU_FEATURE_COUNT] = {
+        "sse4.2", "popcnt", "pclmulqdq", "avx", "avx2", "fma", "bmi1", "bmi2", "sha",
+        "avx512f", "avx512dq", "avx512bw", "avx512vl", "avx512vnni", "vpclmulqdq",
+        "neon", "crc32", "sve", "sve2"
+    };
+    return (feature >= 0 && feature < SYSTEST_CPU_FEATURE_COUNT) ? names[feature] : NULL;
+}
+
+#if defined(__linux__)
+/** Reads a sysfs file of words with the selected one in brackets, as in
+ * "always [madvise] never", and keeps the selected word. */
+static bool _sysfs_readchoice(const char* path, char* buf, size_t size) {
+    char line[256];
+    if (!_sysfs_readstr(path, line, sizeof(line)))
         return false;
-    }
-#else
-    WSADATA wsad = {0};
-    int ret = WSAStartup(MAKEWORD(2, 2), &wsad);
-    if (0 != ret) {
-        handle_error(ret, "WSAStartup() failed!");
+    const char* open_bracket = strchr(line, '[');
+    const char* close_bracket = open_bracket ? strchr(open_bracket, ']') : NULL;
+    if (!close_bracket)
+        return false;
+    size_t len = (size_t)(close_bracket - open_bracket - 1);
+    if (len >= size)
         return false;
-    }
+    memcpy(buf, open_bracket + 1, len);
+    buf[len] = '\0';
+    return true;
+}
 
-    if (SOCKET_ERROR == gethostname(hname, SYSTEST_MAXHOST)) {
-        handle_error(WSAGetLastError(), "gethostname() failed!");
-        WSACleanup();
+bool systest_gethugepages(systest_hugepages* info) {
+    if (!_validptr(info)) {
+        errno = EINVAL;
         return false;
     }
 
-    WSACleanup();
-#endif // !__WIN__
-    return true;
-}
+    memset(info, 0, sizeof(systest_hugepages));
+    bool thp = _sysfs_readchoice("/sys/kernel/mm/transparent_hugepage/enabled",
+        info->thp_enabled, sizeof(info->thp_enabled));
+    if (thp) {
+        long value = 0;
+        (void)_sysfs_readchoice("/sys/kernel/mm/transparent_hugepage/defrag",
+            info->thp_defrag, sizeof(info->thp_defrag));
+        (void)_sysfs_readchoice("/sys/kernel/mm/transparent_hugepage/shmem_enabled",
+            info->thp_shmem, sizeof(info->thp_shmem));
+        if (_sysfs_readlong("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", &value) && value > 0)
+            info->thp_size = (uint64_t)value;
+    }
 
-bool systest_getuname(struct utsname* name) {
-    if (!_validptr(name))
-        return false;
+    FILE* meminfo = fopen("/proc/meminfo", "r");
+    if (meminfo) {
+        char line[128];
+        unsigned long long kb = 0;
+        while (fgets(line, sizeof(line), meminfo)) {
+            if (1 == sscanf(line, "AnonHugePages: %llu kB", &kb))
+                info->anon_huge_bytes = (uint64_t)kb * 1024;
+            else if (1 == sscanf(line, "Hugepagesize: %llu kB", &kb))
+                info->default_size = (uint64_t)kb * 1024;
+        }
+        (void)fclose(meminfo);
+    }
 
-    memset(name, 0, sizeof(struct utsname));
+    DIR* dir = opendir("/sys/kernel/mm/hugepages");
+    if (dir) {
+        struct dirent* entry;
+        while (NULL != (entry = readdir(dir)) && info->npools < SYSTEST_MAX_HUGEPAGE_SIZES) {
+            unsigned long long kb = 0;
+            if (1 != sscanf(entry->d_name, "hugepages-%llukB", &kb) || 0 == kb)
+                continue;
 
-#if !defined(__WIN__)
-    if (-1 == uname(name)) {
-        handle_error(errno, "uname() failed!");
-        return false;
+            systest_hugepage_pool* pool = &info->pools[info->npools++];
+            pool->size = (uint64_t)kb * 1024;
+
+            const struct { const char* name; long* value; } files[] = {
+                {"nr_hugepages", &pool->total}, {"free_hugepages", &pool->free},
+                {"resv_hugepages", &pool->reserved}, {"surplus_hugepages", &pool->surplus},
+                {"nr_overcommit_hugepages", &pool->overcommit}
+            };
+            for (size_t n = 0; n < __countof(files); n++) {
+                char path[PATH_MAX];
+                int len = snprintf(path, sizeof(path), "/sys/kernel/mm/hugepages/%s/%s",
+                    entry->d_name, files[n].name);
+                if (len > 0 && (size_t)len < sizeof(path))
+                    (void)_sysfs_readlong(path, files[n].value);
+            }
+        }
+        (void)closedir(dir);
+
+        /* readdir() order is arbitrary. */
+        for (size_t n = 1; n < info->npools; n++) {
+            for (size_t j = n; j > 0 && info->pools[j - 1].size > info->pools[j].size; j--) {
+                systest_hugepage_pool tmp = info->pools[j];
+                info->pools[j] = info->pools[j - 1];
+                info->pools[j - 1] = tmp;
+            }
+        }
     }
-#else
-    static const char* sys_name = "Windows";
-    static const char* kernel_dll = "kernel32.dll";
 
-    strncpy(name->sysname, sys_name, strnlen(sys_name, _SYS_NAMELEN));
+    return thp || info->npools > 0;
+}
 
-    char tmp[SYSTEST_MAXHOST];
-    if (!systest_gethostname(tmp))
+bool systest_getnumanodes(systest_numa_node** nodes, size_t* count) {
+    if (!_validptr(nodes) || !_validptr(count)) {
+        errno = EINVAL;
         return false;
+    }
 
-    strncpy(name->nodename, tmp, strnlen(tmp, _SYS_NAMELEN));
+    *nodes = NULL;
+    *count = 0;
 
-    char path[SYSTEST_MAXPATH];
-    if (0 == GetSystemDirectoryA(path, SYSTEST_MAXPATH)) {
-        handle_error(GetLastError(), "GetSystemDirectoryA failed!");
+    char list[512];
+    bool online[SYSTEST_MAX_NODES];
+    int found = -1;
+    if (_sysfs_readstr("/sys/devices/system/node/online", list, sizeof(list)))
+        found = _parse_cpulist(list, online, SYSTEST_MAX_NODES);
+
+    systest_numa_node* result = calloc(found > 0 ? (size_t)found : 1, sizeof(systest_numa_node));
+    if (!result) {
+        errno = ENOMEM;
         return false;
     }
 
-    if (!PathAppendA(path, kernel_dll)) {
-        handle_error(GetLastError(), "PathAppendA failed!");
-        return false;
+    if (found <= 0) {
+        /* no NUMA support: everything is on the one node. */
+        int cpus = 1;
+        long pages = sysconf(_SC_PHYS_PAGES), avail = sysconf(_SC_AVPHYS_PAGES);
+        long page_size = sysconf(_SC_PAGESIZE);
+        (void)systest_getcpucount(&cpus);
+        result->cpus = (size_t)cpus;
+        result->mem_total = (pages > 0 && page_size > 0) ? (uint64_t)pages * (uint64_t)page_size : 0;
+        result->mem_free = (avail > 0 && page_size > 0) ? (uint64_t)avail * (uint64_t)page_size : 0;
+        result->distance[0] = 10;
+        *nodes = result;
+        *count = 1;
+        return true;
     }
 
-    self_log("kernel dll is at: %s; extracting version...", path);
+    for (int id = 0; id < SYSTEST_MAX_NODES; id++) {
+        if (!online[id])
+            continue;
 
-    DWORD vsize = GetFileVersionInfoSizeA(path, NULL);
-    if (0 == vsize) {
-        handle_error(GetLastError(), "GetFileVersionInfoSizeA failed!");
-        return false;
-    }
+        systest_numa_node* node = &result[(*count)++];
+        node->id = id;
 
-    VS_FIXEDFILEINFO* fvi = calloc(1, vsize);
-    if (!fvi) {
-        handle_error(errno, "calloc failed!");
-        return false;
+        char path[PATH_MAX];
+        bool cpus[SYSTEST_MAX_CPUS];
+        (void)snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+        if (_sysfs_readstr(path, list, sizeof(list))) {
+            int ncpus = _parse_cpulist(list, cpus, SYSTEST_MAX_CPUS);
+            node->cpus = ncpus > 0 ? (size_t)ncpus : 0;
+        }
+
+        (void)snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/meminfo", id);
+        FILE* meminfo = fopen(path, "r");
+        if (meminfo) {
+            char line[128];
+            unsigned long long kb = 0;
+            while (fgets(line, sizeof(line), meminfo)) {
+                int which = 0;
+                if (2 == sscanf(line, "Node %d MemTotal: %llu kB", &which, &kb))
+                    node->mem_total = (uint64_t)kb * 1024;
+                else if (2 == sscanf(line, "Node %d MemFree: %llu kB", &which, &kb))
+                    node->mem_free = (uint64_t)kb * 1024;
+            }
+            (void)fclose(meminfo);
+        }
+
+        /* one entry per online node, in the same order as ours. */
+        (void)snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/distance", id);
+        if (_sysfs_readstr(path, list, sizeof(list))) {
+            char* cur = list;
+            for (int n = 0; n < found; n++) {
+                char* end = NULL;
+                long distance = strtol(cur, &end, 10);
+                if (end == cur)
+                    break;
+                node->distance[n] = (int)distance;
+                cur = end;
+            }
+        }
     }
 
-    if (!GetFileVersionInfoA(path, 0, vsize, fvi)) {
-        handle_error(GetLastError(), "GetFileVersionInfoA failed!");
-        systest_safefree(fvi);
+    *nodes = result;
+    return true;
+}
+#endif
+
+
+#if defined(__HAVE_IO_URING__)
+bool systest_uring_init(systest_uring* ring, unsigned entries) {
+    if (!_validptr(ring) || 0 == entries) {
+        errno = EINVAL;
         return false;
     }
 
-    UINT blk_size = 0;
-    VS_FIXEDFILEINFO* blk = NULL;
-    if (!VerQueryValueA(fvi, "\\", &blk, &blk_size) || blk_size < sizeof(VS_FIXEDFILEINFO)) {
-        handle_error(GetLastError(), "VerQueryValueA failed!");
-        systest_safefree(fvi);
+    memset(ring, 0, sizeof(systest_uring));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &ring->params);
+    if (-1 == ring->fd)
         return false;
-    }
 
-    WORD verMajor = HIWORD(blk->dwProductVersionMS);
-    const WORD verMinor = LOWORD(blk->dwProductVersionMS);
-    const WORD verBuild = HIWORD(blk->dwProductVersionLS);
+    struct io_uring_params* p = &ring->params;
+    ring->sq_ring_size = p->sq_off.array + (p->sq_entries * sizeof(unsigned));
+    ring->cq_ring_size = p->cq_off.cqes + (p->cq_entries * sizeof(struct io_uring_cqe));
 
-    static const WORD build_win11_threshold = 22000;
-    if (verBuild >= build_win11_threshold) {
-        verMajor = 11;
+    bool single_mmap = systest_bittest(p->features, IORING_FEAT_SINGLE_MMAP);
+    if (single_mmap) {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+            ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
     }
 
-    systest_safefree(fvi);
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == ring->sq_ring) {
+        ring->sq_ring = NULL;
+        goto fail;
+    }
 
-    int prn = sprintf(name->release, "%hu.%hu.%hu", verMajor, verMinor, verBuild);
-    assert(prn > 0);
+    if (single_mmap) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == ring->cq_ring) {
+            ring->cq_ring = NULL;
+            goto fail;
+        }
+    }
 
-    SYSTEM_INFO si = {0};
-    GetNativeSystemInfo(&si);
+    ring->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (MAP_FAILED == ring->sqes) {
+        ring->sqes = NULL;
+        goto fail;
+    }
 
-    const char* mach_hw_str = "";
-    switch (si.wProcessorArchitecture) {
-        case PROCESSOR_ARCHITECTURE_INTEL: mach_hw_str = "x86"; break;
-        case PROCESSOR_ARCHITECTURE_IA64: mach_hw_str = "IA64"; break;
-        case PROCESSOR_ARCHITECTURE_ARM64: mach_hw_str = "aarch64"; break;
-        case PROCESSOR_ARCHITECTURE_ARM: mach_hw_str = "armhf"; break;
-        case PROCESSOR_ARCHITECTURE_AMD64: mach_hw_str = "x86_64"; break;
-        case PROCESSOR_ARCHITECTURE_UNKNOWN:
-        default:
-            mach_hw_str = "<unknown>";
-            break;
+    char* sq = (char*)ring->sq_ring;
+    char* cq = (char*)ring->cq_ring;
+    ring->sq_head  = (unsigned*)(sq + p->sq_off.head);
+    ring->sq_tail  = (unsigned*)(sq + p->sq_off.tail);
+    ring->sq_mask  = (unsigned*)(sq + p->sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + p->sq_off.array);
+    ring->cq_head  = (unsigned*)(cq + p->cq_off.head);
+    ring->cq_tail  = (unsigned*)(cq + p->cq_off.tail);
+    ring->cq_mask  = (unsigned*)(cq + p->cq_off.ring_mask);
+    ring->cqes     = (struct io_uring_cqe*)(cq + p->cq_off.cqes);
+    return true;
+
+fail: {
+        int err = errno;
+        systest_uring_free(ring);
+        errno = err;
+        return false;
     }
+}
 
-    prn = snprintf(name->version, _SYS_NAMELEN, "%s %hu.%hu.%hu-%s", sys_name, verMajor,
-        verMinor, verBuild, mach_hw_str);
-    assert(prn > 0);
+void systest_uring_free(systest_uring* ring) {
+    if (!_validptr(ring))
+        return;
 
-    strncpy(name->machine, mach_hw_str, strnlen(mach_hw_str, _SYS_NAMELEN));
+    if (ring->sqes)
+        (void)munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+        (void)munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring)
+        (void)munmap(ring->sq_ring, ring->sq_ring_size);
 
-#endif // !__WIN__
-    return true;
+    int fd = ring->fd;
+    memset(ring, 0, sizeof(systest_uring));
+    if (fd > 0)
+        systest_safeclose(&fd);
+    ring->fd = -1;
 }
 
-bool systest_getcpucount(int* ncpus) {
-    if (!ncpus)
-        return false;
-    *ncpus = 0;
+struct io_uring_sqe* systest_uring_getsqe(systest_uring* ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *ring->sq_tail + ring->sq_pending;
+    if (tail - head >= ring->params.sq_entries)
+        return NULL;
 
-#if defined(CTL_HW)
-# pragma message("have CTL_HW")
-#endif
+    unsigned idx = tail & *ring->sq_mask;
+    ring->sq_array[idx] = idx;
+    ring->sq_pending++;
 
-#if defined(__MACOS__)
-    static struct {
-        const char* const name;
-        const char* const desc;
-        int mib[2];
-    } sysctl_entries[] = {
-        {"hw.ncpu", "the maximum number of processors that could be available this boot", {6, 3}},
-        {"hw.activecpu", "the number of processors currently available for executing threads", {6, 25}},
-        {"hw.physicalcpu", "the number of physical processors available in the current power mode", {6, 104}},
-        {"hw.physicalcpu_max", "the maximum number of physical processors that could be available this boot", {6, 105}},
-        {"hw.logicalcpu", "the number of logical processors available in the current power mode", {6, 106}},
-        {"hw.logicalcpu_max", "the maximum number of logical processors that could be available this boot", {6, 107}}
-    };
+    struct io_uring_sqe* sqe = &ring->sqes[idx];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    return sqe;
+}
 
-    for (size_t n = 0; n < __countof(sysctl_entries); n++) {
-        u_int mib_size = __countof(sysctl_entries[n].mib);
-        int ret_value = 0;
-        size_t ret_size = sizeof(int);
-        if (-1 == sysctl(sysctl_entries[n].mib, mib_size, &ret_value, &ret_size, NULL, 0)) {
-            handle_error(errno, "sysctl");
-            continue;
-        }
-        self_log("%s: value = %d", sysctl_entries[n].name, ret_value);
-        if (n == 4) {
-            *ncpus = ret_value;
-        }
+int systest_uring_submit(systest_uring* ring, unsigned wait_nr) {
+    unsigned to_submit = ring->sq_pending;
+    if (to_submit > 0) {
+        __atomic_store_n(ring->sq_tail, *ring->sq_tail + to_submit, __ATOMIC_RELEASE);
+        ring->sq_pending = 0;
     }
 
-#elif defined(__WIN__)
-    /*DWORD count = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
-    self_log("GetActiveProcessorCount: %lu", count);*/
-    DWORD count2 = GetMaximumProcessorCount(ALL_PROCESSOR_GROUPS);
-    self_log("GetMaximumProcessorCount: %lu", count2);
+    if (0 == to_submit && 0 == wait_nr)
+        return 0;
 
-    *ncpus = (int)count2;
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, ring->fd, to_submit, wait_nr,
+            wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (-1 == ret && EINTR == errno && 0 == to_submit)
+            continue;
+        return (int)ret;
+    }
+}
 
-    /*DWORD lpbuf_len = 0UL;
-    GetLogicalProcessorInformationEx(RelationGroup, NULL, &lpbuf_len);
-    if (ERROR_INSUFFICIENT_BUFFER != GetLastError())
-       return false;
+bool systest_uring_getcqe(systest_uring* ring, struct io_uring_cqe* cqe, bool wait) {
+    for (;;) {
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            *cqe = ring->cqes[head & *ring->cq_mask];
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            return true;
+        }
 
-    self_log("lpbuf_len = %lu; allocating...", lpbuf_len);
-    PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX lp = malloc(lpbuf_len);
-    if (!lp)
-        return false;
+        if (!wait || -1 == systest_uring_submit(ring, 1))
+            return false;
+    }
+}
 
-    if (!GetLogicalProcessorInformationEx(RelationGroup, lp, &lpbuf_len)) {
-        self_log("ERROR: 2nd call failed: %lu", GetLastError());
-        _systest_safefree(&lp);
+bool systest_uring_probeops(systest_uring* ring, bool supported[256], unsigned* last_op) {
+    size_t size = sizeof(struct io_uring_probe) + (256 * sizeof(struct io_uring_probe_op));
+    struct io_uring_probe* probe = calloc(1, size);
+    if (!probe) {
+        handle_error(errno, "calloc() failed!");
         return false;
     }
 
-    size_t ret_count = (lpbuf_len / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX));
-    self_log("got %zu structures, enumerating...", ret_count);
-    for (size_t n = 0; n < ret_count; n++) {
-        self_log("relationship: %d, size: %lu", lp[n].Relationship, lp[n].Size);
-        self_log("group: active count: %hu, max count: %hu", lp[n].Group.ActiveGroupCount,
-            lp[n].Group.MaximumGroupCount);
-        for (size_t g = 0; g < lp[n].Group.ActiveGroupCount; g++) {
-            self_log("group[%zu]: MaxCPUs: %x, ActiveCPUs: %x, afffinity: %llx", g,
-                lp[n].Group.GroupInfo[g].MaximumProcessorCount,
-                lp[n].Group.GroupInfo[g].ActiveProcessorCount,
-                lp[n].Group.GroupInfo[g].ActiveProcessorMask);
-        }
+    memset(supported, 0, 256 * sizeof(bool));
+    if (-1 == syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, 256)) {
+        int err = errno;
+        systest_safefree(&probe);
+        errno = err;
+        return false;
     }
 
-    _systest_safefree(&lp);*/
-#elif defined(__linux__) || defined(__BSD__)
-# if defined(__HAVE_GET_NPROCS__)
-    int gnprocs = get_nprocs();
-    int gnprocsc = get_nprocs_conf();
-    self_log("get_nprocs: available: %d, configured: %d", gnprocs, gnprocsc);
-    //*ncpus = gnprocs;
-# endif
-# if defined(__HAVE_SYSCTL__)
-    /*int scprocs = 0; // hw.logicalcpu works on macOS, not on FreeBSD.
-    size_t len = sizeof(int);
-    sysctlbyname("hw.logicalcpu", &scprocs, &len, NULL, 0);
-    self_log("__HAVE_SYSCTL__: logical cpus: %d", scprocs);
-    *ncpus = scprocs;*/
-    int mib[2] = {CTL_HW, HW_NCPU}; // hw.ncpu
-    u_int mib_size = 2;
-    int ret_value = 0;
-    size_t ret_size = sizeof(int);
-    if (-1 != sysctl(mib, mib_size, &ret_value, &ret_size, NULL, 0)) {
-        self_log("sysctl(%d, %d): %d", mib[0], mib[1], ret_value);
-    } else {
-        handle_error(errno, "sysctl");
-    }
-# endif
-# if defined(__HAVE_SCHED__) && !defined(__ANDROID__)
-    cpu_set_t set;
-    CPU_ZERO(&set);
-    if (sched_getaffinity(0, sizeof(cpu_set_t), &set)) {
-        handle_error(errno, "sched_getaffinity");
-    } else {
-        long gaprocs = CPU_COUNT(&set);
-        self_log("sched_getaffinity: %ld", gaprocs);
-    }
-# endif
-    long sconfprocs = sysconf(_SC_NPROCESSORS_ONLN);
-    long sconfprocsc = sysconf(_SC_NPROCESSORS_CONF);
-    self_log("sysconf: available: %ld, configured: %ld", sconfprocs, sconfprocsc);
-    *ncpus = (int)sconfprocs;
-#elif defined(__HAIKU__)
-    system_info si = {0};
-    status_t ret = get_system_info(&si);
-    if (B_OK != ret) {
-        handle_error(B_TO_POSIX_ERROR(ret), "get_system_info");
-    } else {
-        self_log("get_system_info: %u", si.cpu_count);
+    *last_op = probe->last_op;
+    for (unsigned n = 0; n < probe->ops_len && n < 256; n++) {
+        if (systest_bittest(probe->ops[n].flags, IO_URING_OP_SUPPORTED))
+            supported[probe->ops[n].op] = true;
     }
-#else
-#error "CPU count not implemented for this platform"
-#endif
 
+    systest_safefree(&probe);
     return true;
 }
 
+const char* systest_uring_opname(unsigned op) {
+    static const char* const names[] = {
+        "NOP", "READV", "WRITEV", "FSYNC", "READ_FIXED", "WRITE_FIXED", "POLL_ADD",
+        "POLL_REMOVE", "SYNC_FILE_RANGE", "SENDMSG", "RECVMSG", "TIMEOUT", "TIMEOUT_REMOVE",
+        "ACCEPT", "ASYNC_CANCEL", "LINK_TIMEOUT", "CONNECT", "FALLOCATE", "OPENAT", "CLOSE",
+        "FILES_UPDATE", "STATX", "READ", "WRITE", "FADVISE", "MADVISE", "SEND", "RECV",
+        "OPENAT2", "EPOLL_CTL", "SPLICE", "PROVIDE_BUFFERS", "REMOVE_BUFFERS", "TEE",
+        "SHUTDOWN", "RENAMEAT", "UNLINKAT", "MKDIRAT", "SYMLINKAT", "LINKAT", "MSG_RING",
+        "FSETXATTR", "SETXATTR", "FGETXATTR", "GETXATTR", "SOCKET", "URING_CMD", "SEND_ZC",
+        "SENDMSG_ZC"
+    };
+
+    return op < __countof(names) ? names[op] : NULL;
+}
+#endif // __HAVE_IO_URING__
+
 
 //
 // utility functions
 //
 
 
+uint64_t systest_monotonic_ns(void) {
+#if !defined(__WIN__)
+    struct timespec ts = {0};
+    if (0 != clock_gettime(CLOCK_MONOTONIC, &ts)) {
+        handle_error(errno, "clock_gettime() failed!");
+        return 0;
+    }
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+#else
+    static LARGE_INTEGER freq = {0};
+    LARGE_INTEGER now = {0};
+    if (0 == freq.QuadPart)
+        (void)QueryPerformanceFrequency(&freq);
+    (void)QueryPerformanceCounter(&now);
+    return (uint64_t)((now.QuadPart / freq.QuadPart) * 1000000000LL +
+        ((now.QuadPart % freq.QuadPart) * 1000000000LL) / freq.QuadPart);
+#endif
+}
+
+static int _systest_cmpu64(const void* lhs, const void* rhs) {
+    uint64_t a = *(const uint64_t*)lhs;
+    uint64_t b = *(const uint64_t*)rhs;
+    return (a > b) - (a < b);
+}
+
+void systest_sortu64(uint64_t* values, size_t count) {
+    if (values && count > 1)
+        qsort(values, count, sizeof(uint64_t), &_systest_cmpu64);
+}
+
+uint64_t systest_percentile(const uint64_t* sorted, size_t count, double pct) {
+    if (!sorted || 0 == count)
+        return 0;
+
+    /* nearest-rank. */
+    double rank = (pct / 100.0) * (double)count;
+    size_t idx  = (size_t)rank;
+    if ((double)idx < rank)
+        idx++;
+    return sorted[idx > 0 ? (idx > count ? count - 1 : idx - 1) : 0];
+}
+
+static SYSTEST_THREAD_LOCAL FILE* _systest_capture = NULL;
+
+FILE* systest_stdout(void) {
+    return _systest_capture ? _systest_capture : stdout;
+}
+
+FILE* systest_stderr(void) {
+    return _systest_capture ? _systest_capture : stderr;
+}
+
+void systest_setcapture(FILE* stream) {
+    _systest_capture = stream;
+}
+
 void _handle_error(int err, const char* msg, char* file, int line, const char* func) {
-    fprintf(stderr, RED("ERROR: %s (%s:%d): %s (%d, %s)") "\n",
+    fprintf(systest_stderr(), RED("ERROR: %s (%s:%d): %s (%d, %s)") "\n",
         func, file, line, msg, err, strerror(err));
 }
 
 void _self_log(const char* msg, char* file, int line, const char* func) {
-    fprintf(stderr, WHITE("%s (%s:%d): %s") "\n", func, file, line, msg);
+    fprintf(systest_stderr(), WHITE("%s (%s:%d): %s") "\n", func, file, line, msg);
 }
@@ -35,8 +35,15 @@
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <poll.h>
+#include <dirent.h>
+#include <ftw.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
 
 # if defined(__GLIBC__)
 #  if (__GLIBC__ >= 2 && __GLIBC_MINOR__ > 19)  || \
@@ -102,13 +109,27 @@ typedef int optlen;
 #include <inttypes.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <time.h>
 
 #if !defined(__WIN__)
 # if defined(__linux__)
+#  include <sys/sendfile.h>
+#  include <sys/uio.h>
+#  include <netinet/udp.h>
+#  include <linux/errqueue.h>
+#  include <sys/epoll.h>
+#  include <sys/timerfd.h>
+#  include <sys/prctl.h>
+#  include <sys/sysmacros.h>
 #  include <sys/sysinfo.h>
+#  include <sys/auxv.h>
+#  include <sys/syscall.h>
 #  define __HAVE_GET_NPROCS__
 #  include <sched.h>
 #  define __HAVE_SCHED__
+#  if defined(STATX_TYPE)
+#   define __HAVE_STATX__
+#  endif
 # elif defined(__HAIKU__)
 #  include <OS.h>
 # else
@@ -117,6 +138,47 @@ typedef int optlen;
 # endif
 #endif
 
+#if !defined(__WIN__)
+# include <pthread.h>
+# define __HAVE_PTHREADS__
+#endif
+
+#if defined(__WIN__)
+# define SYSTEST_THREAD_LOCAL __declspec(thread)
+#else
+# define SYSTEST_THREAD_LOCAL _Thread_local
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+# include <cpuid.h>
+# define __HAVE_CPUID__
+#elif defined(__aarch64__) && defined(__linux__)
+# include <sys/auxv.h>
+# define __HAVE_HWCAP__
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  include <linux/io_uring.h>
+/* the opcodes are an enum, so go by a macro from the same (5.6) headers as
+ * IORING_REGISTER_PROBE, IORING_OP_SEND and IORING_OP_STATX. */
+#  if defined(IO_URING_OP_SUPPORTED)
+#   define __HAVE_IO_URING__
+#  endif
+# endif
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/mempolicy.h>)
+#  include <linux/mempolicy.h>
+#  define __HAVE_MEMPOLICY__
+# endif
+# if __has_include(<linux/futex.h>)
+#  include <linux/futex.h>
+#  define __HAVE_FUTEX__
+# endif
+#endif
+
 #if defined(__MACOS__)
 # include <mach-o/dyld.h>
 #elif defined(__FreeBSD__)
@@ -164,12 +226,40 @@ typedef enum {
 bool systest_pathgetstat(const char* restrict path, struct stat* restrict st, systest_rel_to rel_to);
 bool systest_pathexists(const char* restrict path, bool* restrict exists, systest_rel_to rel_to);
 
+/** Flags which alter how the batch path functions do their lookups. */
+typedef enum {
+    SYSTEST_PATHBATCH_DEFAULT  = 0x0000,
+    SYSTEST_PATHBATCH_PARALLEL = 0x0001, /**< Spread large batches over several threads. */
+    SYSTEST_PATHBATCH_URING    = 0x0002  /**< Submit the lookups through io_uring, if available. */
+} systest_pathbatch_flags;
+
+/** Batches smaller than this are looked up on the calling thread, even with
+ * SYSTEST_PATHBATCH_PARALLEL. */
+#define SYSTEST_PATHBATCH_PER_THREAD 64
+
+/** Batch forms of systest_pathgetstat/systest_pathexists: count paths in, count
+ * results out, nothing printed. Relative paths are resolved against a single
+ * directory descriptor, and symbolic links are not followed. Paths that don't
+ * exist are not an error. If looking up any path fails for another reason, its
+ * result is zeroed (or false), the rest are still filled in, and false is
+ * returned with errno set to the first such error. */
+bool systest_pathgetstat_many(const char* const* paths, size_t count, struct stat* sts,
+    systest_rel_to rel_to, unsigned flags);
+bool systest_pathexists_many(const char* const* paths, size_t count, bool* exists,
+    systest_rel_to rel_to, unsigned flags);
+
 char* systest_getcwd(void);
 
+/* these return copies (free them) of values that are resolved once and then
+ * cached; see systest_pathcache_invalidate(). */
 char* systest_getappfilename(void);
 char* systest_getappbasename(void);
 char* systest_getappdir(void);
 
+/** Drops the cached app file name and app dir, and closes the app dir
+ * descriptor used for relative paths. Call it if the binary may have moved. */
+void systest_pathcache_invalidate(void);
+
 char* systest_getbasename(char* restrict path);
 char* systest_getdirname(char* restrict path);
 
@@ -181,20 +271,325 @@ bool systest_add_slash(char* restrict path);
 
 bool systest_getfreediskspace(uint64_t* bytes);
 
+/** Default per-mount deadline, in milliseconds, for systest_getmounts(). */
+#define SYSTEST_MOUNT_TIMEOUT_MS 1000
+
+#if defined(__linux__) && defined(__HAVE_PTHREADS__)
+/** Most statvfs() calls systest_getmounts() has in flight at once. */
+# define SYSTEST_MOUNT_THREADS 16
+
+/** One entry from /proc/self/mountinfo, with its statvfs() figures. */
+typedef struct {
+    char* mount_point;
+    char* fs_type;
+    char* source;
+    bool stuck;  /**< statvfs() didn't return before the deadline (or was never tried). */
+    int err;     /**< errno from statvfs(), or zero. */
+    uint64_t total_bytes;
+    uint64_t avail_bytes; /**< Free to unprivileged users. */
+    uint64_t total_inodes;
+    uint64_t free_inodes;
+} systest_mount;
+
+/** Lists every mount and calls statvfs() on each, from worker threads, giving
+ * each call timeout_ms to return. Calls that don't (e.g., on a hung NFS mount)
+ * are left behind on their threads and reported as stuck, so this returns in
+ * bounded time. Free the result with systest_freemounts(). */
+bool systest_getmounts(systest_mount** mounts, size_t* count, int timeout_ms);
+void systest_freemounts(systest_mount* mounts, size_t count);
+#endif
+
 /////////////////////////////// network ////////////////////////////////////////
 
+/** Overall deadline, in milliseconds, for systest_haveinetconn(). */
+#define SYSTEST_INET_TIMEOUT_MS 5000
+
+/** How long to wait for a connection attempt before starting one to the next
+ * address in parallel (RFC 8305's "Connection Attempt Delay"). */
+#define SYSTEST_INET_ATTEMPT_DELAY_MS 250
+
 bool systest_haveinetconn(void);
+bool systest_canconnect(const char* restrict host, const char* restrict port, int timeout_ms);
 bool systest_gethostname(char hname[SYSTEST_MAXHOST]);
 
 /////////////////////////////// platform ///////////////////////////////////////
 
 bool systest_getuname(struct utsname* name);
+
+/** Returns the number of logical CPUs this process may run on: those online,
+ * narrowed by the affinity mask where there is one. */
 bool systest_getcpucount(int* ncpus);
 
+/** Most logical CPUs systest_getcputopology() describes. */
+#define SYSTEST_MAX_CPUS 1024
+
+/** Most cache levels/types systest_getcputopology() describes. */
+#define SYSTEST_MAX_CACHES 8
+
+typedef struct {
+    unsigned level;   /**< 1, 2, 3... */
+    char type;        /**< 'D'ata, 'I'nstruction or 'U'nified. */
+    uint64_t size;    /**< Bytes, per instance. */
+    unsigned line_size;
+    unsigned ways;
+    size_t instances; /**< How many of this cache there are. */
+    size_t shared_by; /**< Logical CPUs sharing each instance. */
+} systest_cache;
+
+typedef struct {
+    int id;      /**< Logical CPU number. */
+    int package;
+    int core;    /**< Index of its physical core, counting across all packages. */
+    int smt;     /**< Which of its core's hardware threads it is: 0, 1... */
+    int node;    /**< NUMA node, or -1 if unknown. */
+    bool allowed; /**< In this process's affinity mask. */
+    /** For each entry in systest_cputopo.caches, the lowest-numbered CPU that
+     * shares that cache with this one (so equal ids = same cache), or -1. */
+    int cache_ids[SYSTEST_MAX_CACHES];
+} systest_cpu;
+
+typedef struct {
+    size_t packages;
+    size_t cores;    /**< Physical cores. */
+    size_t threads;  /**< Online logical CPUs. */
+    size_t nodes;    /**< NUMA nodes, including any without CPUs. */
+    size_t allowed;  /**< Logical CPUs in the affinity mask. */
+    size_t ncpus;
+    systest_cpu* cpus; /**< One per online logical CPU. */
+    size_t ncaches;
+    /** As seen from the first online CPU. Hybrid parts (P/E cores) have
+     * other sizes, sharing and even levels on their other core type, which
+     * this doesn't describe; instances counts them all the same. */
+    systest_cache caches[SYSTEST_MAX_CACHES];
+    char vendor[16]; /**< From CPUID, where there is such a thing. */
+    char brand[64];
+} systest_cputopo;
+
+/** Describes the CPUs, from sysfs on Linux and CPUID on x86. Whatever can't
+ * be determined is left zero (or -1). Free with systest_freecputopology(). */
+bool systest_getcputopology(systest_cputopo* topo);
+void systest_freecputopology(systest_cputopo* topo);
+
+/** CPU and memory limits from the process's cgroup (v2 or v1) and affinity
+ * mask. For the memory fields, UINT64_MAX means no limit. */
+typedef struct {
+    int version;            /**< Highest cgroup version a limit came from: 2, 1, or 0 for none. */
+    double cpu_quota;       /**< CPUs' worth of time from cpu.max (cpu.cfs_quota_us); 0 = no quota. */
+    size_t cpuset_cpus;     /**< CPUs in cpuset.cpus.effective; 0 = unknown. */
+    size_t affinity_cpus;   /**< CPUs in the sched_getaffinity() mask; 0 = unknown. */
+    size_t online_cpus;
+    double effective_cpus;  /**< The smallest of the above; may be fractional. */
+    uint64_t memory_max;    /**< memory.max (memory.limit_in_bytes). */
+    uint64_t memory_high;   /**< memory.high (memory.soft_limit_in_bytes). */
+    uint64_t memory_current; /**< memory.current (memory.usage_in_bytes); 0 = unknown. */
+    uint64_t physical_memory;
+    uint64_t memory_budget; /**< The smallest of max, high and physical memory. */
+} systest_cgroup_limits;
+
+/** Works out how many CPUs' worth of time and how much memory this process
+ * can actually use, for sizing thread pools and caches. Limits set on
+ * ancestor cgroups are taken into account. */
+bool systest_getcgrouplimits(systest_cgroup_limits* limits);
+
+/** Instruction set extensions which systest_getcpufeatures() looks for. The
+ * x86 ones that need OS support for their registers (AVX and up) are only
+ * reported if the OS has enabled them. */
+typedef enum {
+    SYSTEST_CPU_SSE42,      /**< Includes the CRC32C instruction. */
+    SYSTEST_CPU_POPCNT,
+    SYSTEST_CPU_PCLMULQDQ,
+    SYSTEST_CPU_AVX,
+    SYSTEST_CPU_AVX2,
+    SYSTEST_CPU_FMA,
+    SYSTEST_CPU_BMI1,
+    SYSTEST_CPU_BMI2,
+    SYSTEST_CPU_SHA,        /**< SHA extensions (x86) or SHA2 instructions (arm). */
+    SYSTEST_CPU_AVX512F,
+    SYSTEST_CPU_AVX512DQ,
+    SYSTEST_CPU_AVX512BW,
+    SYSTEST_CPU_AVX512VL,
+    SYSTEST_CPU_AVX512VNNI,
+    SYSTEST_CPU_VPCLMULQDQ,
+    SYSTEST_CPU_NEON,
+    SYSTEST_CPU_CRC32,      /**< The armv8 CRC32/CRC32C instructions. */
+    SYSTEST_CPU_SVE,
+    SYSTEST_CPU_SVE2,
+    SYSTEST_CPU_FEATURE_COUNT
+} systest_cpu_feature;
+
+/** Returns a mask of (1 << systest_cpu_feature) bits, from CPUID/XGETBV on x86
+ * and the auxiliary vector on aarch64 Linux. */
+uint64_t systest_getcpufeatures(void);
+const char* systest_cpufeaturename(systest_cpu_feature feature);
+
+#if defined(__linux__)
+/** Most huge page sizes systest_gethugepages() describes. */
+#define SYSTEST_MAX_HUGEPAGE_SIZES 4
+
+/** One hugetlbfs pool, from /sys/kernel/mm/hugepages/hugepages-<size>kB. */
+typedef struct {
+    uint64_t size;  /**< Bytes per page. */
+    long total;     /**< nr_hugepages: pages set aside for hugetlb. */
+    long free;
+    long reserved;  /**< Promised to mappings but not yet faulted in. */
+    long surplus;
+    long overcommit; /**< How many more may be allocated on demand. */
+} systest_hugepage_pool;
+
+/** Transparent huge page settings and explicit huge page pools. The THP
+ * modes are the selected word, e.g. "madvise", or "" if THP is absent. */
+typedef struct {
+    char thp_enabled[16];
+    char thp_defrag[16];
+    char thp_shmem[16];
+    uint64_t thp_size;        /**< hpage_pmd_size; 0 = unknown. */
+    uint64_t anon_huge_bytes; /**< AnonHugePages in use system-wide. */
+    uint64_t default_size;    /**< Hugepagesize: what plain MAP_HUGETLB gets. */
+    size_t npools;
+    systest_hugepage_pool pools[SYSTEST_MAX_HUGEPAGE_SIZES]; /**< Smallest first. */
+} systest_hugepages;
+
+bool systest_gethugepages(systest_hugepages* info);
+
+/** Most NUMA nodes systest_getnumanodes() describes. */
+#define SYSTEST_MAX_NODES 64
+
+typedef struct {
+    int id;
+    size_t cpus;        /**< Online CPUs on the node; 0 for memory-only nodes. */
+    uint64_t mem_total; /**< Bytes; 0 for CPU-only nodes. */
+    uint64_t mem_free;
+    /** SLIT distance to each node, indexed like the systest_getnumanodes()
+     * array; 10 means local. */
+    int distance[SYSTEST_MAX_NODES];
+} systest_numa_node;
+
+/** Lists the online NUMA nodes from sysfs, in id order. Machines (or
+ * kernels) without NUMA report a single node. Free with free(). */
+bool systest_getnumanodes(systest_numa_node** nodes, size_t* count);
+#endif
+
+/////////////////////////////// io_uring ///////////////////////////////////////
+
+#if defined(__HAVE_IO_URING__)
+/** A minimal io_uring instance, driven through the raw system calls (i.e.,
+ * without liburing). Single-threaded use only. */
+typedef struct {
+    int fd;
+    struct io_uring_params params;
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    unsigned sq_pending; /**< Prepared SQEs not yet handed to the kernel. */
+} systest_uring;
+
+/** Sets up a ring with (at least) the given number of entries. On failure,
+ * returns false with errno set; ENOSYS or EPERM usually mean io_uring is
+ * disabled (see kernel.io_uring_disabled) or blocked by seccomp. */
+bool systest_uring_init(systest_uring* ring, unsigned entries);
+void systest_uring_free(systest_uring* ring);
+
+/** Returns a zeroed SQE to fill in, or NULL if the submission queue is full. */
+struct io_uring_sqe* systest_uring_getsqe(systest_uring* ring);
+
+/** Submits prepared SQEs and waits for at least wait_nr completions. Returns
+ * the number of SQEs consumed, or -1 with errno set. */
+int systest_uring_submit(systest_uring* ring, unsigned wait_nr);
+
+/** Pops a completion into cqe; if there is none and wait is true, blocks until
+ * there is. Returns false if there was nothing to pop. */
+bool systest_uring_getcqe(systest_uring* ring, struct io_uring_cqe* cqe, bool wait);
+
+/** Asks the kernel which opcodes it supports. supported must have room for
+ * 256 entries; last_op receives the highest opcode the kernel knows of. */
+bool systest_uring_probeops(systest_uring* ring, bool supported[256], unsigned* last_op);
+
+/** Returns a name for an IORING_OP_* value, or NULL if it's newer than this
+ * code. */
+const char* systest_uring_opname(unsigned op);
+#endif
+
+//
+// probe registry
+//
+
+/** Rough cost of running a probe, so that quick runs can leave out the
+ * slow ones (see --max-cost). */
+typedef enum {
+    SYSTEST_COST_CHEAP     = 0, /**< Microseconds; no I/O to speak of. */
+    SYSTEST_COST_MODERATE  = 1, /**< Milliseconds; local I/O or process creation. */
+    SYSTEST_COST_EXPENSIVE = 2  /**< Up to seconds; may block on the network. */
+} systest_cost;
+
+/** Flags which alter how a probe is run and reported. */
+typedef enum {
+    SYSTEST_PROBE_NONE = 0x0000,
+    SYSTEST_PROBE_INFO   = 0x0001, /**< Informational; not counted as a test. */
+    SYSTEST_PROBE_SERIAL = 0x0002, /**< Must run alone (e.g. benchmarks); never
+                                        scheduled on the worker pool. */
+    SYSTEST_PROBE_BENCH  = 0x0004  /**< Benchmark; only run with --bench or when
+                                        named by --only. */
+} systest_probe_flags;
+
+typedef bool (*systest_probe_fn)(void);
+
+/** An entry in the table of probes that main() runs. */
+typedef struct {
+    const char* const name;     /**< Short name, as given to --only/--skip. */
+    const char* const category; /**< Group name, also accepted by --only/--skip. */
+    const char* const desc;     /**< Description printed with the result. */
+    systest_probe_fn fn;
+    systest_cost cost;
+    uint32_t flags;             /**< systest_probe_flags */
+} systest_probe;
+
+/** What happened when a probe was run. */
+typedef struct {
+    bool ran;
+    bool passed;
+    uint64_t duration_ns; /**< Monotonic clock, wall time. */
+    char* output;         /**< Captured output, if run on the worker pool. */
+    size_t output_len;
+} systest_probe_result;
+
 //
 // utility functions
 //
 
+/** Returns a monotonic timestamp in nanoseconds; only differences between two
+ * values are meaningful. */
+uint64_t systest_monotonic_ns(void);
+
+/** Sorts an array of samples in ascending order. */
+void systest_sortu64(uint64_t* values, size_t count);
+
+/** Returns the pct'th percentile (nearest-rank) of an array sorted with
+ * systest_sortu64. */
+uint64_t systest_percentile(const uint64_t* sorted, size_t count, double pct);
+
+/** Streams that probes write to. They are stdout/stderr, except on a worker
+ * thread of the parallel executor, where both refer to a buffer that is
+ * printed once the probe has finished, so that output stays in order. */
+FILE* systest_stdout(void);
+FILE* systest_stderr(void);
+
+/** Redirects systest_stdout()/systest_stderr() for the calling thread; NULL
+ * restores stdout/stderr. */
+void systest_setcapture(FILE* stream);
+
+#define systest_printf(...) fprintf(systest_stdout(), __VA_ARGS__)
+
 
 /* this is strictly for use when encountering an actual failure of a system call.
  * use self_log to report things other than error numbers. */
@@ -203,7 +598,7 @@ void _handle_error(int err, const char* msg, char* file, int line, const char* f
 
 void _self_log(const char* msg, char* file, int line, const char* func);
 
-static char _self_log_buf[512] = {0};
+static SYSTEST_THREAD_LOCAL char _self_log_buf[512] = {0};
 #define self_log(...)  \
     snprintf(_self_log_buf, 512, __VA_ARGS__); \
     _self_log(_self_log_buf, __file__, __LINE__, __func__);
@@ -235,6 +630,17 @@ void systest_safeclose(int* restrict fd) {
     *fd = -1;
 }
 
+/** Fast, non-cryptographic PRNG (xorshift64*); state must be non-zero. */
+static inline
+uint64_t systest_rand64(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
 /** Checks a bitmask for a specific set of bits. */
 static inline
 bool systest_bittest(uint32_t flags, uint32_t test) {